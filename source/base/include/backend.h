@@ -27,14 +27,35 @@
 #include <gio/gio.h>
 #endif
 #include "parser.h"
+#include "executable_command.h"
 
 /**
  * @brief Initialize global backend type according to supplied program name and opts.
+ * @details Only selects the backend. Gadgets are not scanned until
+ * gt_backend_load() is called.
  * @param[in] program_name program invocation name
  * @param[in] flags program flags
  */
 int gt_backend_init(const char *program_name, enum gt_option_flags flags);
 
+/**
+ * @brief Load state of gadget subsystem required by command
+ * @details Does nothing if scope is GT_SCOPE_NONE or required state
+ * has been already loaded. libusbg is not able to load a part of configfs,
+ * so it scans the whole tree for any other scope.
+ * @param[in] scope part of the system needed by command
+ * @param[in] name gadget name if scope is GT_SCOPE_GADGET
+ * @return 0 on success, -1 otherwise
+ */
+int gt_backend_load(enum gt_command_scope scope, const char *name);
+
+/**
+ * @brief Drop state loaded by gt_backend_load()
+ * @details Next command which needs backend will load it again. Used when
+ * cached state is known to be out of date.
+ */
+void gt_backend_unload(void);
+
 /**
  * Backend type
  */
@@ -44,6 +65,7 @@ enum gt_backend_type {
 	GT_BACKEND_GADGETD,
 #endif
 	GT_BACKEND_LIBUSBG,
+	GT_BACKEND_CONFIGFS,
 	GT_BACKEND_NOT_IMPLEMENTED,
 };
 
@@ -60,6 +82,7 @@ struct gt_backend_ctx {
 	struct gt_backend *backend;
 
 	union {
+		/* used also by configfs backend for commands it lacks */
 		usbg_state *libusbg_state;
 #ifdef WITH_GADGETD
 		GDBusConnection *gadgetd_conn;
@@ -68,6 +91,7 @@ struct gt_backend_ctx {
 };
 
 extern struct gt_backend gt_backend_libusbg;
+extern struct gt_backend gt_backend_configfs;
 #ifdef WITH_GADGETD
 extern struct gt_backend gt_backend_gadgetd;
 #endif
@@ -75,4 +99,21 @@ extern struct gt_backend gt_backend_not_implemented;
 
 extern struct gt_backend_ctx backend_ctx;
 
+#ifdef WITH_GADGETD
+/**
+ * @brief g_dbus_connection_call_sync() recording call in trace
+ */
+GVariant *gt_dbus_connection_call_sync(GDBusConnection *conn,
+				       const gchar *bus_name,
+				       const gchar *object_path,
+				       const gchar *interface_name,
+				       const gchar *method_name,
+				       GVariant *parameters,
+				       const GVariantType *reply_type,
+				       GDBusCallFlags flags,
+				       gint timeout_msec,
+				       GCancellable *cancellable,
+				       GError **error);
+#endif
+
 #endif /* __GADGET_TOOL_BACKEND_H__ */
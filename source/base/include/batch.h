@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file batch.h
+ * @brief Declaration of methods related to executing many commands
+ * in one process.
+ */
+
+#ifndef __GADGET_TOOL_BATCH_H__
+#define __GADGET_TOOL_BATCH_H__
+
+#include "command.h"
+
+struct gt_batch_data {
+	const char *file;
+	int opts;
+};
+
+/**
+ * @brief Parse batch command
+ * @details Each line of input is parsed and executed as separate gt
+ * command, sharing backend state and settings with other lines.
+ */
+void gt_batch_parse(const Command *cmd, int argc, char **argv,
+		ExecutableCommand *exec, void *data);
+
+/**
+ * @brief Help function which should be used if invalid
+ * syntax for batch was entered.
+ *
+ * @param[in] data additional data
+ * @return -1 because invalid syntax has been provided
+ */
+int gt_batch_help(void *data);
+
+/**
+ * @brief Split command line into arguments
+ * @details Words are separated by white spaces. Single and double quotes
+ * and backslash escapes are supported. Everything after unquoted '#' is
+ * ignored. Line is modified in place and returned argv points into it.
+ * @param[in,out] line line to be split
+ * @param[out] argv NULL-terminated array of arguments, argv[0] is set to
+ * program name. Should be freed by caller.
+ * @return Number of arguments including program name or -1 on error
+ */
+int gt_batch_split_line(char *line, char ***argv);
+
+#endif //__GADGET_TOOL_BATCH_H__
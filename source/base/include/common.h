@@ -18,6 +18,8 @@
 #define __GADGET_TOOL_COMMON_H__
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #ifdef WITH_GADGETD
 #include <gio/gio.h>
 #endif
@@ -28,6 +30,9 @@
  */
 extern char *program_name;
 
+/* usb device controllers available in system */
+#define GT_UDC_DIR "/sys/class/udc"
+
 static inline void *zalloc(size_t size)
 {
 	return calloc(1, size);
@@ -38,6 +43,47 @@ static inline void *zalloc(size_t size)
 
 #define ARRAY_SIZE(array) sizeof(array)/sizeof(*array)
 
+/**
+ * @brief Compare usb speed names used in sysfs and configfs
+ * @return rank of speed, higher for faster ones, 0 if unknown
+ */
+static inline int gt_speed_rank(const char *speed)
+{
+	static const char *speeds[] = {
+		"UNKNOWN",
+		"low-speed",
+		"full-speed",
+		"high-speed",
+		"wireless",
+		"super-speed",
+		"super-speed-plus",
+	};
+	int i;
+
+	for (i = ARRAY_SIZE(speeds) - 1; i > 0; i--)
+		if (streq(speeds[i], speed))
+			break;
+
+	return i;
+}
+
+/**
+ * @brief Compute 64-bit FNV-1a hash of given buffer
+ * @details Used to fingerprint gadget schemes, not for security purposes.
+ */
+static inline uint64_t gt_hash(const void *buf, size_t size)
+{
+	const unsigned char *p = buf;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	while (size--) {
+		hash ^= *p++;
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
 #ifdef WITH_GADGETD
 static inline void _cleanup_fn_g_free_(void *p) {
 	g_free(*(gpointer *)p);
@@ -25,11 +25,28 @@
 typedef int (*ExecutableFunc)(void *);
 typedef void (*CleanupFunc)(void *);
 
+/**
+ * @brief Part of the gadget subsystem which has to be loaded by backend
+ * before command can be executed.
+ */
+enum gt_command_scope {
+	/* Command doesn't touch backend at all (help, templates, etc.) */
+	GT_SCOPE_NONE = 0,
+	/* Command needs only list of UDCs */
+	GT_SCOPE_UDC,
+	/* Command operates on single gadget given by scope_name */
+	GT_SCOPE_GADGET,
+	/* Command needs all gadgets and UDCs */
+	GT_SCOPE_ALL,
+};
+
 typedef struct
 {
 	ExecutableFunc exec;
 	void *data;
 	CleanupFunc destructor;
+	enum gt_command_scope scope;
+	const char *scope_name;
 } ExecutableCommand;
 
 /**
@@ -38,11 +55,24 @@ typedef struct
  * @param[in] exec function to be set for execution
  * @param[in] data to be passed to function
  * @param[in] destructor to clean up data
- * @note If to_set is NULL function does nothing
+ * @note If to_set is NULL function does nothing. Scope of the command
+ * is reset to GT_SCOPE_NONE.
  */
 void executable_command_set(ExecutableCommand *to_set, ExecutableFunc exec,
 		void *data, CleanupFunc destructor);
 
+/**
+ * @brief Declares which part of the system has to be loaded by backend
+ * before command is executed.
+ * @param[out] to_set command to be updated
+ * @param[in] scope required scope
+ * @param[in] name name of gadget if scope is GT_SCOPE_GADGET. If NULL,
+ * GT_SCOPE_ALL is used instead.
+ * @note If to_set is NULL function does nothing
+ */
+void executable_command_set_scope(ExecutableCommand *to_set,
+		enum gt_command_scope scope, const char *name);
+
 /**
  * @brief Cleans the stored data with destructor and sets to_clean fields
  * to NULL.
@@ -54,8 +84,11 @@ void executable_command_clean(ExecutableCommand *to_clean);
 
 /**
  * @brief Executes the command.
+ * @details Backend is initialized here, just before execution and only
+ * in scope declared by command.
  * @param[in] cmd to be executed
- * @return Value returned from executed function or -1 if function not set.
+ * @return Value returned from executed function or -1 if function not set
+ * or backend initialization failed.
  */
 int executable_command_exec(ExecutableCommand *cmd);
 
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file json.h
+ * @brief Minimal JSON writer used by --json output mode
+ * @details Document is built in memory and written with a single call,
+ * so readers never see partial output.
+ */
+
+#ifndef __GADGET_TOOL_JSON_H__
+#define __GADGET_TOOL_JSON_H__
+
+#include <stdio.h>
+#include <libconfig.h>
+
+#define GT_JSON_MAX_DEPTH 16
+
+struct gt_json {
+	FILE *fp;
+	char *buf;
+	size_t size;
+	int depth;
+	/* number of values written at each nesting level */
+	int count[GT_JSON_MAX_DEPTH];
+};
+
+/**
+ * @brief Start new document
+ * @return 0 on success, -1 otherwise
+ */
+int gt_json_init(struct gt_json *j);
+
+/**
+ * @brief Write document to stream and free resources
+ * @return 0 on success, -1 otherwise
+ */
+int gt_json_flush(struct gt_json *j, FILE *out);
+
+/**
+ * @brief Drop document without writing it
+ */
+void gt_json_free(struct gt_json *j);
+
+/**
+ * Functions below take member name as key. Key should be NULL for array
+ * elements and for top-level value.
+ */
+void gt_json_begin_object(struct gt_json *j, const char *key);
+void gt_json_end_object(struct gt_json *j);
+void gt_json_begin_array(struct gt_json *j, const char *key);
+void gt_json_end_array(struct gt_json *j);
+
+/**
+ * @brief Write string or null if val is NULL
+ */
+void gt_json_string(struct gt_json *j, const char *key, const char *val);
+void gt_json_int(struct gt_json *j, const char *key, long long val);
+void gt_json_bool(struct gt_json *j, const char *key, int val);
+
+/**
+ * @brief Write libconfig setting converted to JSON
+ * @details Groups become objects, lists and arrays become arrays.
+ */
+void gt_json_setting(struct gt_json *j, const char *key,
+		const config_setting_t *s);
+
+#endif //__GADGET_TOOL_JSON_H__
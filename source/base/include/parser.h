@@ -89,6 +89,9 @@ enum gt_option_flags {
 	GT_TYPE = 1 << 9,
 	GT_NAME = 1 << 10,
 	GT_ID = 1 << 11,
+	GT_KEEP_GOING = 1 << 12,
+	GT_IF_CHANGED = 1 << 13,
+	GT_JSON = 1 << 14,
 };
 
 /**
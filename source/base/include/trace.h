@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file trace.h
+ * @brief Timing of commands, configfs and D-Bus calls (--trace option)
+ * @details Events are collected in memory and written when program exits
+ * as trace event JSON (chrome://tracing, Perfetto). Each event holds start
+ * time and duration in microseconds, path it refers to and return code.
+ */
+
+#ifndef __GADGET_TOOL_TRACE_H__
+#define __GADGET_TOOL_TRACE_H__
+
+/**
+ * @brief Start collecting events, to be written to given file at exit
+ * @return 0 on success, -1 otherwise
+ */
+int gt_trace_open(const char *file);
+
+/**
+ * @brief Write collected events to file and stop tracing
+ */
+void gt_trace_close(void);
+
+extern int gt_trace_enabled;
+
+/**
+ * @brief Get current time in microseconds, 0 if tracing is disabled
+ */
+long long gt_trace_now(void);
+
+/**
+ * @brief Record event which began at start
+ * @param[in] cat Category of event (eg. gt, configfs, usbg, dbus)
+ * @param[in] name Name of operation
+ * @param[in] path Path or name of object, may be NULL
+ * @param[in] start Value returned by gt_trace_now() when operation began
+ * @param[in] ret Return code of operation
+ */
+void gt_trace_event(const char *cat, const char *name, const char *path,
+		long long start, long long ret);
+
+/**
+ * @brief Call function and record event named after it
+ * @details Path is evaluated before the call, only if tracing is enabled,
+ * so it may refer to object removed by the call.
+ * @return Value returned by function
+ */
+#define GT_TRACE(cat, path, func, ...) ({				\
+	const char *__gt_path = gt_trace_enabled ? (path) : NULL;	\
+	long long __gt_start = gt_trace_now();				\
+	__typeof__(func(__VA_ARGS__)) __gt_ret = func(__VA_ARGS__);	\
+	gt_trace_event(cat, #func, __gt_path, __gt_start,		\
+		       (long long)__gt_ret);				\
+	__gt_ret;							\
+})
+
+#endif //__GADGET_TOOL_TRACE_H__
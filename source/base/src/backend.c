@@ -15,6 +15,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <usbg/usbg.h>
 #ifdef WITH_GADGETD
@@ -27,6 +28,8 @@
 #include "gadget.h"
 #include "configuration.h"
 #include "udc.h"
+#include "settings.h"
+#include "trace.h"
 
 struct gt_backend_ctx backend_ctx = {
 #ifdef WITH_GADGETD
@@ -43,6 +46,17 @@ struct gt_backend gt_backend_libusbg = {
 	.udc = &gt_udc_backend_libusbg,
 };
 
+/*
+ * Gadget commands executed frequently work directly on configfs,
+ * everything else is done by libusbg.
+ */
+struct gt_backend gt_backend_configfs = {
+	.function = &gt_function_backend_libusbg,
+	.gadget = &gt_gadget_backend_configfs,
+	.config = &gt_config_backend_libusbg,
+	.udc = &gt_udc_backend_libusbg,
+};
+
 #ifdef WITH_GADGETD
 struct gt_backend gt_backend_gadgetd = {
 	.function = &gt_function_backend_gadgetd,
@@ -62,12 +76,18 @@ struct gt_backend gt_backend_not_implemented = {
 int gt_backend_init(const char *program_name, enum gt_option_flags flags)
 {
 	enum gt_backend_type backend_type;
+	const char *env;
 #ifdef WITH_GADGETD
 	GError *err = NULL;
 #endif
 
-	if (strcmp(program_name, "gt") == 0)
-		backend_type = GT_BACKEND_LIBUSBG;
+	if (strcmp(program_name, "gt") == 0) {
+		env = getenv("GT_BACKEND");
+		if (env && strcmp(env, "configfs") == 0)
+			backend_type = GT_BACKEND_CONFIGFS;
+		else
+			backend_type = GT_BACKEND_LIBUSBG;
+	}
 #ifdef WITH_GADGETD
 	else if (strcmp(program_name, "gadgetctl") == 0)
 		backend_type = GT_BACKEND_GADGETD;
@@ -82,6 +102,7 @@ int gt_backend_init(const char *program_name, enum gt_option_flags flags)
 #endif
 
 	if (backend_type == GT_BACKEND_NOT_IMPLEMENTED) {
+		backend_ctx.backend_type = GT_BACKEND_NOT_IMPLEMENTED;
 		backend_ctx.backend = &gt_backend_not_implemented;
 		return 0;
 	}
@@ -102,17 +123,17 @@ int gt_backend_init(const char *program_name, enum gt_option_flags flags)
 			goto out_gadgetd;
 		}
 
-		g_dbus_connection_call_sync(conn,
-					    "org.usb.gadgetd",
-					    "/",
-					    "org.freedesktop.DBus.Peer",
-					    "Ping",
-					    NULL,
-					    NULL,
-					    G_DBUS_CALL_FLAGS_NONE,
-					    -1,
-					    NULL,
-					    &err);
+		gt_dbus_connection_call_sync(conn,
+					     "org.usb.gadgetd",
+					     "/",
+					     "org.freedesktop.DBus.Peer",
+					     "Ping",
+					     NULL,
+					     NULL,
+					     G_DBUS_CALL_FLAGS_NONE,
+					     -1,
+					     NULL,
+					     &err);
 		if (err) {
 			/* We omit showing glib-provided error message here
 			 * as it's not really that useful for end-users.
@@ -138,22 +159,82 @@ out_gadgetd:
 #else
 	if (backend_type == GT_BACKEND_LIBUSBG) {
 #endif
-		usbg_state *s = NULL;
-		int r;
-
+		/* configfs is scanned later, when command really needs it */
 		backend_ctx.backend = &gt_backend_libusbg;
-
-		r = usbg_init("/sys/kernel/config", &s);
-		if (r != USBG_SUCCESS) {
-			fprintf(stderr, "Unable to initialize libusbg backend_type: %s\n", usbg_strerror(r));
-			goto out_libusbg;
-		}
-
 		backend_ctx.backend_type = GT_BACKEND_LIBUSBG;
-		backend_ctx.libusbg_state = s;
+		backend_ctx.libusbg_state = NULL;
+		return 0;
+	}
+
+	if (backend_type == GT_BACKEND_CONFIGFS) {
+		backend_ctx.backend = &gt_backend_configfs;
+		backend_ctx.backend_type = GT_BACKEND_CONFIGFS;
+		backend_ctx.libusbg_state = NULL;
 		return 0;
 	}
 
-out_libusbg:
 	return -1;
 }
+
+int gt_backend_load(enum gt_command_scope scope, const char *name)
+{
+	usbg_state *s = NULL;
+	int r;
+
+	if (scope == GT_SCOPE_NONE)
+		return 0;
+
+	if ((backend_ctx.backend_type != GT_BACKEND_LIBUSBG
+	     && backend_ctx.backend_type != GT_BACKEND_CONFIGFS)
+	    || backend_ctx.libusbg_state != NULL)
+		return 0;
+
+	r = GT_TRACE("usbg", gt_settings.configfs_path, usbg_init,
+		     gt_settings.configfs_path, &s);
+	if (r != USBG_SUCCESS) {
+		fprintf(stderr, "Unable to initialize libusbg backend_type: %s\n", usbg_strerror(r));
+		return -1;
+	}
+
+	backend_ctx.libusbg_state = s;
+	return 0;
+}
+
+void gt_backend_unload(void)
+{
+	if ((backend_ctx.backend_type != GT_BACKEND_LIBUSBG
+	     && backend_ctx.backend_type != GT_BACKEND_CONFIGFS)
+	    || backend_ctx.libusbg_state == NULL)
+		return;
+
+	usbg_cleanup(backend_ctx.libusbg_state);
+	backend_ctx.libusbg_state = NULL;
+}
+
+#ifdef WITH_GADGETD
+GVariant *gt_dbus_connection_call_sync(GDBusConnection *conn,
+				       const gchar *bus_name,
+				       const gchar *object_path,
+				       const gchar *interface_name,
+				       const gchar *method_name,
+				       GVariant *parameters,
+				       const GVariantType *reply_type,
+				       GDBusCallFlags flags,
+				       gint timeout_msec,
+				       GCancellable *cancellable,
+				       GError **error)
+{
+	long long start = gt_trace_now();
+	GVariant *ret;
+
+	ret = g_dbus_connection_call_sync(conn, bus_name, object_path,
+					  interface_name, method_name,
+					  parameters, reply_type, flags,
+					  timeout_msec, cancellable, error);
+
+	gt_trace_event("dbus", method_name, object_path, start,
+		       error && *error ? (*error)->code : 0);
+
+	return ret;
+}
+#endif
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file batch.c
+ * @brief Implementation of batch command, which executes gt commands read
+ * from file or standard input in a single process.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <getopt.h>
+
+#include "batch.h"
+#include "common.h"
+#include "parser.h"
+
+int gt_batch_help(void *data)
+{
+	printf("usage: %s batch [options]\n"
+	       "Execute gt commands read from file or standard input, one command per line.\n"
+	       "Backend state and settings are shared by all commands.\n"
+	       "\n"
+	       "Options:\n"
+	       "  -f, --file=<file>\tread commands from file\n"
+	       "  --stdin\t\tread commands from standard input\n"
+	       "  -k, --keep-going\tcontinue after failed command\n"
+	       "  -q, --quiet\t\treport only failed commands\n"
+	       "  -h, --help\t\tPrint this help\n",
+	       program_name);
+
+	return -1;
+}
+
+int gt_batch_split_line(char *line, char ***argv)
+{
+	char **res;
+	char *src, *dst;
+	char quote;
+	int argc = 0;
+	int size = 8;
+
+	res = calloc(size, sizeof(*res));
+	if (res == NULL)
+		return -1;
+
+	res[argc++] = program_name;
+	src = dst = line;
+
+	while (1) {
+		while (isspace(*src))
+			src++;
+
+		if (*src == '\0' || *src == '#')
+			break;
+
+		if (argc + 1 >= size) {
+			char **tmp;
+
+			size *= 2;
+			tmp = realloc(res, size * sizeof(*res));
+			if (tmp == NULL)
+				goto err;
+			res = tmp;
+		}
+
+		res[argc++] = dst;
+		quote = 0;
+
+		for (; *src; src++) {
+			if (quote) {
+				if (*src == quote) {
+					quote = 0;
+					continue;
+				}
+				if (quote == '"' && *src == '\\' && src[1])
+					src++;
+			} else if (*src == '\'' || *src == '"') {
+				quote = *src;
+				continue;
+			} else if (*src == '\\' && src[1]) {
+				src++;
+			} else if (isspace(*src)) {
+				break;
+			}
+
+			*dst++ = *src;
+		}
+
+		if (quote) {
+			fprintf(stderr, "Unterminated quoted string\n");
+			goto err;
+		}
+
+		if (*src)
+			src++;
+		*dst++ = '\0';
+	}
+
+	res[argc] = NULL;
+	*argv = res;
+	return argc;
+err:
+	free(res);
+	return -1;
+}
+
+static int gt_batch_func(void *data)
+{
+	struct gt_batch_data *dt;
+	ExecutableCommand cmd;
+	const char *name;
+	char *line = NULL;
+	size_t len = 0;
+	char **argv;
+	int argc;
+	int lineno = 0;
+	int executed = 0;
+	int failed = 0;
+	int ret;
+	FILE *fp;
+
+	dt = (struct gt_batch_data *)data;
+
+	if (dt->opts & GT_STDIN) {
+		fp = stdin;
+		name = "stdin";
+	} else {
+		fp = fopen(dt->file, "r");
+		if (fp == NULL) {
+			perror("Error opening file");
+			return -1;
+		}
+		name = dt->file;
+	}
+
+	while (getline(&line, &len, fp) >= 0) {
+		lineno++;
+
+		argc = gt_batch_split_line(line, &argv);
+		if (argc < 0) {
+			fprintf(stderr, "%s:%d: failed\n", name, lineno);
+			failed++;
+			if (dt->opts & GT_KEEP_GOING)
+				continue;
+			break;
+		}
+
+		/* empty line or comment */
+		if (argc == 1) {
+			free(argv);
+			continue;
+		}
+
+		if (streq(argv[1], "batch")) {
+			fprintf(stderr, "%s:%d: batch cannot be nested\n",
+				name, lineno);
+			ret = -1;
+		} else {
+			gt_parse_commands(argc, argv, &cmd);
+			ret = executable_command_exec(&cmd);
+			executable_command_clean(&cmd);
+		}
+
+		free(argv);
+		executed++;
+
+		/* Make sure that command output precedes its status */
+		fflush(stdout);
+
+		if (ret != 0) {
+			fprintf(stderr, "%s:%d: failed (%d)\n", name, lineno, ret);
+			failed++;
+			if (!(dt->opts & GT_KEEP_GOING))
+				break;
+		} else if (!(dt->opts & GT_QUIET)) {
+			fprintf(stderr, "%s:%d: ok\n", name, lineno);
+		}
+	}
+
+	free(line);
+	if (fp != stdin)
+		fclose(fp);
+
+	if (!(dt->opts & GT_QUIET))
+		fprintf(stderr, "%d commands executed, %d failed\n",
+			executed, failed);
+
+	return failed ? -1 : 0;
+}
+
+void gt_batch_parse(const Command *cmd, int argc, char **argv,
+		ExecutableCommand *exec, void *data)
+{
+	struct gt_batch_data *dt;
+	int c;
+	struct option opts[] = {
+		{"file", required_argument, 0, 'f'},
+		{"stdin", no_argument, 0, 1},
+		{"keep-going", no_argument, 0, 'k'},
+		{"quiet", no_argument, 0, 'q'},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	dt = zalloc(sizeof(*dt));
+	if (dt == NULL)
+		goto out;
+	argv--;
+	argc++;
+	while (1) {
+		int opt_index = 0;
+		c = getopt_long(argc, argv, "f:kqh", opts, &opt_index);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'f':
+			if (dt->opts & GT_STDIN)
+				goto out;
+			dt->file = optarg;
+			break;
+		case 1:
+			if (dt->file)
+				goto out;
+			dt->opts |= GT_STDIN;
+			break;
+		case 'k':
+			dt->opts |= GT_KEEP_GOING;
+			break;
+		case 'q':
+			dt->opts |= GT_QUIET;
+			break;
+		case 'h':
+			goto out;
+			break;
+		default:
+			goto out;
+		}
+	}
+
+	if (optind < argc)
+		goto out;
+
+	if (!dt->file && !(dt->opts & GT_STDIN))
+		goto out;
+
+	executable_command_set(exec, gt_batch_func, (void *)dt, free);
+	return;
+out:
+	free(dt);
+	executable_command_set(exec, cmd->printHelp, data, NULL);
+}
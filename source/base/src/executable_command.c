@@ -22,6 +22,8 @@
 #include <stdlib.h>
 
 #include "executable_command.h"
+#include "backend.h"
+#include "trace.h"
 
 void executable_command_set(ExecutableCommand *to_set, ExecutableFunc exec,
 			    void *data, CleanupFunc destructor)
@@ -30,6 +32,20 @@ void executable_command_set(ExecutableCommand *to_set, ExecutableFunc exec,
 		to_set->exec = exec;
 		to_set->data = data;
 		to_set->destructor = destructor;
+		to_set->scope = GT_SCOPE_NONE;
+		to_set->scope_name = NULL;
+	}
+}
+
+void executable_command_set_scope(ExecutableCommand *to_set,
+		enum gt_command_scope scope, const char *name)
+{
+	if (to_set) {
+		if (scope == GT_SCOPE_GADGET && name == NULL)
+			scope = GT_SCOPE_ALL;
+
+		to_set->scope = scope;
+		to_set->scope_name = name;
 	}
 }
 
@@ -42,10 +58,26 @@ void executable_command_clean(ExecutableCommand *to_clean)
 		to_clean->exec = NULL;
 		to_clean->data = NULL;
 		to_clean->destructor = NULL;
+		to_clean->scope = GT_SCOPE_NONE;
+		to_clean->scope_name = NULL;
 	}
 }
 
 int executable_command_exec(ExecutableCommand *cmd)
 {
-	return (cmd && cmd->exec) ? cmd->exec(cmd->data) : -1;
+	long long start;
+	int ret;
+
+	if (!cmd || !cmd->exec)
+		return -1;
+
+	if (GT_TRACE("gt", cmd->scope_name, gt_backend_load,
+		     cmd->scope, cmd->scope_name) < 0)
+		return -1;
+
+	start = gt_trace_now();
+	ret = cmd->exec(cmd->data);
+	gt_trace_event("gt", "exec", cmd->scope_name, start, ret);
+
+	return ret;
 }
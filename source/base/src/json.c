@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+
+int gt_json_init(struct gt_json *j)
+{
+	memset(j, 0, sizeof(*j));
+	j->fp = open_memstream(&j->buf, &j->size);
+
+	return j->fp ? 0 : -1;
+}
+
+int gt_json_flush(struct gt_json *j, FILE *out)
+{
+	int ret = 0;
+
+	fputc('\n', j->fp);
+	if (fclose(j->fp) != 0)
+		ret = -1;
+	else if (fwrite(j->buf, 1, j->size, out) != j->size)
+		ret = -1;
+
+	free(j->buf);
+	memset(j, 0, sizeof(*j));
+	return ret;
+}
+
+void gt_json_free(struct gt_json *j)
+{
+	fclose(j->fp);
+	free(j->buf);
+	memset(j, 0, sizeof(*j));
+}
+
+static void json_escape(FILE *fp, const char *str)
+{
+	fputc('"', fp);
+	for (; *str; str++) {
+		switch (*str) {
+		case '"':
+			fputs("\\\"", fp);
+			break;
+		case '\\':
+			fputs("\\\\", fp);
+			break;
+		case '\n':
+			fputs("\\n", fp);
+			break;
+		case '\t':
+			fputs("\\t", fp);
+			break;
+		default:
+			if ((unsigned char)*str < 0x20)
+				fprintf(fp, "\\u%04x", *str);
+			else
+				fputc(*str, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+static void json_key(struct gt_json *j, const char *key)
+{
+	if (j->count[j->depth]++)
+		fputc(',', j->fp);
+
+	if (key) {
+		json_escape(j->fp, key);
+		fputc(':', j->fp);
+	}
+}
+
+static void json_begin(struct gt_json *j, const char *key, char c)
+{
+	json_key(j, key);
+	fputc(c, j->fp);
+	if (j->depth < GT_JSON_MAX_DEPTH - 1)
+		j->count[++j->depth] = 0;
+}
+
+static void json_end(struct gt_json *j, char c)
+{
+	if (j->depth > 0)
+		j->depth--;
+	fputc(c, j->fp);
+}
+
+void gt_json_begin_object(struct gt_json *j, const char *key)
+{
+	json_begin(j, key, '{');
+}
+
+void gt_json_end_object(struct gt_json *j)
+{
+	json_end(j, '}');
+}
+
+void gt_json_begin_array(struct gt_json *j, const char *key)
+{
+	json_begin(j, key, '[');
+}
+
+void gt_json_end_array(struct gt_json *j)
+{
+	json_end(j, ']');
+}
+
+void gt_json_string(struct gt_json *j, const char *key, const char *val)
+{
+	json_key(j, key);
+	if (val)
+		json_escape(j->fp, val);
+	else
+		fputs("null", j->fp);
+}
+
+void gt_json_int(struct gt_json *j, const char *key, long long val)
+{
+	json_key(j, key);
+	fprintf(j->fp, "%lld", val);
+}
+
+void gt_json_bool(struct gt_json *j, const char *key, int val)
+{
+	json_key(j, key);
+	fputs(val ? "true" : "false", j->fp);
+}
+
+void gt_json_setting(struct gt_json *j, const char *key,
+		const config_setting_t *s)
+{
+	int i, n;
+
+	switch (config_setting_type(s)) {
+	case CONFIG_TYPE_INT:
+	case CONFIG_TYPE_INT64:
+		gt_json_int(j, key, config_setting_get_int64(s));
+		break;
+	case CONFIG_TYPE_FLOAT:
+		json_key(j, key);
+		fprintf(j->fp, "%g", config_setting_get_float(s));
+		break;
+	case CONFIG_TYPE_BOOL:
+		gt_json_bool(j, key, config_setting_get_bool(s));
+		break;
+	case CONFIG_TYPE_STRING:
+		gt_json_string(j, key, config_setting_get_string(s));
+		break;
+	case CONFIG_TYPE_GROUP:
+		gt_json_begin_object(j, key);
+		n = config_setting_length(s);
+		for (i = 0; i < n; i++) {
+			const config_setting_t *m = config_setting_get_elem(s, i);
+
+			gt_json_setting(j, config_setting_name(m), m);
+		}
+		gt_json_end_object(j);
+		break;
+	case CONFIG_TYPE_LIST:
+	case CONFIG_TYPE_ARRAY:
+		gt_json_begin_array(j, key);
+		n = config_setting_length(s);
+		for (i = 0; i < n; i++)
+			gt_json_setting(j, NULL, config_setting_get_elem(s, i));
+		gt_json_end_array(j);
+		break;
+	}
+}
@@ -27,6 +27,8 @@
 #include "configuration.h"
 #include "function.h"
 #include "settings.h"
+#include "batch.h"
+#include "daemon.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,12 +40,14 @@
 
 int gt_global_help(void *data)
 {
-	printf("Usage: %s {OBJECT} [COMMAND]\n"
+	printf("Usage: %s [--root=<path>] [--trace=<file>] {OBJECT} [COMMAND]\n"
 	       "Object is either implicit (if not specified) or explicit:\n"
 	       "  udc\n"
 	       "  settings\n"
 	       "  config\n"
 	       "  func\n"
+	       "  batch\n"
+	       "  daemon\n"
 	       "Implicit gadget commands:\n"
 	       "  create\n"
 	       "  rm\n"
@@ -54,9 +58,20 @@ int gt_global_help(void *data)
 	       "  template\n"
 	       "  load\n"
 	       "  save\n"
+	       "  apply\n"
+	       "  diff\n"
+	       "  compile\n"
+	       "  replay\n"
+	       "  pool\n"
+	       "  switch\n"
 	       "Most commands recognize 'help' argument to display usage information, eg.\n"
 	       "  create help\n"
-	       "  func get help\n",
+	       "  func get help\n"
+	       "Options:\n"
+	       "  --root=<path>\tUse configfs mounted at path, overrides\n"
+	       "\t\t" GT_CONFIGFS_PATH_ENV " and configfs-path setting\n"
+	       "  --trace=<file>\tWrite timing of configfs, libusbg and D-Bus\n"
+	       "\t\tcalls to file as trace event JSON\n",
 	       program_name);
 
 	return 0;
@@ -65,10 +80,12 @@ int gt_global_help(void *data)
 static inline const Command *gt_get_command_root_children(const Command *cmd)
 {
 	static Command commands[] = {
-		{ "udc", NEXT, udc_parse, NULL, udc_help_func },
+		{ "udc", NEXT, command_parse, gt_udc_get_children, udc_help_func },
 		{ "settings", NEXT, command_parse, gt_settings_get_children, gt_settings_help },
 		{ "config", NEXT, command_parse, gt_config_get_children, gt_config_help },
 		{ "func", NEXT, command_parse, gt_func_get_children, gt_func_help },
+		{ "batch", NEXT, gt_batch_parse, NULL, gt_batch_help },
+		{ "daemon", NEXT, gt_daemon_parse, NULL, gt_daemon_help },
 		{ NULL, AGAIN, command_parse, get_gadget_children, gt_global_help },
 		CMD_LIST_END
 	};
@@ -91,6 +108,10 @@ void gt_parse_commands(int argc, char **argv, ExecutableCommand *exec)
 		NULL, AGAIN, command_parse, gt_get_command_root, gt_global_help
 	};
 
+	/* Commands may be parsed more than once in a single process (batch),
+	 * so getopt has to be reinitialized each time */
+	optind = 0;
+
 	command_pre_root.parse(&command_pre_root, argc, argv, exec, NULL);
 }
 
@@ -193,6 +214,7 @@ int gt_get_options(int *optmask, int allowed_opts, int argc, char **argv)
 		{GT_TYPE, {"type", no_argument, 0, 4}},
 		{GT_NAME, {"name", no_argument, 0, 5}},
 		{GT_ID, {"id", no_argument, 0, 6}},
+		{GT_JSON, {"json", no_argument, 0, 7}},
 		{0, {NULL, 0, 0, 0}}
 	};
 
@@ -261,6 +283,9 @@ int gt_get_options(int *optmask, int allowed_opts, int argc, char **argv)
 		case 6:
 			*optmask |= GT_ID;
 			break;
+		case 7:
+			*optmask |= GT_JSON;
+			break;
 		default:
 			return -1;
 		}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "trace.h"
+#include "json.h"
+
+int gt_trace_enabled;
+
+static struct {
+	struct gt_json json;
+	char *file;
+	int pid;
+} trace;
+
+long long gt_trace_now(void)
+{
+	struct timespec ts;
+
+	if (!gt_trace_enabled)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void gt_trace_event(const char *cat, const char *name, const char *path,
+		long long start, long long ret)
+{
+	struct gt_json *j = &trace.json;
+	int err = errno;
+
+	if (!gt_trace_enabled)
+		return;
+
+	gt_json_begin_object(j, NULL);
+	gt_json_string(j, "name", name);
+	gt_json_string(j, "cat", cat);
+	gt_json_string(j, "ph", "X");
+	gt_json_int(j, "ts", start);
+	gt_json_int(j, "dur", gt_trace_now() - start);
+	gt_json_int(j, "pid", trace.pid);
+	gt_json_int(j, "tid", syscall(SYS_gettid));
+	gt_json_begin_object(j, "args");
+	if (path)
+		gt_json_string(j, "path", path);
+	gt_json_int(j, "ret", ret);
+	gt_json_end_object(j);
+	gt_json_end_object(j);
+
+	/* callers report errno of traced call */
+	errno = err;
+}
+
+int gt_trace_open(const char *file)
+{
+	if (gt_trace_enabled)
+		return 0;
+
+	trace.file = strdup(file);
+	if (!trace.file || gt_json_init(&trace.json) < 0) {
+		free(trace.file);
+		return -1;
+	}
+
+	trace.pid = getpid();
+	gt_json_begin_object(&trace.json, NULL);
+	gt_json_string(&trace.json, "displayTimeUnit", "ms");
+	gt_json_begin_array(&trace.json, "traceEvents");
+	gt_trace_enabled = 1;
+
+	/* Commands may end with exit(), so write events from handler */
+	atexit(gt_trace_close);
+
+	return 0;
+}
+
+void gt_trace_close(void)
+{
+	FILE *fp;
+	int ret;
+
+	if (!gt_trace_enabled)
+		return;
+
+	gt_trace_enabled = 0;
+	gt_json_end_array(&trace.json);
+	gt_json_end_object(&trace.json);
+
+	fp = fopen(trace.file, "w");
+	if (!fp) {
+		gt_json_free(&trace.json);
+		ret = -1;
+	} else {
+		ret = gt_json_flush(&trace.json, fp);
+		if (fclose(fp) != 0)
+			ret = -1;
+	}
+
+	if (ret < 0)
+		fprintf(stderr, "Unable to write trace to %s\n", trace.file);
+
+	free(trace.file);
+	trace.file = NULL;
+}
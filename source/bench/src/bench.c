@@ -0,0 +1,579 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file bench.c
+ * @brief Benchmark of gt backends
+ * @details Executes the same backend functions as gt commands, with
+ * gadget state kept loaded between them as in batch mode, and reports
+ * latency of each kind of operation as JSON. Gadgets are named
+ * bench<N> and removed at the end. Without usb_gadget configfs it can
+ * be run on the configfs emulator:
+ *
+ *     GT_CONFIGFS_PATH=/tmp/cfs LD_PRELOAD=libgt-configfs-emu.so gt-bench
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <usbg/usbg.h>
+
+#include "backend.h"
+#include "common.h"
+#include "parser.h"
+#include "settings.h"
+#include "json.h"
+#include "gadget.h"
+#include "function.h"
+#include "configuration.h"
+
+#define BENCH_PREFIX "bench"
+
+/* commands not implemented by selected backend are executed by libusbg */
+#define BACKEND_FUNC(obj, func) \
+	(backend_ctx.backend->obj->func ? \
+	 backend_ctx.backend->obj->func : \
+	 gt_##obj##_backend_libusbg.func)
+
+char *program_name = "gt-bench";
+
+struct bench_params {
+	int gadgets;
+	int functions;
+	int configs;
+	int iterations;
+	const char *type;
+	const char *udc;
+	const char *file;
+};
+
+struct bench_op {
+	const char *name;
+	uint64_t *ns;
+	int count;
+	int size;
+	uint64_t syscalls;
+};
+
+enum {
+	OP_SCAN,
+	OP_GADGET_CREATE,
+	OP_FUNC_CREATE,
+	OP_CONFIG_CREATE,
+	OP_CONFIG_ADD,
+	OP_SET,
+	OP_GET,
+	OP_ENABLE,
+	OP_DISABLE,
+	OP_SAVE,
+	OP_LOAD,
+	OP_RM,
+	OP_COUNT,
+};
+
+static struct bench_op ops[OP_COUNT] = {
+	[OP_SCAN] = { .name = "scan" },
+	[OP_GADGET_CREATE] = { .name = "create" },
+	[OP_FUNC_CREATE] = { .name = "func create" },
+	[OP_CONFIG_CREATE] = { .name = "config create" },
+	[OP_CONFIG_ADD] = { .name = "config add" },
+	[OP_SET] = { .name = "set" },
+	[OP_GET] = { .name = "get" },
+	[OP_ENABLE] = { .name = "enable" },
+	[OP_DISABLE] = { .name = "disable" },
+	[OP_SAVE] = { .name = "save" },
+	[OP_LOAD] = { .name = "load" },
+	[OP_RM] = { .name = "rm" },
+};
+
+/* counts syscalls of this process, -1 if not permitted */
+static int syscall_fd = -1;
+
+static struct gt_setting no_attrs[] = {
+	{ NULL, NULL },
+};
+
+/**
+ * @brief Open counter of raw_syscalls:sys_enter tracepoint
+ */
+static int syscall_counter(void)
+{
+	static const char *paths[] = {
+		"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+		"/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id",
+	};
+	struct perf_event_attr attr;
+	FILE *fp = NULL;
+	int id = -1;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(paths) && fp == NULL; i++)
+		fp = fopen(paths[i], "r");
+	if (fp == NULL)
+		return -1;
+
+	if (fscanf(fp, "%d", &id) != 1)
+		id = -1;
+	fclose(fp);
+	if (id < 0)
+		return -1;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_TRACEPOINT;
+	attr.size = sizeof(attr);
+	attr.config = id;
+
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+static uint64_t syscalls_now(void)
+{
+	uint64_t val = 0;
+
+	if (syscall_fd >= 0 && read(syscall_fd, &val, sizeof(val)) != sizeof(val))
+		val = 0;
+
+	return val;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Execute backend function and record its duration
+ * @details Syscalls made by counter itself (read) are not subtracted,
+ * they add constant 1 to each operation.
+ */
+static int run(int op, int (*func)(void *), void *data)
+{
+	struct bench_op *o = &ops[op];
+	uint64_t start, calls;
+	uint64_t *ns;
+	int ret;
+
+	if (gt_backend_load(GT_SCOPE_ALL, NULL) < 0)
+		return -1;
+
+	if (o->count == o->size) {
+		ns = realloc(o->ns, (o->size ? o->size * 2 : 64) * sizeof(*ns));
+		if (ns == NULL)
+			return -1;
+		o->ns = ns;
+		o->size = o->size ? o->size * 2 : 64;
+	}
+
+	calls = syscalls_now();
+	start = now_ns();
+	ret = func(data);
+	o->ns[o->count++] = now_ns() - start;
+	o->syscalls += syscalls_now() - calls;
+
+	if (ret != 0)
+		fprintf(stderr, "%s failed\n", o->name);
+
+	return ret;
+}
+
+/**
+ * @brief Scan configfs again, as each gt command does
+ */
+static int scan_func(void *data)
+{
+	gt_backend_unload();
+	return gt_backend_load(GT_SCOPE_ALL, NULL);
+}
+
+static void gadget_name(char *buf, size_t size, int i)
+{
+	snprintf(buf, size, BENCH_PREFIX "%d", i);
+}
+
+static int rm_gadget(const char *name)
+{
+	struct gt_gadget_rm_data rm = {
+		.name = name,
+		.opts = GT_FORCE | GT_RECURSIVE,
+	};
+
+	return run(OP_RM, BACKEND_FUNC(gadget, rm), &rm);
+}
+
+/**
+ * @brief Remove gadgets left by interrupted run, without measuring it
+ */
+static int remove_leftovers(const struct bench_params *p)
+{
+	struct gt_gadget_rm_data rm = { .opts = GT_FORCE | GT_RECURSIVE };
+	char name[32];
+	int i;
+
+	if (gt_backend_load(GT_SCOPE_ALL, NULL) < 0)
+		return -1;
+
+	for (i = 0; i < p->gadgets; i++) {
+		gadget_name(name, sizeof(name), i);
+		rm.name = name;
+		if (usbg_get_gadget(backend_ctx.libusbg_state, name)
+		    && gt_gadget_backend_libusbg.rm(&rm) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int create_gadget(const struct bench_params *p, const char *name)
+{
+	struct gt_gadget_create_data gadget = { .name = name };
+	struct gt_func_create_data func = {
+		.gadget = name,
+		.type = p->type,
+		.attrs = no_attrs,
+	};
+	struct gt_config_create_data config = {
+		.gadget = name,
+		.config_label = "c",
+		.attrs = no_attrs,
+	};
+	struct gt_config_add_del_data add = {
+		.gadget = name,
+		.config_label = "c",
+		.type = p->type,
+	};
+	char instance[16];
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(gadget.attr_val); i++)
+		gadget.attr_val[i] = -1;
+
+	if (run(OP_GADGET_CREATE, BACKEND_FUNC(gadget, create), &gadget) < 0)
+		return -1;
+
+	for (i = 0; i < p->functions; i++) {
+		snprintf(instance, sizeof(instance), "f%d", i);
+		func.name = instance;
+		if (run(OP_FUNC_CREATE, BACKEND_FUNC(function, create), &func) < 0)
+			return -1;
+	}
+
+	for (j = 1; j <= p->configs; j++) {
+		config.config_id = j;
+		if (run(OP_CONFIG_CREATE, BACKEND_FUNC(config, create),
+			&config) < 0)
+			return -1;
+
+		add.config_id = j;
+		for (i = 0; i < p->functions; i++) {
+			snprintf(instance, sizeof(instance), "f%d", i);
+			add.instance = instance;
+			if (run(OP_CONFIG_ADD, BACKEND_FUNC(config, add), &add) < 0)
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int bench_attrs(const struct bench_params *p, const char *name)
+{
+	struct gt_gadget_set_data set = { .name = name };
+	struct gt_gadget_get_data get = { .name = name };
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(set.attr_val); i++) {
+		set.attr_val[i] = -1;
+		get.attrs[i] = 1;
+	}
+
+	for (i = 0; i < p->iterations; i++) {
+		set.attr_val[USBG_ID_PRODUCT] = i & 0xffff;
+		if (run(OP_SET, BACKEND_FUNC(gadget, set), &set) < 0
+		    || run(OP_GET, BACKEND_FUNC(gadget, get), &get) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int bench_enable(const struct bench_params *p, const char *name)
+{
+	struct gt_gadget_enable_data enable = {
+		.gadget = name,
+		.udc = p->udc,
+	};
+	struct gt_gadget_disable_data disable = { .gadget = name };
+	int i;
+
+	for (i = 0; i < p->iterations; i++) {
+		if (run(OP_ENABLE, BACKEND_FUNC(gadget, enable), &enable) < 0
+		    || run(OP_DISABLE, BACKEND_FUNC(gadget, disable), &disable) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int bench_save_load(const struct bench_params *p, const char *name)
+{
+	struct gt_gadget_save_data save = {
+		.gadget = name,
+		.file = p->file,
+		.opts = GT_FORCE,
+	};
+	struct gt_gadget_load_data load = {
+		.gadget_name = name,
+		.file = p->file,
+		.opts = GT_OFF,
+	};
+	int i;
+
+	for (i = 0; i < p->iterations; i++) {
+		if (run(OP_SAVE, BACKEND_FUNC(gadget, save), &save) < 0
+		    || rm_gadget(name) < 0
+		    || run(OP_LOAD, BACKEND_FUNC(gadget, load), &load) < 0)
+			return -1;
+	}
+
+	unlink(p->file);
+	return 0;
+}
+
+static int u64_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(const struct bench_op *o, int pct)
+{
+	int i = (o->count * pct + 99) / 100 - 1;
+
+	return o->ns[i < 0 ? 0 : i];
+}
+
+static int report(const struct bench_params *p, uint64_t wall, FILE *out)
+{
+	struct gt_json j;
+	struct bench_op *o;
+	uint64_t total;
+	int i, k;
+
+	if (gt_json_init(&j) < 0)
+		return -1;
+
+	gt_json_begin_object(&j, NULL);
+	gt_json_begin_object(&j, "params");
+	gt_json_int(&j, "gadgets", p->gadgets);
+	gt_json_int(&j, "functions", p->functions);
+	gt_json_int(&j, "configs", p->configs);
+	gt_json_int(&j, "iterations", p->iterations);
+	gt_json_string(&j, "type", p->type);
+	gt_json_string(&j, "configfs", gt_settings.configfs_path);
+	gt_json_string(&j, "backend",
+		       backend_ctx.backend_type == GT_BACKEND_CONFIGFS ?
+		       "configfs" : "libusbg");
+	gt_json_end_object(&j);
+	gt_json_int(&j, "wall_ns", wall);
+
+	gt_json_begin_array(&j, "ops");
+	for (i = 0; i < OP_COUNT; i++) {
+		o = &ops[i];
+		if (o->count == 0)
+			continue;
+
+		qsort(o->ns, o->count, sizeof(*o->ns), u64_cmp);
+		for (total = 0, k = 0; k < o->count; k++)
+			total += o->ns[k];
+
+		gt_json_begin_object(&j, NULL);
+		gt_json_string(&j, "op", o->name);
+		gt_json_int(&j, "count", o->count);
+		gt_json_int(&j, "total_ns", total);
+		gt_json_int(&j, "p50_ns", percentile(o, 50));
+		gt_json_int(&j, "p99_ns", percentile(o, 99));
+		gt_json_int(&j, "max_ns", o->ns[o->count - 1]);
+		gt_json_int(&j, "ops_per_sec",
+			    total ? o->count * 1000000000ULL / total : 0);
+		if (syscall_fd >= 0)
+			gt_json_int(&j, "syscalls_per_op",
+				    o->syscalls / o->count);
+		else
+			gt_json_string(&j, "syscalls_per_op", NULL);
+		gt_json_end_object(&j);
+	}
+	gt_json_end_array(&j);
+	gt_json_end_object(&j);
+
+	return gt_json_flush(&j, out);
+}
+
+static void usage(void)
+{
+	printf("usage: %s [options]\n"
+	       "Creates, modifies and removes gadgets bench<N> with gt backends "
+	       "and prints latency of each operation as JSON.\n"
+	       "\n"
+	       "Options:\n"
+	       "  -g, --gadgets=<n>\tNumber of gadgets (default 10)\n"
+	       "  -f, --functions=<n>\tFunctions in each gadget (default 4)\n"
+	       "  -c, --configs=<n>\tConfigs in each gadget, each function is "
+	       "bound to all of them (default 1)\n"
+	       "  -i, --iterations=<n>\tRepetitions of scan, set/get, "
+	       "enable/disable and save/load cycles (default 10)\n"
+	       "  -t, --type=<type>\tFunction type (default acm)\n"
+	       "  -u, --udc=<udc>\tUDC for enable cycles, they are skipped "
+	       "if set to none\n"
+	       "  -h, --help\tPrint this help\n",
+	       program_name);
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_params p = {
+		.gadgets = 10,
+		.functions = 4,
+		.configs = 1,
+		.iterations = 10,
+		.type = "acm",
+	};
+	struct option opts[] = {
+		{"gadgets", required_argument, 0, 'g'},
+		{"functions", required_argument, 0, 'f'},
+		{"configs", required_argument, 0, 'c'},
+		{"iterations", required_argument, 0, 'i'},
+		{"type", required_argument, 0, 't'},
+		{"udc", required_argument, 0, 'u'},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
+	char file[PATH_MAX];
+	char name[32];
+	const char *root;
+	uint64_t start;
+	FILE *out;
+	int ret = -1;
+	int c, i;
+
+	while ((c = getopt_long(argc, argv, "g:f:c:i:t:u:h", opts, NULL)) != -1) {
+		switch (c) {
+		case 'g':
+			p.gadgets = atoi(optarg);
+			break;
+		case 'f':
+			p.functions = atoi(optarg);
+			break;
+		case 'c':
+			p.configs = atoi(optarg);
+			break;
+		case 'i':
+			p.iterations = atoi(optarg);
+			break;
+		case 't':
+			p.type = optarg;
+			break;
+		case 'u':
+			p.udc = optarg;
+			break;
+		case 'h':
+			usage();
+			return 0;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	if (optind < argc || p.gadgets < 1 || p.functions < 0
+	    || p.configs < 0 || p.iterations < 0) {
+		usage();
+		return 1;
+	}
+
+	root = getenv(GT_CONFIGFS_PATH_ENV);
+	if (root)
+		gt_settings.configfs_path = root;
+
+	snprintf(file, sizeof(file), "/tmp/gt-bench.%d.scheme", (int)getpid());
+	p.file = file;
+
+	if (gt_backend_init("gt", 0) < 0)
+		return 1;
+
+	/* commands print their output, only report goes to stdout */
+	out = fdopen(dup(STDOUT_FILENO), "w");
+	if (out == NULL || freopen("/dev/null", "w", stdout) == NULL) {
+		perror("Error redirecting output");
+		return 1;
+	}
+
+	syscall_fd = syscall_counter();
+	start = now_ns();
+
+	if (remove_leftovers(&p) < 0)
+		goto out;
+
+	for (i = 0; i < p.gadgets; i++) {
+		gadget_name(name, sizeof(name), i);
+		if (create_gadget(&p, name) < 0)
+			goto cleanup;
+	}
+
+	for (i = 0; i < p.iterations; i++)
+		if (run(OP_SCAN, scan_func, NULL) < 0)
+			goto cleanup;
+
+	gadget_name(name, sizeof(name), 0);
+	if (bench_attrs(&p, name) < 0)
+		goto cleanup;
+
+	if ((p.udc == NULL || !streq(p.udc, "none"))
+	    && bench_enable(&p, name) < 0)
+		goto cleanup;
+
+	if (bench_save_load(&p, name) < 0)
+		goto cleanup;
+
+	ret = 0;
+cleanup:
+	for (i = 0; i < p.gadgets; i++) {
+		gadget_name(name, sizeof(name), i);
+		if (gt_backend_load(GT_SCOPE_ALL, NULL) == 0
+		    && usbg_get_gadget(backend_ctx.libusbg_state, name)
+		    && rm_gadget(name) < 0)
+			ret = -1;
+	}
+
+	if (ret == 0)
+		ret = report(&p, now_ns() - start, out);
+out:
+	gt_backend_unload();
+	fclose(out);
+	return ret < 0 ? 1 : 0;
+}
@@ -20,6 +20,7 @@
 #include <usbg/usbg.h>
 
 #include "command.h"
+#include "json.h"
 
 /**
  * An interface that backends need to implement. Not implemented functions
@@ -194,6 +195,14 @@ int gt_config_help(void *data);
  */
 int gt_print_config_libusbg(usbg_config *c, int opts);
 
+/**
+ * @brief Add config with its attributes and bindings to JSON document
+ * @param[in] j JSON document
+ * @param[in] c Config to be added
+ * @return 0 on success, -1 otherwise
+ */
+int gt_json_config_libusbg(struct gt_json *j, usbg_config *c);
+
 #ifdef WITH_GADGETD
 extern struct gt_config_backend gt_config_backend_gadgetd;
 #endif
@@ -98,6 +98,7 @@ static void gt_parse_config_create(const Command *cmd, int argc, char **argv,
 
 	executable_command_set(exec, GET_EXECUTABLE(create),
 			       (void *)dt, gt_config_create_destructor);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 	return;
 
 out:
@@ -142,6 +143,7 @@ static void gt_parse_config_rm(const Command *cmd, int argc, char **argv,
 	if (dt->config_id == 0 || errno || (endptr && *endptr != 0))
 			goto out;
 	executable_command_set(exec, GET_EXECUTABLE(rm), (void *)dt, free);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 
 	return;
 out:
@@ -198,6 +200,7 @@ static void gt_parse_config_get(const Command *cmd, int argc, char **argv,
 
 	executable_command_set(exec, GET_EXECUTABLE(get), (void *)dt,
 			gt_config_get_destructor);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 	return;
 out:
 	gt_config_get_destructor((void *)dt);
@@ -248,6 +251,7 @@ static void gt_parse_config_set(const Command *cmd, int argc, char **argv,
 
 	executable_command_set(exec, GET_EXECUTABLE(set), (void *)dt,
 			gt_config_set_destructor);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 	return;
 out:
 	gt_config_set_destructor((void *)dt);
@@ -287,6 +291,7 @@ static int gt_config_show_help(void *data)
 	       "  -r, --recursive\tShow details about functions\n"
 	       "  --name\tShow only config names (cannot be used with --id\n"
 	       "  --id\t\tShow only config ids (cannot be used with  --name)\n"
+	       "  --json\tShow configurations with details as JSON document\n"
 	       "  -h, --help\tPrint this help\n");
 
 	return -1;
@@ -297,7 +302,8 @@ static void gt_parse_config_show(const Command *cmd, int argc, char **argv,
 {
 	int ind;
 	struct gt_config_show_data *dt = NULL;
-	int avaible_opts = GT_VERBOSE | GT_RECURSIVE | GT_HELP | GT_NAME | GT_ID;
+	int avaible_opts = GT_VERBOSE | GT_RECURSIVE | GT_HELP | GT_NAME | GT_ID
+		| GT_JSON;
 	char *endptr = NULL;
 
 	dt = zalloc(sizeof(*dt));
@@ -322,6 +328,7 @@ static void gt_parse_config_show(const Command *cmd, int argc, char **argv,
 	}
 
 	executable_command_set(exec, GET_EXECUTABLE(show), (void *)dt, free);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 
 	return;
 out:
@@ -383,6 +390,7 @@ static void gt_parse_config_add(const Command *cmd, int argc, char **argv,
 	}
 
 	executable_command_set(exec, GET_EXECUTABLE(add), (void *)dt, free);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 
 	return;
 out:
@@ -441,6 +449,7 @@ static void gt_parse_config_del(const Command *cmd, int argc, char **argv,
 
 
 	executable_command_set(exec, GET_EXECUTABLE(del), (void *)dt, free);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 
 	return;
 out:
@@ -714,6 +723,7 @@ static void gt_parse_config_load(const Command *cmd, int argc,
 		dt->config = argv[optind++];
 
 	executable_command_set(exec, GET_EXECUTABLE(load), (void *)dt, free);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 
 	return;
 out:
@@ -808,6 +818,7 @@ static void gt_parse_config_save(const Command *cmd, int argc,
 
 	executable_command_set(exec, GET_EXECUTABLE(save), (void *)dt,
 			gt_config_save_destructor);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 
 	return;
 out:
@@ -36,18 +36,18 @@ static int create_func(void *data)
 	_cleanup_g_free_ gchar *path = NULL;
 	_cleanup_g_free_ gchar *out_config_path = NULL;
 
-	gret = g_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
-					   "org.usb.gadgetd",
-					   "/org/usb/Gadget",
-					   "org.usb.device.GadgetManager",
-					   "FindGadgetByName",
-					   g_variant_new ("(s)",
-							  dt->gadget),
-					   NULL,
-					   G_DBUS_CALL_FLAGS_NONE,
-					   -1,
-					   NULL,
-					   &error);
+	gret = gt_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
+					    "org.usb.gadgetd",
+					    "/org/usb/Gadget",
+					    "org.usb.device.GadgetManager",
+					    "FindGadgetByName",
+					    g_variant_new ("(s)",
+							   dt->gadget),
+					    NULL,
+					    G_DBUS_CALL_FLAGS_NONE,
+					    -1,
+					    NULL,
+					    &error);
 
 	if (error) {
 		fprintf(stderr, "Failed to get gadget path, %s\n", error->message);
@@ -57,19 +57,19 @@ static int create_func(void *data)
 	g_variant_get(gret, "(o)", &path);
 	g_variant_unref(gret);
 
-	gret = g_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
-					   "org.usb.gadgetd",
-					   path,
-					   "org.usb.device.Gadget.ConfigManager",
-					   "CreateConfig",
-					   g_variant_new ("(is)",
-							  dt->config_id,
-							  dt->config_label),
-					   NULL,
-					   G_DBUS_CALL_FLAGS_NONE,
-					   -1,
-					   NULL,
-					   &error);
+	gret = gt_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
+					    "org.usb.gadgetd",
+					    path,
+					    "org.usb.device.Gadget.ConfigManager",
+					    "CreateConfig",
+					    g_variant_new ("(is)",
+							   dt->config_id,
+							   dt->config_label),
+					    NULL,
+					    G_DBUS_CALL_FLAGS_NONE,
+					    -1,
+					    NULL,
+					    &error);
 	if (error) {
 		fprintf(stderr, "Unknown error, %s\n", error->message);
 		return -1;
@@ -93,18 +93,18 @@ static int add_func(void *data)
 	GError *error = NULL;
 	gboolean function_added;
 
-	gret = g_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
-					   "org.usb.gadgetd",
-					   "/org/usb/Gadget",
-					   "org.usb.device.GadgetManager",
-					   "FindGadgetByName",
-					   g_variant_new ("(s)",
-							  dt->gadget),
-					   NULL,
-					   G_DBUS_CALL_FLAGS_NONE,
-					   -1,
-					   NULL,
-					   &error);
+	gret = gt_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
+					    "org.usb.gadgetd",
+					    "/org/usb/Gadget",
+					    "org.usb.device.GadgetManager",
+					    "FindGadgetByName",
+					    g_variant_new ("(s)",
+							   dt->gadget),
+					    NULL,
+					    G_DBUS_CALL_FLAGS_NONE,
+					    -1,
+					    NULL,
+					    &error);
 
 	if (error) {
 		fprintf(stderr, "Failed to find gadget, %s\n", error->message);
@@ -114,19 +114,19 @@ static int add_func(void *data)
 	g_variant_get(gret, "(o)", &gpath);
 	g_variant_unref(gret);
 
-	gret = g_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
-					   "org.usb.gadgetd",
-					   gpath,
-					   "org.usb.device.Gadget.FunctionManager",
-					   "FindFunctionByName",
-					   g_variant_new ("(ss)",
-							  dt->type,
-							  dt->instance),
-					   NULL,
-					   G_DBUS_CALL_FLAGS_NONE,
-					   -1,
-					   NULL,
-					   &error);
+	gret = gt_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
+					    "org.usb.gadgetd",
+					    gpath,
+					    "org.usb.device.Gadget.FunctionManager",
+					    "FindFunctionByName",
+					    g_variant_new ("(ss)",
+							   dt->type,
+							   dt->instance),
+					    NULL,
+					    G_DBUS_CALL_FLAGS_NONE,
+					    -1,
+					    NULL,
+					    &error);
 
 	if (error) {
 		fprintf(stderr, "Failed to find function, %s\n", error->message);
@@ -136,19 +136,19 @@ static int add_func(void *data)
 	g_variant_get(gret, "(o)", &fpath);
 	g_variant_unref(gret);
 
-	gret = g_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
-					   "org.usb.gadgetd",
-					   gpath,
-					   "org.usb.device.Gadget.ConfigManager",
-					   "FindConfigByName",
-					   g_variant_new ("(is)",
-							  dt->config_id,
-							  dt->config_label),
-					   NULL,
-					   G_DBUS_CALL_FLAGS_NONE,
-					   -1,
-					   NULL,
-					   &error);
+	gret = gt_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
+					    "org.usb.gadgetd",
+					    gpath,
+					    "org.usb.device.Gadget.ConfigManager",
+					    "FindConfigByName",
+					    g_variant_new ("(is)",
+							   dt->config_id,
+							   dt->config_label),
+					    NULL,
+					    G_DBUS_CALL_FLAGS_NONE,
+					    -1,
+					    NULL,
+					    &error);
 
 	if (error) {
 		fprintf(stderr, "Failed to find config, %s\n", error->message);
@@ -158,17 +158,17 @@ static int add_func(void *data)
 	g_variant_get(gret, "(o)", &cpath);
 	g_variant_unref(gret);
 
-	gret = g_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
-					   "org.usb.gadgetd",
-					   cpath,
-					   "org.usb.device.Gadget.Config",
-					   "AttachFunction",
-					   g_variant_new ("(o)", fpath),
-					   NULL,
-					   G_DBUS_CALL_FLAGS_NONE,
-					   -1,
-					   NULL,
-					   &error);
+	gret = gt_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
+					    "org.usb.gadgetd",
+					    cpath,
+					    "org.usb.device.Gadget.Config",
+					    "AttachFunction",
+					    g_variant_new ("(o)", fpath),
+					    NULL,
+					    G_DBUS_CALL_FLAGS_NONE,
+					    -1,
+					    NULL,
+					    &error);
 
 	if (error) {
 		fprintf(stderr,"Failed to attach function, %s\n", error->message);
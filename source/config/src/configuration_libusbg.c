@@ -23,6 +23,7 @@
 #include "common.h"
 #include "parser.h"
 #include "backend.h"
+#include "trace.h"
 
 static int create_func(void *data)
 {
@@ -41,7 +42,9 @@ static int create_func(void *data)
 		return -1;
 	}
 
-	usbg_ret = usbg_create_config(g, dt->config_id, dt->config_label, NULL, NULL, &c);
+	usbg_ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+			    usbg_create_config, g, dt->config_id,
+			    dt->config_label, NULL, NULL, &c);
 	if (usbg_ret != USBG_SUCCESS) {
 		fprintf(stderr,"Error on config create\n");
 		fprintf(stderr,"Error: %s: %s\n", usbg_error_name(usbg_ret),
@@ -102,7 +105,8 @@ static int add_func(void *data)
 		return -1;
 	}
 
-	usbg_ret = usbg_add_config_function(c, func_name, f);
+	usbg_ret = GT_TRACE("usbg", usbg_get_config_label(c),
+			    usbg_add_config_function, c, func_name, f);
 	if (usbg_ret != USBG_SUCCESS) {
 		fprintf(stderr, "Unable to attach function\n");
 		fprintf(stderr,"Error: %s: %s\n", usbg_error_name(usbg_ret),
@@ -151,7 +155,8 @@ static int del_func(void *data)
 	}
 
 	if (found) {
-		usbg_ret = usbg_rm_binding(found);
+		usbg_ret = GT_TRACE("usbg", usbg_get_binding_name(found),
+				    usbg_rm_binding, found);
 		if (usbg_ret != USBG_SUCCESS) {
 			fprintf(stderr, "Error removing binding\n");
 			return -1;
@@ -229,11 +234,65 @@ int gt_print_config_libusbg(usbg_config *c, int opts)
 	return 0;
 }
 
+int gt_json_config_libusbg(struct gt_json *j, usbg_config *c)
+{
+	struct usbg_config_attrs c_attrs;
+	struct usbg_config_strs c_strs;
+	usbg_binding *b;
+	usbg_function *f;
+	int usbg_ret;
+
+	usbg_ret = usbg_get_config_attrs(c, &c_attrs);
+	if (usbg_ret != USBG_SUCCESS) {
+		fprintf(stderr, "Error: %s : %s\n", usbg_error_name(usbg_ret),
+				usbg_strerror(usbg_ret));
+		return -1;
+	}
+
+	usbg_ret = usbg_get_config_strs(c, LANG_US_ENG, &c_strs);
+	if (usbg_ret != USBG_SUCCESS && usbg_ret != USBG_ERROR_NOT_FOUND) {
+		fprintf(stderr, "Error: %s : %s\n", usbg_error_name(usbg_ret),
+				usbg_strerror(usbg_ret));
+		return -1;
+	}
+
+	gt_json_begin_object(j, NULL);
+	gt_json_string(j, "label", usbg_get_config_label(c));
+	gt_json_int(j, "id", usbg_get_config_id(c));
+
+	gt_json_begin_object(j, "attrs");
+	gt_json_int(j, "bMaxPower", c_attrs.bMaxPower);
+	gt_json_int(j, "bmAttributes", c_attrs.bmAttributes);
+	gt_json_end_object(j);
+
+	gt_json_begin_object(j, "strings");
+	gt_json_string(j, "configuration", usbg_ret == USBG_SUCCESS ?
+		       c_strs.configuration : NULL);
+	gt_json_end_object(j);
+
+	gt_json_begin_array(j, "bindings");
+	usbg_for_each_binding(b, c) {
+		f = usbg_get_binding_target(b);
+		gt_json_begin_object(j, NULL);
+		gt_json_string(j, "name", usbg_get_binding_name(b));
+		gt_json_string(j, "type",
+			usbg_get_function_type_str(usbg_get_function_type(f)));
+		gt_json_string(j, "instance", usbg_get_function_instance(f));
+		gt_json_end_object(j);
+	}
+	gt_json_end_array(j);
+
+	gt_json_end_object(j);
+	return 0;
+}
+
 static int show_func(void *data)
 {
 	struct gt_config_show_data *dt;
 	usbg_gadget *g;
 	usbg_config *c;
+	struct gt_json j;
+	int ret = 0;
 
 	dt = (struct gt_config_show_data *)data;
 
@@ -252,7 +311,39 @@ static int show_func(void *data)
 					dt->config_id);
 			return -1;
 		}
+	}
 
+	if (dt->opts & GT_JSON) {
+		if (gt_json_init(&j) < 0)
+			return -1;
+
+		gt_json_begin_object(&j, NULL);
+		gt_json_string(&j, "gadget", dt->gadget);
+		gt_json_begin_array(&j, "configs");
+		if (dt->config_id > 0) {
+			ret = gt_json_config_libusbg(&j, c);
+		} else {
+			usbg_for_each_config(c, g) {
+				if (dt->config_label && strcmp(dt->config_label,
+						usbg_get_config_label(c)) != 0)
+					continue;
+				ret = gt_json_config_libusbg(&j, c);
+				if (ret < 0)
+					break;
+			}
+		}
+		gt_json_end_array(&j);
+		gt_json_end_object(&j);
+
+		if (ret < 0)
+			gt_json_free(&j);
+		else
+			ret = gt_json_flush(&j, stdout);
+
+		return ret;
+	}
+
+	if (dt->config_id > 0) {
 		gt_print_config_libusbg(c, dt->opts);
 	} else if (dt->config_label) {
 		usbg_for_each_config(c, g) {
@@ -300,7 +391,8 @@ static int rm_func(void *data)
 	if (dt->opts & GT_FORCE) {
 		u = usbg_get_gadget_udc(g);
 		if (u != NULL) {
-			ret = usbg_disable_gadget(g);
+			ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+				       usbg_disable_gadget, g);
 			if (ret < 0) {
 				fprintf(stderr, "Error disabling gadget: %s\n",
 						usbg_strerror(ret));
@@ -309,7 +401,8 @@ static int rm_func(void *data)
 		}
 	}
 
-	ret = usbg_rm_config(c, opts);
+	ret = GT_TRACE("usbg", usbg_get_config_label(c),
+		       usbg_rm_config, c, opts);
 	if (ret < 0) {
 		fprintf(stderr, "Error removing config: %s\n",
 				usbg_strerror(ret));
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GADGET_TOOL_DAEMON_DAEMON_H__
+#define __GADGET_TOOL_DAEMON_DAEMON_H__
+
+#include "command.h"
+
+/* default path of daemon socket */
+#define GT_DAEMON_SOCKET_PATH "/run/gt.sock"
+
+/* environment variable which makes gt a client of running daemon */
+#define GT_DAEMON_SOCKET_ENV "GT_SOCKET"
+
+struct gt_daemon_data {
+	const char *socket;
+	int opts;
+};
+
+/**
+ * @brief Parse daemon command
+ */
+void gt_daemon_parse(const Command *cmd, int argc, char **argv,
+		ExecutableCommand *exec, void *data);
+
+/**
+ * @brief Help function which should be used if invalid
+ * syntax for daemon was entered.
+ *
+ * @param[in] data additional data
+ * @return -1 because invalid syntax has been provided
+ */
+int gt_daemon_help(void *data);
+
+/**
+ * @brief Forward command to running daemon
+ * @details Command line, standard streams and working directory are
+ * passed to the daemon, which executes command in that directory using
+ * its cached backend state.
+ * @param[in] socket path to daemon socket
+ * @param[in] argc number of arguments
+ * @param[in] argv arguments, argv[0] is ignored
+ * @param[out] ret value returned by command
+ * @return 0 if command has been executed by daemon, -1 if daemon
+ * is not available and command should be executed locally
+ */
+int gt_daemon_forward(const char *socket, int argc, char **argv, int *ret);
+
+#endif //__GADGET_TOOL_DAEMON_DAEMON_H__
@@ -0,0 +1,670 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file daemon.c
+ * @brief Long running gt process which keeps backend state in memory and
+ * executes commands received over unix socket.
+ * @details Client passes its standard streams and working directory
+ * (SCM_RIGHTS) together with command line, so output of command goes
+ * directly to the client terminal and relative paths are resolved as if
+ * the command was executed locally. Each command runs in a child forked
+ * from the daemon, so it starts with the cached state and a command which
+ * waits (eg. enable --wait) doesn't block other clients. Daemon watches
+ * configfs with inotify and reloads cached state whenever gadgets are
+ * modified, including by its own children.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/inotify.h>
+
+#include "daemon.h"
+#include "common.h"
+#include "parser.h"
+#include "backend.h"
+
+#define GT_DAEMON_MAGIC 0x32445447 /* "GTD2" */
+/* stdin, stdout, stderr and working directory of client */
+#define GT_DAEMON_FDS 4
+#define GT_DAEMON_MAX_PAYLOAD (64 * 1024)
+#define GT_DAEMON_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB \
+			      | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF)
+/* deep enough for function subdirectories (eg. uvc streaming headers) */
+#define GT_DAEMON_WATCH_DEPTH 8
+/* how long configfs has to be quiet before stale state is reloaded */
+#define GT_DAEMON_RELOAD_DELAY_MS 100
+/* how long client may take to send its request */
+#define GT_DAEMON_RECV_TIMEOUT_S 5
+
+struct gt_daemon_request {
+	uint32_t magic;
+	uint32_t argc;
+	uint32_t len;
+};
+
+static volatile sig_atomic_t gt_daemon_stop;
+
+int gt_daemon_help(void *data)
+{
+	printf("usage: %s daemon [options]\n"
+	       "Run in background mode, keeping gadget state in memory and executing\n"
+	       "commands received from clients. gt acts as a client when %s\n"
+	       "environment variable is set to daemon socket path.\n"
+	       "\n"
+	       "Options:\n"
+	       "  -s, --socket=<path>\tlisten on given socket (default %s)\n"
+	       "  -h, --help\t\tPrint this help\n",
+	       program_name, GT_DAEMON_SOCKET_ENV, GT_DAEMON_SOCKET_PATH);
+
+	return -1;
+}
+
+static void gt_daemon_signal(int sig)
+{
+	gt_daemon_stop = 1;
+}
+
+static int gt_daemon_watch_tree(int ifd, const char *path, int depth)
+{
+	struct dirent *d;
+	struct stat st;
+	char buf[PATH_MAX];
+	DIR *dir;
+	int ret;
+
+	if (inotify_add_watch(ifd, path, GT_DAEMON_WATCH_MASK) < 0) {
+		fprintf(stderr, "Unable to watch %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (depth == 0)
+		return 0;
+
+	dir = opendir(path);
+	if (dir == NULL)
+		return -1;
+
+	ret = 0;
+	while ((d = readdir(dir)) != NULL) {
+		if (d->d_name[0] == '.')
+			continue;
+
+		ret = snprintf(buf, sizeof(buf), "%s/%s", path, d->d_name);
+		if (ret >= sizeof(buf)) {
+			ret = -1;
+			break;
+		}
+		ret = 0;
+
+		/* Bindings are symlinks to functions, don't follow them */
+		if (d->d_type == DT_UNKNOWN) {
+			if (lstat(buf, &st) < 0 || !S_ISDIR(st.st_mode))
+				continue;
+		} else if (d->d_type != DT_DIR) {
+			continue;
+		}
+
+		ret = gt_daemon_watch_tree(ifd, buf, depth - 1);
+		if (ret < 0)
+			break;
+	}
+
+	closedir(dir);
+	return ret;
+}
+
+/**
+ * @brief Read all pending inotify events
+ * @return Number of events read
+ */
+static int gt_daemon_drain(int ifd)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	ssize_t len;
+	char *ptr;
+	int count = 0;
+
+	while (1) {
+		len = read(ifd, buf, sizeof(buf));
+		if (len <= 0)
+			break;
+
+		for (ptr = buf; ptr < buf + len;
+		     ptr += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)ptr;
+			if (ev->mask & IN_IGNORED)
+				continue;
+			count++;
+		}
+	}
+
+	return count;
+}
+
+static int gt_daemon_check_peer(int fd)
+{
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+		return -1;
+
+	if (cred.uid != 0 && cred.uid != geteuid()) {
+		fprintf(stderr, "Rejected client with uid %d\n", cred.uid);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void gt_daemon_close_fds(struct cmsghdr *cmsg)
+{
+	int n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+	int fd;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+		close(fd);
+	}
+}
+
+static int gt_daemon_recv_request(int fd, struct gt_daemon_request *req,
+		int *fds)
+{
+	union {
+		char buf[CMSG_SPACE(sizeof(int) * GT_DAEMON_FDS)];
+		struct cmsghdr align;
+	} u;
+	struct iovec iov = { req, sizeof(*req) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = u.buf,
+		.msg_controllen = sizeof(u.buf),
+	};
+	struct cmsghdr *cmsg;
+	ssize_t n;
+
+	n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET
+		    || cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+
+		if (cmsg->cmsg_len == CMSG_LEN(sizeof(int) * GT_DAEMON_FDS)
+		    && fds[0] < 0) {
+			memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * GT_DAEMON_FDS);
+			continue;
+		}
+
+		/* descriptors are installed already, don't leak them */
+		gt_daemon_close_fds(cmsg);
+	}
+
+	if (n != sizeof(*req) || fds[0] < 0 || fds[1] < 0 || fds[2] < 0
+	    || fds[3] < 0 || req->magic != GT_DAEMON_MAGIC
+	    || req->len == 0 || req->len > GT_DAEMON_MAX_PAYLOAD
+	    || req->argc == 0 || req->argc > req->len) {
+		fprintf(stderr, "Invalid request from client\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Execute single command of client, called in child process
+ * @param[in] fd Client connection
+ * @param[in] cwd Working directory of daemon, restored after command
+ */
+static void gt_daemon_serve(int fd, int cwd)
+{
+	struct gt_daemon_request req;
+	ExecutableCommand cmd;
+	int fds[GT_DAEMON_FDS] = {-1, -1, -1, -1};
+	int saved[3] = {-1, -1, -1};
+	char *payload = NULL;
+	char **argv = NULL;
+	char *ptr;
+	int32_t ret = -1;
+	struct timeval tv = { .tv_sec = GT_DAEMON_RECV_TIMEOUT_S };
+	int argc;
+	int i;
+
+	if (gt_daemon_check_peer(fd) < 0)
+		goto out;
+
+	/* client stalled in the middle of request must not keep child */
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	if (gt_daemon_recv_request(fd, &req, fds) < 0)
+		goto out;
+
+	payload = malloc(req.len);
+	argv = calloc(req.argc + 2, sizeof(*argv));
+	if (payload == NULL || argv == NULL)
+		goto out;
+
+	if (recv(fd, payload, req.len, MSG_WAITALL) != req.len
+	    || payload[req.len - 1] != '\0')
+		goto out;
+
+	argv[0] = program_name;
+	argc = 1;
+	for (ptr = payload; ptr < payload + req.len; ptr += strlen(ptr) + 1) {
+		if (argc > req.argc)
+			goto out;
+		argv[argc++] = ptr;
+	}
+
+	if (argc != req.argc + 1)
+		goto out;
+
+	fflush(stdout);
+	fflush(stderr);
+	for (i = 0; i < 3; i++) {
+		saved[i] = dup(i);
+		dup2(fds[i], i);
+	}
+	__fpurge(stdin);
+	clearerr(stdin);
+
+	if (streq(argv[1], "daemon")) {
+		fprintf(stderr, "Daemon is already running\n");
+	} else if (fchdir(fds[3]) < 0) {
+		perror("Unable to change to client directory");
+	} else {
+		gt_parse_commands(argc, argv, &cmd);
+		ret = executable_command_exec(&cmd);
+		executable_command_clean(&cmd);
+		if (fchdir(cwd) < 0)
+			perror("Unable to restore working directory");
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	__fpurge(stdin);
+	clearerr(stdin);
+	for (i = 0; i < 3; i++) {
+		dup2(saved[i], i);
+		close(saved[i]);
+	}
+
+out:
+	send(fd, &ret, sizeof(ret), MSG_NOSIGNAL);
+
+	for (i = 0; i < GT_DAEMON_FDS; i++)
+		if (fds[i] >= 0)
+			close(fds[i]);
+	free(argv);
+	free(payload);
+}
+
+static int gt_daemon_listen(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	mode_t mask;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path too long\n");
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		perror("Unable to create socket");
+		return -1;
+	}
+
+	/* Remove stale socket, but don't steal it from running daemon */
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+		fprintf(stderr, "Daemon is already running on %s\n", path);
+		goto err;
+	}
+	unlink(path);
+
+	mask = umask(0077);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		umask(mask);
+		perror("Unable to bind socket");
+		goto err;
+	}
+	umask(mask);
+
+	if (listen(fd, 16) < 0) {
+		perror("Unable to listen on socket");
+		unlink(path);
+		goto err;
+	}
+
+	return fd;
+err:
+	close(fd);
+	return -1;
+}
+
+/**
+ * @brief Reload stale state and watch directories created meanwhile
+ */
+static int gt_daemon_reload(int ifd, const char *root)
+{
+	gt_backend_unload();
+	if (gt_backend_load(GT_SCOPE_ALL, NULL) < 0)
+		return -1;
+
+	gt_daemon_drain(ifd);
+	gt_daemon_watch_tree(ifd, root, GT_DAEMON_WATCH_DEPTH);
+	return 0;
+}
+
+/**
+ * @brief Serve client in child process
+ * @details Parent keeps its state, changes made by the command are
+ * noticed through inotify like any other.
+ */
+static void gt_daemon_spawn(int cfd, int lfd, int ifd, int cwd)
+{
+	int32_t ret = -1;
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		send(cfd, &ret, sizeof(ret), MSG_NOSIGNAL);
+		return;
+	}
+
+	if (pid > 0)
+		return;
+
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	/* commands wait for their own children (eg. func preload) */
+	signal(SIGCHLD, SIG_DFL);
+	close(lfd);
+	close(ifd);
+
+	gt_daemon_serve(cfd, cwd);
+	_exit(0);
+}
+
+static int gt_daemon_func(void *data)
+{
+	struct gt_daemon_data *dt;
+	struct sigaction sa = { .sa_handler = gt_daemon_signal };
+	struct pollfd pfd[2];
+	char root[PATH_MAX];
+	int lfd, ifd, cfd, cwd;
+	int stale = 0;
+	int ret = -1;
+	int r;
+
+	dt = (struct gt_daemon_data *)data;
+
+	if (backend_ctx.backend_type != GT_BACKEND_LIBUSBG) {
+		fprintf(stderr, "Daemon is supported only by libusbg backend\n");
+		return -1;
+	}
+
+	if (gt_backend_load(GT_SCOPE_ALL, NULL) < 0)
+		return -1;
+
+	r = snprintf(root, sizeof(root), "%s/usb_gadget",
+		     usbg_get_configfs_path(backend_ctx.libusbg_state));
+	if (r >= sizeof(root)) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	cwd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (cwd < 0) {
+		perror("Unable to open working directory");
+		return -1;
+	}
+
+	ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (ifd < 0) {
+		perror("Unable to initialize inotify");
+		goto out_cwd;
+	}
+
+	if (gt_daemon_watch_tree(ifd, root, GT_DAEMON_WATCH_DEPTH) < 0)
+		goto out_inotify;
+
+	lfd = gt_daemon_listen(dt->socket);
+	if (lfd < 0)
+		goto out_inotify;
+
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+	/* children serving clients are reaped automatically */
+	signal(SIGCHLD, SIG_IGN);
+
+	pfd[0].fd = lfd;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = ifd;
+	pfd[1].events = POLLIN;
+
+	while (!gt_daemon_stop) {
+		r = poll(pfd, 2, stale ? GT_DAEMON_RELOAD_DELAY_MS : -1);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			goto out_socket;
+		}
+
+		/* configfs has been quiet for a while, reload stale state
+		 * now instead of making next client wait for it */
+		if (r == 0 && stale) {
+			if (gt_daemon_reload(ifd, root) < 0)
+				goto out_socket;
+			stale = 0;
+			continue;
+		}
+
+		if (pfd[1].revents & POLLIN && gt_daemon_drain(ifd) > 0)
+			stale = 1;
+
+		if (!(pfd[0].revents & POLLIN))
+			continue;
+
+		cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+		if (cfd < 0)
+			continue;
+
+		/* Compiled loads, replay and configfs backend bypass libusbg,
+		 * so even changes made by previous commands are known only
+		 * through inotify. Child must start with fresh state. */
+		if (stale) {
+			if (gt_daemon_reload(ifd, root) < 0) {
+				close(cfd);
+				goto out_socket;
+			}
+			stale = 0;
+		}
+
+		gt_daemon_spawn(cfd, lfd, ifd, cwd);
+		close(cfd);
+	}
+
+	ret = 0;
+out_socket:
+	close(lfd);
+	unlink(dt->socket);
+out_inotify:
+	close(ifd);
+out_cwd:
+	close(cwd);
+	return ret;
+}
+
+void gt_daemon_parse(const Command *cmd, int argc, char **argv,
+		ExecutableCommand *exec, void *data)
+{
+	struct gt_daemon_data *dt;
+	int c;
+	struct option opts[] = {
+		{"socket", required_argument, 0, 's'},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	dt = zalloc(sizeof(*dt));
+	if (dt == NULL)
+		goto out;
+
+	dt->socket = GT_DAEMON_SOCKET_PATH;
+
+	argv--;
+	argc++;
+	while (1) {
+		int opt_index = 0;
+		c = getopt_long(argc, argv, "s:h", opts, &opt_index);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 's':
+			dt->socket = optarg;
+			break;
+		case 'h':
+			goto out;
+			break;
+		default:
+			goto out;
+		}
+	}
+
+	if (optind < argc)
+		goto out;
+
+	executable_command_set(exec, gt_daemon_func, (void *)dt, free);
+	return;
+out:
+	free(dt);
+	executable_command_set(exec, cmd->printHelp, data, NULL);
+}
+
+int gt_daemon_forward(const char *socket_path, int argc, char **argv, int *ret)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	struct gt_daemon_request req = { .magic = GT_DAEMON_MAGIC };
+	union {
+		char buf[CMSG_SPACE(sizeof(int) * GT_DAEMON_FDS)];
+		struct cmsghdr align;
+	} u;
+	struct iovec iov = { &req, sizeof(req) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = u.buf,
+		.msg_controllen = sizeof(u.buf),
+	};
+	int fds[GT_DAEMON_FDS] = {0, 1, 2, -1};
+	struct cmsghdr *cmsg;
+	char *payload, *ptr;
+	int32_t result;
+	size_t len = 0;
+	ssize_t n;
+	int fd;
+	int i;
+
+	if (argc < 2 || strlen(socket_path) >= sizeof(addr.sun_path))
+		return -1;
+	strcpy(addr.sun_path, socket_path);
+
+	for (i = 1; i < argc; i++)
+		len += strlen(argv[i]) + 1;
+
+	if (len > GT_DAEMON_MAX_PAYLOAD)
+		return -1;
+
+	/* Daemon resolves relative paths of command against it */
+	fds[3] = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fds[3] < 0)
+		return -1;
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		goto out_cwd;
+
+	/* Daemon not running, command will be executed locally */
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+		goto out_socket;
+
+	payload = malloc(len);
+	if (payload == NULL)
+		goto out_socket;
+
+	for (ptr = payload, i = 1; i < argc; i++)
+		ptr = stpcpy(ptr, argv[i]) + 1;
+
+	req.argc = argc - 1;
+	req.len = len;
+
+	memset(u.buf, 0, sizeof(u.buf));
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	/* From now on command must not be executed locally, as daemon
+	 * could have already started executing it */
+	*ret = -1;
+	n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+	if (n == sizeof(req))
+		n = send(fd, payload, len, MSG_NOSIGNAL);
+
+	if (n >= 0 && recv(fd, &result, sizeof(result), MSG_WAITALL) == sizeof(result))
+		*ret = result;
+	else
+		fprintf(stderr, "Connection to daemon lost\n");
+
+	free(payload);
+	close(fd);
+	close(fds[3]);
+	return 0;
+
+out_socket:
+	close(fd);
+out_cwd:
+	close(fds[3]);
+	return -1;
+}
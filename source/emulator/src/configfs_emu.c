@@ -0,0 +1,830 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file configfs_emu.c
+ * @brief Stand-in for usb_gadget configfs on ordinary filesystem
+ * @details Preloaded library which makes a plain directory behave like
+ * usb_gadget subsystem of configfs as far as gt and libusbg need:
+ * mkdir of gadget, config, function, language or LUN creates its
+ * attributes and default groups, rmdir removes them again and fails if
+ * the item still has children created by user, and names of items are
+ * validated. /sys/class/udc is replaced by a directory of fake
+ * controllers with state, current_speed, maximum_speed, is_otg and
+ * soft_connect attributes, which are never updated by the emulator.
+ * Attributes are ordinary files, so their values are not validated and
+ * UDC can be bound to more gadgets at once.
+ *
+ * GT_CONFIGFS_PATH selects the directory, the library does nothing if it
+ * is not set. GT_EMU_UDC is comma separated list of controllers
+ * (default dummy_udc.0).
+ *
+ *     GT_CONFIGFS_PATH=/tmp/cfs LD_PRELOAD=libgt-configfs-emu.so gt ...
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+#define UDC_CLASS_DIR "/sys/class/udc"
+#define EMU_DEFAULT_UDC "dummy_udc.0"
+
+struct emu_attr {
+	const char *name;
+	const char *value;
+};
+
+/* default group, created and removed together with its item */
+struct emu_group {
+	const char *name;
+	const struct emu_attr *attrs;
+};
+
+struct emu_item {
+	const char *name;
+	const struct emu_attr *attrs;
+	const struct emu_group *groups;
+};
+
+static const struct emu_attr no_attrs[] = {
+	{ NULL, NULL },
+};
+
+static const struct emu_group no_groups[] = {
+	{ NULL, NULL },
+};
+
+static const struct emu_attr gadget_attrs[] = {
+	{ "bcdUSB", "0x0200" },
+	{ "bDeviceClass", "0x00" },
+	{ "bDeviceSubClass", "0x00" },
+	{ "bDeviceProtocol", "0x00" },
+	{ "bMaxPacketSize0", "0x40" },
+	{ "idVendor", "0x0000" },
+	{ "idProduct", "0x0000" },
+	{ "bcdDevice", "0x0000" },
+	{ "max_speed", "super-speed-plus" },
+	{ "UDC", "" },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr os_desc_attrs[] = {
+	{ "use", "0" },
+	{ "b_vendor_code", "0x00" },
+	{ "qw_sign", "" },
+	{ NULL, NULL },
+};
+
+static const struct emu_group gadget_groups[] = {
+	{ "strings", no_attrs },
+	{ "configs", no_attrs },
+	{ "functions", no_attrs },
+	{ "os_desc", os_desc_attrs },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr gadget_strs_attrs[] = {
+	{ "manufacturer", "" },
+	{ "product", "" },
+	{ "serialnumber", "" },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr config_attrs[] = {
+	{ "MaxPower", "2" },
+	{ "bmAttributes", "0x80" },
+	{ NULL, NULL },
+};
+
+static const struct emu_group config_groups[] = {
+	{ "strings", no_attrs },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr config_strs_attrs[] = {
+	{ "configuration", "" },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr serial_attrs[] = {
+	{ "port_num", "0" },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr net_attrs[] = {
+	{ "dev_addr", "02:00:00:00:00:01" },
+	{ "host_addr", "02:00:00:00:00:02" },
+	{ "ifname", "usb0" },
+	{ "qmult", "5" },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr rndis_attrs[] = {
+	{ "dev_addr", "02:00:00:00:00:01" },
+	{ "host_addr", "02:00:00:00:00:02" },
+	{ "ifname", "usb0" },
+	{ "qmult", "5" },
+	{ "class", "02" },
+	{ "subclass", "06" },
+	{ "protocol", "00" },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr phonet_attrs[] = {
+	{ "ifname", "upnlink0" },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr ms_attrs[] = {
+	{ "stall", "1" },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr lun_attrs[] = {
+	{ "cdrom", "0" },
+	{ "file", "" },
+	{ "inquiry_string", "" },
+	{ "nofua", "0" },
+	{ "removable", "0" },
+	{ "ro", "0" },
+	{ NULL, NULL },
+};
+
+static const struct emu_group ms_groups[] = {
+	{ "lun.0", lun_attrs },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr midi_attrs[] = {
+	{ "buflen", "512" },
+	{ "id", "" },
+	{ "in_ports", "1" },
+	{ "index", "-1" },
+	{ "out_ports", "1" },
+	{ "qlen", "32" },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr loopback_attrs[] = {
+	{ "bulk_buflen", "4096" },
+	{ "qlen", "32" },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr hid_attrs[] = {
+	{ "dev", "0:0" },
+	{ "protocol", "0" },
+	{ "report_desc", "" },
+	{ "report_length", "0" },
+	{ "subclass", "0" },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr uac2_attrs[] = {
+	{ "c_chmask", "3" },
+	{ "c_srate", "64000" },
+	{ "c_ssize", "2" },
+	{ "p_chmask", "3" },
+	{ "p_srate", "48000" },
+	{ "p_ssize", "2" },
+	{ "req_number", "2" },
+	{ NULL, NULL },
+};
+
+static const struct emu_attr printer_attrs[] = {
+	{ "pnp_string", "" },
+	{ "q_len", "10" },
+	{ NULL, NULL },
+};
+
+/* soft_connect is write-only in sysfs, here it just keeps last value */
+static const struct emu_attr udc_attrs[] = {
+	{ "state", "not attached" },
+	{ "current_speed", "UNKNOWN" },
+	{ "maximum_speed", "super-speed-plus" },
+	{ "is_otg", "0" },
+	{ "soft_connect", "" },
+	{ NULL, NULL },
+};
+
+static const struct emu_item function_types[] = {
+	{ "gser", serial_attrs, no_groups },
+	{ "acm", serial_attrs, no_groups },
+	{ "obex", serial_attrs, no_groups },
+	{ "ecm", net_attrs, no_groups },
+	{ "geth", net_attrs, no_groups },
+	{ "ncm", net_attrs, no_groups },
+	{ "eem", net_attrs, no_groups },
+	{ "rndis", rndis_attrs, no_groups },
+	{ "phonet", phonet_attrs, no_groups },
+	{ "ffs", no_attrs, no_groups },
+	{ "mass_storage", ms_attrs, ms_groups },
+	{ "midi", midi_attrs, no_groups },
+	{ "Loopback", loopback_attrs, no_groups },
+	{ "hid", hid_attrs, no_groups },
+	{ "uac2", uac2_attrs, no_groups },
+	{ "printer", printer_attrs, no_groups },
+	{ NULL, NULL, NULL },
+};
+
+static const struct emu_item gadget_item = { "gadget", gadget_attrs, gadget_groups };
+static const struct emu_item gadget_strs_item = { "strings", gadget_strs_attrs, no_groups };
+static const struct emu_item config_item = { "config", config_attrs, config_groups };
+static const struct emu_item config_strs_item = { "strings", config_strs_attrs, no_groups };
+static const struct emu_item lun_item = { "lun", lun_attrs, no_groups };
+
+static struct {
+	/* usb_gadget directory, as given and with symlinks resolved */
+	char root[PATH_MAX];
+	char real[PATH_MAX];
+	char udc[PATH_MAX];
+	int active;
+} emu;
+
+static int (*real_mkdir)(const char *, mode_t);
+static int (*real_mkdirat)(int, const char *, mode_t);
+static int (*real_rmdir)(const char *);
+static int (*real_unlinkat)(int, const char *, int);
+static int (*real_open)(const char *, int, ...);
+static int (*real_openat)(int, const char *, int, ...);
+static FILE *(*real_fopen)(const char *, const char *);
+static DIR *(*real_opendir)(const char *);
+static int (*real_scandir)(const char *, struct dirent ***,
+		int (*)(const struct dirent *),
+		int (*)(const struct dirent **, const struct dirent **));
+static int (*real_stat)(const char *, struct stat *);
+static int (*real_access)(const char *, int);
+
+/**
+ * @brief Collapse repeated slashes, "." components and trailing slash
+ */
+static void normalize(char *path)
+{
+	char *src = path, *dst = path;
+
+	while (*src) {
+		if (src[0] == '/' && (src[1] == '/' || src[1] == '\0')
+		    && dst != path) {
+			src++;
+			continue;
+		}
+		if (src[0] == '/' && src[1] == '.'
+		    && (src[2] == '/' || src[2] == '\0')) {
+			src += 2;
+			continue;
+		}
+		*dst++ = *src++;
+	}
+	if (dst > path + 1 && dst[-1] == '/')
+		dst--;
+	*dst = '\0';
+}
+
+/**
+ * @brief Get absolute path of path relative to dirfd
+ * @return 0 on success, -1 if path can't be resolved
+ */
+static int absolute(int dirfd, const char *path, char *buf, size_t size)
+{
+	char link[32];
+	ssize_t len;
+
+	if (path[0] == '/') {
+		if (snprintf(buf, size, "%s", path) >= size)
+			return -1;
+	} else {
+		if (dirfd == AT_FDCWD) {
+			if (getcwd(buf, size) == NULL)
+				return -1;
+			len = strlen(buf);
+		} else {
+			snprintf(link, sizeof(link), "/proc/self/fd/%d", dirfd);
+			len = readlink(link, buf, size - 1);
+			if (len < 0)
+				return -1;
+		}
+		if (snprintf(buf + len, size - len, "/%s", path) >= size - len)
+			return -1;
+	}
+
+	normalize(buf);
+	return 0;
+}
+
+/**
+ * @brief Get path relative to usb_gadget directory
+ * @return relative path or NULL if path is outside of it
+ */
+static const char *relative(const char *path)
+{
+	const char *roots[] = { emu.root, emu.real };
+	size_t len;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		len = strlen(roots[i]);
+		if (strncmp(path, roots[i], len) == 0 && path[len] == '/')
+			return path + len + 1;
+	}
+
+	return NULL;
+}
+
+static const struct emu_item *function_type(const char *name)
+{
+	const char *dot = strchr(name, '.');
+	int i;
+
+	for (i = 0; dot && function_types[i].name; i++)
+		if (strncmp(function_types[i].name, name, dot - name) == 0
+		    && function_types[i].name[dot - name] == '\0')
+			return &function_types[i];
+
+	return NULL;
+}
+
+static int valid_id(const char *s, int base)
+{
+	char *end;
+
+	if (*s == '\0')
+		return 0;
+	errno = 0;
+	strtoul(s, &end, base);
+	return errno == 0 && *end == '\0';
+}
+
+/**
+ * @brief Find what item would be created by mkdir of path
+ * @return item or NULL with errno set if configfs would refuse it
+ */
+static const struct emu_item *classify(const char *rel)
+{
+	char buf[PATH_MAX];
+	char *c[5];
+	char *tok, *save;
+	const char *dot;
+	int n = 0;
+
+	errno = EPERM;
+	snprintf(buf, sizeof(buf), "%s", rel);
+	for (tok = strtok_r(buf, "/", &save); tok;
+	     tok = strtok_r(NULL, "/", &save)) {
+		if (n == sizeof(c) / sizeof(c[0]))
+			return NULL;
+		c[n++] = tok;
+	}
+
+	if (n == 1)
+		return &gadget_item;
+
+	if (n == 3 && strcmp(c[1], "strings") == 0) {
+		if (!valid_id(c[2], 0))
+			errno = EINVAL;
+		else
+			return &gadget_strs_item;
+	} else if (n == 3 && strcmp(c[1], "configs") == 0) {
+		dot = strrchr(c[2], '.');
+		if (dot == NULL || dot == c[2] || !valid_id(dot + 1, 10))
+			errno = EINVAL;
+		else
+			return &config_item;
+	} else if (n == 5 && strcmp(c[1], "configs") == 0
+		   && strcmp(c[3], "strings") == 0) {
+		if (!valid_id(c[4], 0))
+			errno = EINVAL;
+		else
+			return &config_strs_item;
+	} else if (n == 3 && strcmp(c[1], "functions") == 0) {
+		if (strchr(c[2], '.') == NULL)
+			errno = EINVAL;
+		else if (function_type(c[2]) == NULL)
+			/* no module providing this function */
+			errno = ENOENT;
+		else
+			return function_type(c[2]);
+	} else if (n == 4 && strcmp(c[1], "functions") == 0
+		   && strncmp(c[2], "mass_storage.", 13) == 0
+		   && strncmp(c[3], "lun.", 4) == 0) {
+		if (!valid_id(c[3] + 4, 10))
+			errno = EINVAL;
+		else
+			return &lun_item;
+	}
+
+	return NULL;
+}
+
+static int create_attrs(int dirfd, const struct emu_attr *attrs)
+{
+	int fd;
+
+	for (; attrs->name; attrs++) {
+		fd = openat(dirfd, attrs->name,
+			    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0)
+			return -1;
+		if (*attrs->value)
+			dprintf(fd, "%s\n", attrs->value);
+		close(fd);
+	}
+
+	return 0;
+}
+
+static int populate(const char *path, const struct emu_item *item)
+{
+	const struct emu_group *g;
+	int dirfd, fd;
+	int ret = -1;
+
+	dirfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd < 0)
+		return -1;
+
+	if (create_attrs(dirfd, item->attrs) < 0)
+		goto out;
+
+	for (g = item->groups; g->name; g++) {
+		if (real_mkdirat(dirfd, g->name, 0755) < 0 && errno != EEXIST)
+			goto out;
+		fd = openat(dirfd, g->name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0)
+			goto out;
+		ret = create_attrs(fd, g->attrs);
+		close(fd);
+		if (ret < 0)
+			goto out;
+	}
+
+	ret = 0;
+out:
+	close(dirfd);
+	return ret;
+}
+
+static int is_attr(const struct emu_attr *attrs, const char *name)
+{
+	for (; attrs->name; attrs++)
+		if (strcmp(attrs->name, name) == 0)
+			return 1;
+	return 0;
+}
+
+/**
+ * @brief Check that directory holds nothing but given attributes
+ * and default groups
+ */
+static int only_defaults(int parent, const char *name,
+		const struct emu_attr *attrs, const struct emu_group *groups)
+{
+	const struct emu_group *g;
+	struct dirent *d;
+	DIR *dp;
+	int fd;
+	int ret = 1;
+
+	fd = openat(parent, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return 0;
+
+	dp = fdopendir(fd);
+	if (dp == NULL) {
+		close(fd);
+		return 0;
+	}
+
+	while (ret && (d = readdir(dp)) != NULL) {
+		if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0
+		    || is_attr(attrs, d->d_name))
+			continue;
+
+		for (g = groups; g->name; g++)
+			if (strcmp(g->name, d->d_name) == 0)
+				break;
+
+		ret = g->name && only_defaults(dirfd(dp), g->name, g->attrs,
+					       no_groups);
+	}
+
+	closedir(dp);
+	return ret;
+}
+
+static void remove_attrs(int dirfd, const char *name,
+		const struct emu_attr *attrs)
+{
+	int fd;
+
+	fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	for (; attrs->name; attrs++)
+		real_unlinkat(fd, attrs->name, 0);
+	close(fd);
+}
+
+/**
+ * @brief Remove item created by mkdir, as configfs does on rmdir
+ */
+static int remove_item(const char *path, const struct emu_item *item)
+{
+	const struct emu_group *g;
+
+	if (!only_defaults(AT_FDCWD, path, item->attrs, item->groups)) {
+		errno = ENOTEMPTY;
+		return -1;
+	}
+
+	remove_attrs(AT_FDCWD, path, item->attrs);
+	for (g = item->groups; g->name; g++) {
+		char group[PATH_MAX];
+
+		snprintf(group, sizeof(group), "%s/%s", path, g->name);
+		remove_attrs(AT_FDCWD, group, g->attrs);
+		real_rmdir(group);
+	}
+
+	return real_rmdir(path);
+}
+
+static int emu_mkdir(int dirfd, const char *path, mode_t mode)
+{
+	const struct emu_item *item;
+	char abs[PATH_MAX];
+	const char *rel;
+	int ret;
+
+	if (!emu.active || absolute(dirfd, path, abs, sizeof(abs)) < 0
+	    || (rel = relative(abs)) == NULL)
+		return real_mkdirat(dirfd, path, mode);
+
+	item = classify(rel);
+	if (item == NULL)
+		return -1;
+
+	ret = real_mkdir(abs, 0755);
+	if (ret == 0 && populate(abs, item) < 0) {
+		ret = -1;
+		remove_item(abs, item);
+	}
+
+	return ret;
+}
+
+static int emu_rmdir(int dirfd, const char *path)
+{
+	const struct emu_item *item;
+	char abs[PATH_MAX];
+	const char *rel;
+
+	if (!emu.active || absolute(dirfd, path, abs, sizeof(abs)) < 0
+	    || (rel = relative(abs)) == NULL)
+		return real_unlinkat(dirfd, path, AT_REMOVEDIR);
+
+	item = classify(rel);
+	if (item == NULL) {
+		/* default groups can't be removed */
+		errno = EPERM;
+		return -1;
+	}
+
+	return remove_item(abs, item);
+}
+
+/* libc may call wrappers before constructor of the library */
+static void resolve(void)
+{
+	if (real_mkdir)
+		return;
+
+	real_mkdir = dlsym(RTLD_NEXT, "mkdir");
+	real_mkdirat = dlsym(RTLD_NEXT, "mkdirat");
+	real_rmdir = dlsym(RTLD_NEXT, "rmdir");
+	real_unlinkat = dlsym(RTLD_NEXT, "unlinkat");
+	real_open = dlsym(RTLD_NEXT, "open");
+	real_openat = dlsym(RTLD_NEXT, "openat");
+	real_fopen = dlsym(RTLD_NEXT, "fopen");
+	real_opendir = dlsym(RTLD_NEXT, "opendir");
+	real_scandir = dlsym(RTLD_NEXT, "scandir");
+	real_stat = dlsym(RTLD_NEXT, "stat");
+	real_access = dlsym(RTLD_NEXT, "access");
+}
+
+/**
+ * @brief Replace /sys/class/udc by directory of fake controllers
+ */
+static const char *udc_path(const char *path, char *buf, size_t size)
+{
+	size_t len = strlen(UDC_CLASS_DIR);
+
+	if (!emu.active || strncmp(path, UDC_CLASS_DIR, len) != 0
+	    || (path[len] != '\0' && path[len] != '/'))
+		return path;
+
+	if (snprintf(buf, size, "%s%s", emu.udc, path + len) >= size)
+		return path;
+
+	return buf;
+}
+
+/**
+ * @brief Each write to configfs attribute replaces its whole value
+ */
+static int attr_flags(int dirfd, const char *path, int flags)
+{
+	char abs[PATH_MAX];
+
+	if (emu.active && (flags & O_ACCMODE) != O_RDONLY
+	    && absolute(dirfd, path, abs, sizeof(abs)) == 0 && relative(abs))
+		flags |= O_TRUNC;
+
+	return flags;
+}
+
+int mkdir(const char *path, mode_t mode)
+{
+	resolve();
+	return emu_mkdir(AT_FDCWD, path, mode);
+}
+
+int mkdirat(int dirfd, const char *path, mode_t mode)
+{
+	resolve();
+	return emu_mkdir(dirfd, path, mode);
+}
+
+int rmdir(const char *path)
+{
+	resolve();
+	return emu_rmdir(AT_FDCWD, path);
+}
+
+int unlinkat(int dirfd, const char *path, int flags)
+{
+	resolve();
+	if (flags & AT_REMOVEDIR)
+		return emu_rmdir(dirfd, path);
+
+	return real_unlinkat(dirfd, path, flags);
+}
+
+int open(const char *path, int flags, ...)
+{
+	char buf[PATH_MAX];
+	mode_t mode = 0;
+	va_list ap;
+
+	resolve();
+	if (flags & (O_CREAT | O_TMPFILE)) {
+		va_start(ap, flags);
+		mode = va_arg(ap, mode_t);
+		va_end(ap);
+	}
+
+	path = udc_path(path, buf, sizeof(buf));
+	return real_open(path, attr_flags(AT_FDCWD, path, flags), mode);
+}
+
+int openat(int dirfd, const char *path, int flags, ...)
+{
+	mode_t mode = 0;
+	va_list ap;
+
+	resolve();
+	if (flags & (O_CREAT | O_TMPFILE)) {
+		va_start(ap, flags);
+		mode = va_arg(ap, mode_t);
+		va_end(ap);
+	}
+
+	return real_openat(dirfd, path, attr_flags(dirfd, path, flags), mode);
+}
+
+FILE *fopen(const char *path, const char *mode)
+{
+	char buf[PATH_MAX];
+
+	resolve();
+	return real_fopen(udc_path(path, buf, sizeof(buf)), mode);
+}
+
+DIR *opendir(const char *path)
+{
+	char buf[PATH_MAX];
+
+	resolve();
+	return real_opendir(udc_path(path, buf, sizeof(buf)));
+}
+
+int scandir(const char *path, struct dirent ***names,
+		int (*filter)(const struct dirent *),
+		int (*compar)(const struct dirent **, const struct dirent **))
+{
+	char buf[PATH_MAX];
+
+	resolve();
+	return real_scandir(udc_path(path, buf, sizeof(buf)), names, filter,
+			    compar);
+}
+
+int stat(const char *path, struct stat *st)
+{
+	char buf[PATH_MAX];
+
+	resolve();
+	return real_stat(udc_path(path, buf, sizeof(buf)), st);
+}
+
+int access(const char *path, int mode)
+{
+	char buf[PATH_MAX];
+
+	resolve();
+	return real_access(udc_path(path, buf, sizeof(buf)), mode);
+}
+
+static void create_udcs(void)
+{
+	char path[PATH_MAX];
+	const char *list;
+	char *udcs, *udc, *save;
+	int fd;
+
+	list = getenv("GT_EMU_UDC");
+	udcs = strdup(list ? list : EMU_DEFAULT_UDC);
+	if (udcs == NULL)
+		return;
+
+	real_mkdir(emu.udc, 0755);
+	for (udc = strtok_r(udcs, ",", &save); udc;
+	     udc = strtok_r(NULL, ",", &save)) {
+		if (snprintf(path, sizeof(path), "%s/%s", emu.udc, udc)
+		    >= sizeof(path))
+			continue;
+
+		/* keep values tests may have written in previous runs */
+		if (real_mkdir(path, 0755) < 0)
+			continue;
+
+		fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+
+		create_attrs(fd, udc_attrs);
+		close(fd);
+	}
+
+	free(udcs);
+}
+
+__attribute__((constructor))
+static void emu_init(void)
+{
+	const char *root;
+
+	resolve();
+
+	root = getenv("GT_CONFIGFS_PATH");
+	if (root == NULL || *root == '\0')
+		return;
+
+	if (snprintf(emu.root, sizeof(emu.root), "%s/usb_gadget", root)
+	    >= sizeof(emu.root)
+	    || snprintf(emu.udc, sizeof(emu.udc), "%s/udc", root)
+	    >= sizeof(emu.udc))
+		return;
+	normalize(emu.root);
+	normalize(emu.udc);
+
+	real_mkdir(root, 0755);
+	real_mkdir(emu.root, 0755);
+	if (realpath(emu.root, emu.real) == NULL)
+		return;
+
+	create_udcs();
+	emu.active = 1;
+}
@@ -17,7 +17,11 @@
 #ifndef __GADGET_TOOL_FUNCTION_FUNCTION_H__
 #define __GADGET_TOOL_FUNCTION_FUNCTION_H__
 
+#include <libconfig.h>
+#include <usbg/usbg.h>
+
 #include "command.h"
+#include "json.h"
 
 /**
  * An interface that backends need to implement. Not implemented functions
@@ -73,6 +77,10 @@ struct gt_function_backend {
 	 * Remove template
 	 */
 	int (*template_rm)(void *);
+	/**
+	 * Load kernel modules of function types
+	 */
+	int (*preload)(void *);
 };
 
 struct gt_func_create_data {
@@ -153,6 +161,13 @@ struct gt_func_template_set_data {
 	int opts;
 };
 
+struct gt_func_preload_data {
+	/* set to 1 for each usbg_function_type to be loaded */
+	int types[USBG_FUNCTION_TYPE_MAX];
+	const char *file;
+	int opts;
+};
+
 /**
  * @brief Gets the next possible commands after func
  * @param[in] cmd actual command (should be func)
@@ -178,6 +193,36 @@ int gt_func_help(void *data);
  */
 int gt_print_function_libusbg(usbg_function *f, int opts);
 
+/**
+ * @brief Add function with its attributes to JSON document
+ * @param[in] j JSON document
+ * @param[in] f Function to be added
+ * @return 0 on success, -1 otherwise
+ */
+int gt_json_function_libusbg(struct gt_json *j, usbg_function *f);
+
+/**
+ * @brief Load kernel modules of given function types concurrently
+ * @details Kernel loads module of function synchronously when its
+ * directory is created, so gadget with several function types waits for
+ * each of them in turn. Failures are not fatal, as module may be built
+ * in or still be loaded by kernel later.
+ * @param[in] types array indexed by usbg_function_type, nonzero for types
+ * to be loaded
+ * @param[in] opts GT_QUIET to not report failures
+ * @return number of modules which failed to load
+ */
+int gt_func_preload(const int *types, int opts);
+
+/**
+ * @brief Find function types used in gadget scheme
+ * @param[in] root root setting of scheme
+ * @param[in,out] types array indexed by usbg_function_type, set to 1 for
+ * each type found
+ * @return number of types found which were not set before
+ */
+int gt_func_scheme_types(const config_setting_t *root, int *types);
+
 extern struct gt_function_backend gt_function_backend_libusbg;
 #ifdef WITH_GADGETD
 extern struct gt_function_backend gt_function_backend_gadgetd;
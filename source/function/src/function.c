@@ -80,6 +80,7 @@ static void gt_parse_func_create(const Command *cmd, int argc,
 
 	executable_command_set(exec, GET_EXECUTABLE(create),
 			(void *)dt, gt_func_create_destructor);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 
 	return;
 out:
@@ -147,6 +148,7 @@ static void gt_parse_func_rm(const Command *cmd, int argc,
 
 	executable_command_set(exec, GET_EXECUTABLE(rm),
 			(void *)dt, gt_func_rm_destructor);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 
 	return;
 out:
@@ -193,6 +195,79 @@ out:
 
 }
 
+static int gt_func_preload_help(void *data)
+{
+	printf("usage: %s func preload [type]... [--from-scheme=<file>]\n"
+	       "Load kernel modules of function types before creating functions.\n"
+	       "Modules are loaded concurrently.\n"
+	       "\n"
+	       "Options:\n"
+	       "  --from-scheme=<file>\tLoad modules of functions used in gadget scheme\n"
+	       "  -q, --quiet\tDon't report modules which failed to load\n"
+	       "  -h, --help\tPrint this help\n",
+		program_name);
+	return -1;
+}
+
+static void gt_parse_func_preload(const Command *cmd, int argc,
+		char **argv, ExecutableCommand *exec, void * data)
+{
+	struct gt_func_preload_data *dt = NULL;
+	int c;
+	int t;
+	struct option opts[] = {
+			{"from-scheme", required_argument, 0, 1},
+			{"quiet", no_argument, 0, 'q'},
+			{"help", no_argument, 0, 'h'},
+			{0, 0, 0, 0}
+		};
+
+	dt = zalloc(sizeof(*dt));
+	if (dt == NULL)
+		goto out;
+
+	argv--;
+	argc++;
+	while (1) {
+		int opt_index = 0;
+		c = getopt_long(argc, argv, "qh", opts, &opt_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 1:
+			dt->file = optarg;
+			break;
+		case 'q':
+			dt->opts |= GT_QUIET;
+			break;
+		default:
+			goto out;
+		}
+	}
+
+	if (optind == argc && dt->file == NULL)
+		goto out;
+
+	for (; optind < argc; optind++) {
+		t = usbg_lookup_function_type(argv[optind]);
+		if (t < 0) {
+			fprintf(stderr, "Unknown function type: %s\n",
+				argv[optind]);
+			goto out;
+		}
+
+		dt->types[t] = 1;
+	}
+
+	executable_command_set(exec, GET_EXECUTABLE(preload),
+			(void *)dt, free);
+	return;
+out:
+	free(dt);
+	executable_command_set(exec, cmd->printHelp, data, NULL);
+}
+
 static void gt_func_get_destructor(void *data)
 {
 	struct gt_func_get_data *dt;
@@ -245,6 +320,7 @@ static void gt_parse_func_get(const Command *cmd, int argc,
 
 	executable_command_set(exec, GET_EXECUTABLE(get), (void *)dt,
 			gt_func_get_destructor);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 
 	return;
 out:
@@ -300,6 +376,7 @@ static void gt_parse_func_set(const Command *cmd, int argc,
 
 	executable_command_set(exec, GET_EXECUTABLE(set), (void *)dt,
 			gt_func_set_destructor);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 
 	return;
 out:
@@ -348,6 +425,7 @@ static int gt_func_show_help(void *data)
 	       "  -v, --verbose\tShow also attributes\n"
 	       "  --instance\tShow only function instances (cannot be used with --type)\n"
 	       "  --type\t\tShow only function types (cannot be used with  --instance)\n"
+	       "  --json\tShow functions with attributes as JSON document\n"
 	       "  -h, --help\tPrint this help\n");
 
 	return -1;
@@ -358,7 +436,8 @@ static void gt_parse_func_show(const Command *cmd, int argc,
 {
 	struct gt_func_show_data *dt = NULL;
 	int ind;
-	int avaible_opts = GT_VERBOSE | GT_HELP | GT_INSTANCE | GT_TYPE;
+	int avaible_opts = GT_VERBOSE | GT_HELP | GT_INSTANCE | GT_TYPE
+		| GT_JSON;
 
 	if (argc < 1)
 		goto out;
@@ -391,6 +470,7 @@ static void gt_parse_func_show(const Command *cmd, int argc,
 
 	executable_command_set(exec, GET_EXECUTABLE(show), (void *)dt,
 			gt_func_show_destructor);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 	return;
 out:
 	gt_func_show_destructor(dt);
@@ -474,6 +554,7 @@ static void gt_parse_func_load(const Command *cmd, int argc,
 
 	executable_command_set(exec, GET_EXECUTABLE(load),
 			(void *)dt, free);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 	return;
 out:
 	free(dt);
@@ -568,6 +649,7 @@ static void gt_parse_func_save(const Command *cmd, int argc,
 
 	executable_command_set(exec, GET_EXECUTABLE(save), (void *)dt,
 			gt_func_save_destructor);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 
 	return;
 out:
@@ -775,6 +857,8 @@ const Command *gt_func_get_children(const Command *cmd)
 		{"get", NEXT, gt_parse_func_get, NULL, gt_func_get_help},
 		{"set", NEXT, gt_parse_func_set, NULL, gt_func_set_help},
 		{"list-types", NEXT, gt_parse_func_list_types, NULL, gt_func_list_types_help},
+		{"preload", NEXT, gt_parse_func_preload, NULL,
+			gt_func_preload_help},
 		{"load", NEXT, gt_parse_func_load, NULL, gt_func_load_help},
 		{"save", NEXT, gt_parse_func_save, NULL, gt_func_save_help},
 		{"template", NEXT, command_parse,
@@ -37,17 +37,17 @@ static int create_func(void *data)
 		return -1;
 	}
 
-	v = g_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
-					"org.usb.gadgetd",
-					"/org/usb/Gadget",
-					"org.usb.device.GadgetManager",
-					"FindGadgetByName",
-					g_variant_new("(s)", dt->gadget),
-					NULL,
-					G_DBUS_CALL_FLAGS_NONE,
-					-1,
-					NULL,
-					&err);
+	v = gt_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
+					 "org.usb.gadgetd",
+					 "/org/usb/Gadget",
+					 "org.usb.device.GadgetManager",
+					 "FindGadgetByName",
+					 g_variant_new("(s)", dt->gadget),
+					 NULL,
+					 G_DBUS_CALL_FLAGS_NONE,
+					 -1,
+					 NULL,
+					 &err);
 	if (err) {
 		fprintf(stderr, "Unable to find gadget %s: %s\n", dt->gadget, err->message);
 		return -1;
@@ -56,17 +56,17 @@ static int create_func(void *data)
 	g_variant_get(v, "(o)", &gadget_objpath);
 	g_variant_unref(v);
 
-	v = g_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
-					"org.usb.gadgetd",
-					gadget_objpath,
-					"org.usb.device.Gadget.FunctionManager",
-					"CreateFunction",
-					g_variant_new("(ss)", dt->name, dt->type),
-					NULL,
-					G_DBUS_CALL_FLAGS_NONE,
-					-1,
-					NULL,
-					&err);
+	v = gt_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
+					 "org.usb.gadgetd",
+					 gadget_objpath,
+					 "org.usb.device.Gadget.FunctionManager",
+					 "CreateFunction",
+					 g_variant_new("(ss)", dt->name, dt->type),
+					 NULL,
+					 G_DBUS_CALL_FLAGS_NONE,
+					 -1,
+					 NULL,
+					 &err);
 	if (err) {
 		fprintf(stderr, "Unable to create function: %s\n", err->message);
 		g_free(gadget_objpath);
@@ -89,17 +89,17 @@ static int list_types_func(void *data)
 
 	dt = (struct gt_func_list_types_data *)data;
 
-	v = g_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
-					"org.usb.gadgetd",
-					"/org/usb/Gadget",
-					"org.usb.device.GadgetManager",
-					"ListAvailableFunctions",
-					NULL,
-					NULL,
-					G_DBUS_CALL_FLAGS_NONE,
-					-1,
-					NULL,
-					&err);
+	v = gt_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
+					 "org.usb.gadgetd",
+					 "/org/usb/Gadget",
+					 "org.usb.device.GadgetManager",
+					 "ListAvailableFunctions",
+					 NULL,
+					 NULL,
+					 G_DBUS_CALL_FLAGS_NONE,
+					 -1,
+					 NULL,
+					 &err);
 
 	if (err) {
 		fprintf(stderr, "Unable to get function list: %s\n", err->message);
@@ -132,4 +132,5 @@ struct gt_function_backend gt_function_backend_gadgetd = {
 	.template_get = NULL,
 	.template_set = NULL,
 	.template_rm = NULL,
+	.preload = NULL,
 };
@@ -15,6 +15,8 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <libconfig.h>
 #include <usbg/usbg.h>
 #include <usbg/function/ms.h>
 #include <usbg/function/net.h>
@@ -26,6 +28,7 @@
 #include "function.h"
 #include "common.h"
 #include "backend.h"
+#include "trace.h"
 
 static int create_func(void *data)
 {
@@ -58,7 +61,8 @@ static int create_func(void *data)
 		return -1;
 	}
 
-	r = usbg_create_function(g, f_type, dt->name, NULL, &f);
+	r = GT_TRACE("usbg", usbg_get_gadget_name(g),
+		     usbg_create_function, g, f_type, dt->name, NULL, &f);
 	if (r < 0) {
 		fprintf(stderr, "Unable to create function: %s\n",
 			usbg_strerror(r));
@@ -203,11 +207,68 @@ int gt_print_function_libusbg(usbg_function *f, int opts)
 	return 0;
 }
 
+int gt_json_function_libusbg(struct gt_json *j, usbg_function *f)
+{
+	const config_setting_t *attrs;
+	char *buf = NULL;
+	size_t size = 0;
+	config_t cfg;
+	FILE *fp;
+	int ret;
+
+	/* Exported scheme contains attributes of all function types */
+	fp = open_memstream(&buf, &size);
+	if (fp == NULL)
+		return -1;
+
+	ret = GT_TRACE("usbg", usbg_get_function_instance(f),
+		       usbg_export_function, f, fp);
+	fclose(fp);
+	if (ret != USBG_SUCCESS) {
+		fprintf(stderr, "Error: %s : %s\n", usbg_error_name(ret),
+				usbg_strerror(ret));
+		free(buf);
+		return -1;
+	}
+
+	config_init(&cfg);
+	fp = fmemopen(buf, size, "r");
+	if (fp == NULL || config_read(&cfg, fp) != CONFIG_TRUE) {
+		fprintf(stderr, "Unable to parse function attributes\n");
+		ret = -1;
+		goto out;
+	}
+
+	attrs = config_setting_get_member(config_root_setting(&cfg), "attrs");
+
+	gt_json_begin_object(j, NULL);
+	gt_json_string(j, "type",
+		       usbg_get_function_type_str(usbg_get_function_type(f)));
+	gt_json_string(j, "instance", usbg_get_function_instance(f));
+	if (attrs) {
+		gt_json_setting(j, "attrs", attrs);
+	} else {
+		gt_json_begin_object(j, "attrs");
+		gt_json_end_object(j);
+	}
+	gt_json_end_object(j);
+
+	ret = 0;
+out:
+	if (fp)
+		fclose(fp);
+	config_destroy(&cfg);
+	free(buf);
+	return ret;
+}
+
 static int show_func(void *data)
 {
 	struct gt_func_show_data *dt;
 	usbg_gadget *g;
 	usbg_function *f;
+	struct gt_json j;
+	int ret = 0;
 
 	dt = (struct gt_func_show_data *)data;
 
@@ -226,20 +287,51 @@ static int show_func(void *data)
 					dt->instance);
 			return -1;
 		}
+	}
 
-		gt_print_function_libusbg(f, dt->opts);
-	} else if (dt->type >= 0) {
-		usbg_for_each_function(f, g) {
-			if (dt->type == usbg_get_function_type(f))
+	if (!(dt->opts & GT_JSON)) {
+		if (dt->instance) {
+			gt_print_function_libusbg(f, dt->opts);
+		} else if (dt->type >= 0) {
+			usbg_for_each_function(f, g) {
+				if (dt->type == usbg_get_function_type(f))
+					gt_print_function_libusbg(f, dt->opts);
+			}
+		} else {
+			usbg_for_each_function(f, g) {
 				gt_print_function_libusbg(f, dt->opts);
+			}
 		}
+
+		return 0;
+	}
+
+	if (gt_json_init(&j) < 0)
+		return -1;
+
+	gt_json_begin_object(&j, NULL);
+	gt_json_string(&j, "gadget", dt->gadget);
+	gt_json_begin_array(&j, "functions");
+	if (dt->instance) {
+		ret = gt_json_function_libusbg(&j, f);
 	} else {
 		usbg_for_each_function(f, g) {
-			gt_print_function_libusbg(f, dt->opts);
+			if (dt->type >= 0 && dt->type != usbg_get_function_type(f))
+				continue;
+			ret = gt_json_function_libusbg(&j, f);
+			if (ret < 0)
+				break;
 		}
 	}
+	gt_json_end_array(&j);
+	gt_json_end_object(&j);
 
-	return 0;
+	if (ret < 0)
+		gt_json_free(&j);
+	else
+		ret = gt_json_flush(&j, stdout);
+
+	return ret;
 }
 
 static int rm_func(void *data)
@@ -273,7 +365,8 @@ static int rm_func(void *data)
 	if (dt->opts & GT_FORCE) {
 		u = usbg_get_gadget_udc(g);
 		if (u != NULL) {
-			ret = usbg_disable_gadget(g);
+			ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+				       usbg_disable_gadget, g);
 			if (ret < 0) {
 				fprintf(stderr, "Error disabling gadget: %s\n",
 						usbg_strerror(ret));
@@ -282,7 +375,8 @@ static int rm_func(void *data)
 		}
 	}
 
-	ret = usbg_rm_function(f, opts);
+	ret = GT_TRACE("usbg", usbg_get_function_instance(f),
+		       usbg_rm_function, f, opts);
 	if (ret < 0) {
 		fprintf(stderr, "Error removing function: %s\n",
 				usbg_strerror(ret));
@@ -292,6 +386,32 @@ static int rm_func(void *data)
 	return ret;
 }
 
+static int preload_func(void *data)
+{
+	struct gt_func_preload_data *dt;
+	config_t cfg;
+	int ret;
+
+	dt = (struct gt_func_preload_data *)data;
+
+	if (dt->file) {
+		config_init(&cfg);
+		ret = GT_TRACE("libconfig", dt->file,
+			       config_read_file, &cfg, dt->file);
+		if (ret != CONFIG_TRUE) {
+			fprintf(stderr, "%s:%d: %s\n", dt->file,
+				config_error_line(&cfg), config_error_text(&cfg));
+			config_destroy(&cfg);
+			return -1;
+		}
+
+		gt_func_scheme_types(config_root_setting(&cfg), dt->types);
+		config_destroy(&cfg);
+	}
+
+	return gt_func_preload(dt->types, dt->opts) ? -1 : 0;
+}
+
 struct gt_function_backend gt_function_backend_libusbg = {
 	.create = create_func,
 	.rm = rm_func,
@@ -305,4 +425,5 @@ struct gt_function_backend gt_function_backend_libusbg = {
 	.template_get = NULL,
 	.template_set = NULL,
 	.template_rm = NULL,
+	.preload = preload_func,
 };
@@ -215,6 +215,30 @@ static int template_rm_func(void *data)
 	return 0;
 }
 
+static int preload_func(void *data)
+{
+	struct gt_func_preload_data *dt;
+	int i, n = 0;
+
+	dt = (struct gt_func_preload_data *)data;
+	printf("Func preload called successfully. Not implemented.\n");
+	printf("types=");
+	for (i = 0; i < ARRAY_SIZE(dt->types); ++i) {
+		if (dt->types[i]) {
+			printf("%s, ", usbg_get_function_type_str(i));
+			n++;
+		}
+	}
+	/* keep empty list apart from the next value */
+	if (n == 0)
+		printf(", ");
+	if (dt->file)
+		printf("file=%s, ", dt->file);
+	printf("quiet=%d\n", !!(dt->opts & GT_QUIET));
+
+	return 0;
+}
+
 struct gt_function_backend gt_function_backend_not_implemented = {
 	.create = create_func,
 	.rm = rm_func,
@@ -229,4 +253,5 @@ struct gt_function_backend gt_function_backend_not_implemented = {
 	.template_set = template_set_func,
 	.template_rm = template_rm_func,
 	.create = create_func,
+	.preload = preload_func,
 };
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <libconfig.h>
+#include <usbg/usbg.h>
+#ifdef WITH_KMOD
+#include <libkmod.h>
+#endif
+
+#include "function.h"
+#include "common.h"
+#include "parser.h"
+#include "trace.h"
+
+/* kernel requests this alias when function directory is created */
+#define GT_FUNC_MODALIAS "usbfunc:%s"
+
+/**
+ * @brief Get name of module providing function type
+ * @details Used only to skip modules already loaded, types missing here
+ * are simply loaded again.
+ */
+static void module_name(int type, char *buf, size_t size)
+{
+	switch (type) {
+	case USBG_F_SERIAL:
+		snprintf(buf, size, "usb_f_serial");
+		break;
+	case USBG_F_SUBSET:
+		snprintf(buf, size, "usb_f_ecm_subset");
+		break;
+	case USBG_F_FFS:
+		snprintf(buf, size, "usb_f_fs");
+		break;
+	case USBG_F_LOOPBACK:
+		snprintf(buf, size, "usb_f_ss_lb");
+		break;
+	default:
+		snprintf(buf, size, "usb_f_%s", usbg_get_function_type_str(type));
+		break;
+	}
+}
+
+static int module_loaded(int type)
+{
+	char path[PATH_MAX];
+	char name[64];
+
+	module_name(type, name, sizeof(name));
+	snprintf(path, sizeof(path), "/sys/module/%s", name);
+
+	return access(path, F_OK) == 0;
+}
+
+/**
+ * @brief Load module with given alias, called in child process
+ * @return 0 on success, -1 otherwise
+ */
+static int load_module(const char *alias)
+{
+#ifdef WITH_KMOD
+	struct kmod_list *list = NULL, *l;
+	struct kmod_module *mod;
+	struct kmod_ctx *ctx;
+	int ret;
+
+	ctx = kmod_new(NULL, NULL);
+	if (ctx == NULL)
+		return -1;
+
+	/* empty list means built in or unknown, leave it to kernel */
+	ret = kmod_module_new_from_lookup(ctx, alias, &list);
+	kmod_list_foreach(l, list) {
+		mod = kmod_module_get_module(l);
+		ret = kmod_module_probe_insert_module(mod,
+				KMOD_PROBE_IGNORE_LOADED, NULL, NULL,
+				NULL, NULL);
+		kmod_module_unref(mod);
+		if (ret == 0)
+			break;
+	}
+
+	kmod_module_unref_list(list);
+	kmod_unref(ctx);
+
+	return ret < 0 ? -1 : 0;
+#else
+	execlp("modprobe", "modprobe", "-q", alias, (char *)NULL);
+	return -1;
+#endif
+}
+
+int gt_func_preload(const int *types, int opts)
+{
+	char alias[USBG_FUNCTION_TYPE_MAX][64];
+	long long start[USBG_FUNCTION_TYPE_MAX];
+	pid_t pid[USBG_FUNCTION_TYPE_MAX];
+	int running = 0;
+	int failed = 0;
+	int status;
+	pid_t p;
+	int ret;
+	int i;
+
+	for (i = USBG_FUNCTION_TYPE_MIN; i < USBG_FUNCTION_TYPE_MAX; i++) {
+		pid[i] = 0;
+		if (!types[i] || module_loaded(i))
+			continue;
+
+		snprintf(alias[i], sizeof(alias[i]), GT_FUNC_MODALIAS,
+			 usbg_get_function_type_str(i));
+		start[i] = gt_trace_now();
+
+		/* each module in its own process, so they load concurrently */
+		pid[i] = fork();
+		if (pid[i] == 0)
+			_exit(load_module(alias[i]) < 0 ? 1 : 0);
+
+		if (pid[i] < 0) {
+			/* kernel will load it on mkdir anyway */
+			pid[i] = 0;
+			failed++;
+			if (!(opts & GT_QUIET))
+				perror("fork");
+			continue;
+		}
+
+		running++;
+	}
+
+	while (running > 0) {
+		p = waitpid(-1, &status, 0);
+		if (p < 0)
+			break;
+
+		for (i = USBG_FUNCTION_TYPE_MIN; i < USBG_FUNCTION_TYPE_MAX; i++)
+			if (pid[i] == p)
+				break;
+		if (i == USBG_FUNCTION_TYPE_MAX)
+			continue;
+
+		running--;
+		ret = WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+		gt_trace_event("kmod", "preload", alias[i], start[i], ret);
+		if (ret == 0)
+			continue;
+
+		failed++;
+		if (!(opts & GT_QUIET))
+			fprintf(stderr, "Unable to load module for function %s\n",
+				usbg_get_function_type_str(i));
+	}
+
+	return failed;
+}
+
+int gt_func_scheme_types(const config_setting_t *root, int *types)
+{
+	const config_setting_t *funcs, *f;
+	const char *type;
+	int found = 0;
+	int i, n, t;
+
+	funcs = config_setting_get_member(root, "functions");
+	if (funcs == NULL)
+		return 0;
+
+	n = config_setting_length(funcs);
+	for (i = 0; i < n; i++) {
+		f = config_setting_get_elem(funcs, i);
+		if (config_setting_lookup_string(f, "type", &type) != CONFIG_TRUE)
+			continue;
+
+		/* unknown types are reported by import itself */
+		t = usbg_lookup_function_type(type);
+		if (t < 0 || types[t])
+			continue;
+
+		types[t] = 1;
+		found++;
+	}
+
+	return found;
+}
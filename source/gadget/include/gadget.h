@@ -17,10 +17,14 @@
 #ifndef __GADGET_TOOL_GADGET_GADGET_H__
 #define __GADGET_TOOL_GADGET_GADGET_H__
 
+#include <time.h>
 #include <usbg/usbg.h>
 
 #include "command.h"
 
+/* directory where fingerprints of loaded gadgets are kept */
+#define GT_STATE_PATH "/run/gt"
+
 /**
  * An interface that backends need to implement. Not implemented functions
  * should be filled with NULL pointers. For each function the only argument
@@ -63,6 +67,22 @@ struct gt_gadget_backend {
 	 * Save gadget to file
 	 */
 	int (*save)(void *);
+	/**
+	 * Make gadget match scheme
+	 */
+	int (*apply)(void *);
+	/**
+	 * Compare gadget with scheme or other gadget
+	 */
+	int (*diff)(void *);
+	/**
+	 * Compile scheme to binary form
+	 */
+	int (*compile)(void *);
+	/**
+	 * Create gadget from recorded plan
+	 */
+	int (*replay)(void *);
 	/**
 	 * Show gadget templates
 	 */
@@ -79,6 +99,18 @@ struct gt_gadget_backend {
 	 * Remove template
 	 */
 	int (*template_rm)(void *);
+	/**
+	 * Rebuild index of templates in lookup paths
+	 */
+	int (*template_reindex)(void *);
+	/**
+	 * Compose unbound gadgets ready to be switched to
+	 */
+	int (*pool_prepare)(void *);
+	/**
+	 * Replace gadget bound to udc with another one
+	 */
+	int (*switch_udc)(void *);
 };
 
 #define GT_GADGET_STRS_COUNT 3
@@ -90,10 +122,134 @@ struct gt_gadget_str {
 
 extern const struct gt_gadget_str gadget_strs[];
 
+/*
+ * Gadget attributes which libusbg doesn't know about, they are accessed
+ * in configfs directly and kept as strings.
+ */
+enum gt_gadget_speed_attr {
+	GT_GADGET_MAX_SPEED,
+	GT_GADGET_SSP_RATE,
+	GT_GADGET_SPEED_ATTR_MAX,
+};
+
+extern const char *gadget_speed_attrs[];
+
+/**
+ * @brief Get id of speed attribute
+ * @return id or -1 if name is not a speed attribute
+ */
+int gt_gadget_lookup_speed_attr(const char *name);
+
+/**
+ * @brief Check if value is accepted by kernel for given speed attribute
+ * @return 1 if valid, 0 otherwise
+ */
+int gt_gadget_speed_attr_valid(int attr, const char *val);
+
+/**
+ * @brief Read speed attribute of gadget
+ * @return 0 on success, -1 if attribute could not be read (eg. because
+ * kernel doesn't provide it)
+ */
+int gt_gadget_get_speed_attr(const char *gadget, int attr, char *buf,
+		size_t size);
+
+/**
+ * @brief Write speed attribute of gadget
+ * @details max_speed is checked only against udc the gadget is bound to,
+ * so schemes can be loaded on boards slower than the one they were saved
+ * on. Unbound gadget is checked by gt_gadget_check_max_speed() on enable.
+ * @return 0 on success, -1 otherwise (error is printed)
+ */
+int gt_gadget_set_speed_attr(const char *gadget, int attr, const char *val);
+
+/**
+ * @brief Print speed attributes in format used by get command
+ * @details Attributes not provided by kernel are not printed.
+ * @param[in] mask attributes selected for printing, NULL to print all
+ */
+void gt_print_gadget_speed_attrs(const char *gadget, const int *mask);
+
+/**
+ * @brief Print gadget attributes in format used by get command
+ * @param[in] g_attrs attributes to print
+ * @param[in] mask attributes selected for printing, NULL to print all
+ */
+void gt_print_gadget_attrs(const struct usbg_gadget_attrs *g_attrs,
+		const int *mask);
+
+/**
+ * @brief Warn if gadget max_speed is faster than udc it is bound to
+ * @details Validated at enable time, as unbound gadget has no udc to
+ * compare with when max_speed is set.
+ * @param[in] gadget Name of gadget
+ * @param[in] udc Name of udc, NULL to skip the check
+ */
+void gt_gadget_check_max_speed(const char *gadget, const char *udc);
+
+/**
+ * @brief Wait until udc reaches given state
+ * @details Kernel notifies changes of udc state file, so it's read again
+ * only when poll() reports a change. Time elapsed since bind is printed.
+ * Once configured, warning is printed if link is slower than both udc
+ * and gadget allow.
+ * @param[in] gadget Name of gadget bound to udc
+ * @param[in] udc Name of udc
+ * @param[in] state Awaited state, eg. configured
+ * @param[in] timeout Timeout in milliseconds counted from bind, -1 for none
+ * @param[in] bind Time (CLOCK_MONOTONIC) when gadget was bound to udc
+ * @return 0 if state has been reached, -1 otherwise
+ */
+int gt_gadget_wait_udc(const char *gadget, const char *udc,
+		const char *state, int timeout, const struct timespec *bind);
+
+/**
+ * @brief Wait until FunctionFS daemons are ready for bind
+ * @details Daemon is ready when it has written descriptors to ep0, which
+ * makes FunctionFS create the remaining ep files. Their creation is
+ * awaited with inotify, so nothing is polled periodically.
+ * @param[in] instances Names of FunctionFS instances (dev_name)
+ * @param[in] count Number of instances
+ * @param[in] mount_dir Instance which is not mounted yet is mounted at
+ * mount_dir/<instance>, NULL to fail instead
+ * @param[in] timeout Timeout in milliseconds, -1 for none
+ * @return 0 if all daemons are ready, -1 otherwise
+ */
+int gt_gadget_wait_ffs(const char **instances, int count,
+		const char *mount_dir, int timeout);
+
+/**
+ * @brief Get first UDC in alphabetical order, as libusbg does
+ * @param[out] buf name of UDC
+ * @return 0 on success, -1 if there is no UDC
+ */
+int gt_gadget_first_udc(char *buf, size_t size);
+
+/**
+ * @brief Find template in lookup paths
+ * @param[in] name template name
+ * @param[out] buf path of template
+ * @return 1 if found, 0 if not found, -1 on error
+ */
+int gt_gadget_find_template(const char *name, char *buf, size_t size);
+
+/**
+ * @brief Print result of switch
+ * @param[in] udc Name of udc
+ * @param[in] from Gadget unbound from udc, NULL if there was none
+ * @param[in] to Gadget bound to udc
+ * @param[in] start Time (CLOCK_MONOTONIC) of disconnect or unbind
+ * @param[in] end Time (CLOCK_MONOTONIC) of connect or bind
+ */
+void gt_gadget_switch_report(const char *udc, const char *from,
+		const char *to, const struct timespec *start,
+		const struct timespec *end);
+
 struct gt_gadget_create_data {
 	const char *name;
 	int attr_val[USBG_GADGET_ATTR_MAX];
 	char *str_val[GT_GADGET_STRS_COUNT];
+	char *speed_val[GT_GADGET_SPEED_ATTR_MAX];
 	int opts;
 };
 
@@ -105,6 +261,7 @@ struct gt_gadget_rm_data {
 struct gt_gadget_get_data {
 	const char *name;
 	int attrs[USBG_GADGET_ATTR_MAX];
+	int speed_attrs[GT_GADGET_SPEED_ATTR_MAX];
 	int opts;
 };
 
@@ -112,12 +269,23 @@ struct gt_gadget_set_data {
 	const char *name;
 	int attr_val[USBG_GADGET_ATTR_MAX];
 	char *str_val[GT_GADGET_STRS_COUNT];
+	char *speed_val[GT_GADGET_SPEED_ATTR_MAX];
 	int opts;
 };
 
 struct gt_gadget_enable_data {
 	const char *gadget;
 	const char *udc;
+	/* udc state to wait for, NULL if not waiting */
+	const char *wait;
+	/* in milliseconds, -1 for no timeout */
+	int timeout;
+	/* detach pull-up right after bind */
+	int disconnected;
+	/* wait for FunctionFS daemons before bind */
+	int ffs_wait;
+	/* directory to mount FunctionFS instances in, NULL if not mounting */
+	const char *ffs_mount;
 	int opts;
 };
 
@@ -137,6 +305,46 @@ struct gt_gadget_load_data {
 	const char *gadget_name;
 	const char *file;
 	const char *path;
+	const char *record;
+	int opts;
+};
+
+struct gt_gadget_replay_data {
+	const char *file;
+	const char *gadget;
+	int opts;
+};
+
+struct gt_gadget_pool_prepare_data {
+	/* variable is name of gadget (persona), value is scheme */
+	struct gt_setting *personas;
+	const char *path;
+	int opts;
+};
+
+struct gt_gadget_switch_data {
+	const char *udc;
+	/* gadget expected to be bound to udc, NULL to accept any */
+	const char *from;
+	const char *to;
+	/* disconnect udc by soft_connect for the time of switch */
+	int soft_connect;
+	/* udc state to wait for, NULL if not waiting */
+	const char *wait;
+	/* in milliseconds, -1 for no timeout */
+	int timeout;
+	int opts;
+};
+
+struct gt_gadget_apply_data {
+	const char *file;
+	const char *gadget;
+	int opts;
+};
+
+struct gt_gadget_diff_data {
+	const char *gadget;
+	const char *other;
 	int opts;
 };
 
@@ -149,6 +357,12 @@ struct gt_gadget_save_data {
 	int opts;
 };
 
+struct gt_gadget_compile_data {
+	const char *file;
+	const char *output;
+	int opts;
+};
+
 struct gt_gadget_template_data {
 	const char *name;
 	int opts;
@@ -171,6 +385,10 @@ struct gt_gadget_template_get_data {
 	int opts;
 };
 
+struct gt_gadget_template_reindex_data {
+	int opts;
+};
+
 /**
  * @brief Gets the commands possible for gadget
  * @param[in] cmd actual command
@@ -193,6 +411,7 @@ int gt_gadget_help(void *data);
 extern struct gt_gadget_backend gt_gadget_backend_gadgetd;
 #endif
 extern struct gt_gadget_backend gt_gadget_backend_libusbg;
+extern struct gt_gadget_backend gt_gadget_backend_configfs;
 extern struct gt_gadget_backend gt_gadget_backend_not_implemented;
 
 #endif //__GADGET_TOOL_GADGET_GADGET_H__
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file gadget_binary.h
+ * @brief Compiled gadget schemes and replay plans
+ * @details Compiled scheme is a flat list of configfs operations
+ * (directory creation, attribute write, symlink) relative to gadget
+ * directory, followed by a table of NUL-terminated strings. It is
+ * validated when compiled, so loading it requires neither parsing
+ * nor libusbg, only mapping the file and replaying the operations.
+ * Replay plan has the same format, but is recorded from gadget
+ * existing in configfs and holds also its name and UDC.
+ */
+
+#ifndef __GADGET_TOOL_GADGET_GADGET_BINARY_H__
+#define __GADGET_TOOL_GADGET_GADGET_BINARY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define GT_BINARY_MAGIC "GTB1"
+/* detects files compiled on machine with different byte order */
+#define GT_BINARY_ORDER 0x01020304
+
+enum gt_binary_op_type {
+	GT_BINARY_MKDIR = 1,
+	GT_BINARY_WRITE,
+	GT_BINARY_LINK,
+};
+
+struct gt_binary_header {
+	char magic[4];
+	uint32_t order;
+	/* size of whole file */
+	uint32_t size;
+	/* number of operations following header */
+	uint32_t count;
+	/* offset of string table */
+	uint32_t strings;
+	/* source path, offset in string table, 0 if unknown */
+	uint32_t source;
+	/* gadget name and UDC of recorded plan, 0 if unknown */
+	uint32_t name;
+	uint32_t udc;
+	uint32_t reserved;
+	/* fingerprint of source scheme */
+	uint64_t source_hash;
+	/* fingerprint of everything after header */
+	uint64_t hash;
+};
+
+/**
+ * Path and value are offsets in string table. Path is relative to
+ * gadget directory, value is written to attribute or is a link target
+ * relative to gadget directory.
+ */
+struct gt_binary_op {
+	uint32_t type;
+	uint32_t path;
+	uint32_t value;
+};
+
+struct gt_binary {
+	void *map;
+	size_t size;
+	const struct gt_binary_header *header;
+	const struct gt_binary_op *ops;
+	const char *strings;
+};
+
+/**
+ * @brief Compile scheme into binary form
+ * @param[in] source path of scheme
+ * @param[in] output path of compiled scheme
+ * @return 0 on success, -1 otherwise
+ */
+int gt_binary_compile(const char *source, const char *output);
+
+/**
+ * @brief Record replay plan of gadget existing in configfs
+ * @details Writable attributes are recorded with their current values,
+ * symlinks are created after all directories and attributes.
+ * @param[in] root configfs usb_gadget directory
+ * @param[in] name name of gadget
+ * @param[in] output path of plan
+ * @return 0 on success, -1 otherwise
+ */
+int gt_binary_record(const char *root, const char *name, const char *output);
+
+/**
+ * @brief Map and validate compiled scheme
+ * @param[in] file path of compiled scheme
+ * @param[out] bin mapped scheme, should be closed with gt_binary_close()
+ * @return 0 on success, 1 if file is not a compiled scheme, -1 on error
+ */
+int gt_binary_open(const char *file, struct gt_binary *bin);
+
+void gt_binary_close(struct gt_binary *bin);
+
+/**
+ * @brief Check if file starts with compiled scheme magic
+ * @details Used when command is parsed, to load compiled scheme without
+ * scanning configfs. File is fully validated by gt_binary_open() later.
+ * @param[in] file path of scheme
+ * @return 1 if file looks like compiled scheme, 0 otherwise
+ */
+int gt_binary_probe(const char *file);
+
+/**
+ * @brief Check if source of compiled scheme has changed
+ * @details Compiled scheme deployed without its source is considered
+ * up to date.
+ * @return 0 if up to date, -1 otherwise
+ */
+int gt_binary_check_source(const struct gt_binary *bin);
+
+/**
+ * @brief Create gadget described by compiled scheme
+ * @details Gadget is removed again if any operation fails. Directories
+ * created by kernel together with their parent may already exist.
+ * @param[in] bin compiled scheme
+ * @param[in] root configfs usb_gadget directory
+ * @param[in] name name of gadget
+ * @param[in] udc controller to bind gadget to, NULL to leave it unbound
+ * @return 0 on success, -1 otherwise
+ */
+int gt_binary_apply(const struct gt_binary *bin, const char *root,
+		const char *name, const char *udc);
+
+#endif //__GADGET_TOOL_GADGET_GADGET_BINARY_H__
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file gadget_scheme.h
+ * @brief Structural comparison of gadget schemes
+ * @details Both sides of comparison are libconfig trees in the format used
+ * by usbg_import_gadget(). Live gadgets are converted to this format
+ * using usbg_export_gadget().
+ */
+
+#ifndef __GADGET_TOOL_GADGET_GADGET_SCHEME_H__
+#define __GADGET_TOOL_GADGET_GADGET_SCHEME_H__
+
+#include <stdio.h>
+#include <usbg/usbg.h>
+#include <libconfig.h>
+
+enum gt_scheme_change_type {
+	GT_CHANGE_ATTR,
+	GT_CHANGE_STRING,
+	GT_CHANGE_FUNC_ADD,
+	GT_CHANGE_FUNC_RM,
+	/* function attributes differ, function has to be recreated */
+	GT_CHANGE_FUNC_ATTRS,
+	GT_CHANGE_CONFIG_ADD,
+	GT_CHANGE_CONFIG_RM,
+	GT_CHANGE_CONFIG_ATTR,
+	GT_CHANGE_CONFIG_STRING,
+	GT_CHANGE_BINDING_ADD,
+	GT_CHANGE_BINDING_RM,
+};
+
+/**
+ * Single difference between two schemes. Pointers refer to the compared
+ * libconfig trees, so they are valid as long as both trees exist.
+ */
+struct gt_scheme_change {
+	enum gt_scheme_change_type type;
+	/* function or binding target */
+	const char *func_type;
+	const char *instance;
+	/* configuration */
+	const char *label;
+	int id;
+	/* attribute, string or binding name */
+	const char *name;
+	int lang;
+	/* value on old and new side, NULL if absent */
+	const config_setting_t *old_val;
+	const config_setting_t *new_val;
+};
+
+struct gt_scheme_diff {
+	struct gt_scheme_change *changes;
+	int count;
+	int size;
+};
+
+/**
+ * @brief Read scheme from stream
+ * @param[in] fp stream
+ * @param[in] name name of stream used in error messages
+ * @param[out] cfg initialized by this function, should be destroyed by caller
+ * @return 0 on success, -1 otherwise
+ */
+int gt_scheme_read(FILE *fp, const char *name, config_t *cfg);
+
+/**
+ * @brief Convert live gadget to scheme
+ * @param[in] g gadget
+ * @param[out] cfg initialized by this function, should be destroyed by caller
+ * @return 0 on success, -1 otherwise
+ */
+int gt_scheme_export(usbg_gadget *g, config_t *cfg);
+
+/**
+ * @brief Compute changes needed to turn old scheme into new one
+ * @details Attributes and strings not specified in new scheme are not
+ * compared. Functions, configurations and bindings not present in new
+ * scheme are reported as removed.
+ * @param[in] old_root root setting of old scheme (usually live gadget)
+ * @param[in] new_root root setting of new scheme
+ * @param[out] diff list of changes, should be freed with gt_scheme_diff_free()
+ * @return 0 on success, -1 otherwise
+ */
+int gt_scheme_diff(const config_setting_t *old_root,
+		const config_setting_t *new_root, struct gt_scheme_diff *diff);
+
+void gt_scheme_diff_free(struct gt_scheme_diff *diff);
+
+/**
+ * @brief Check if change can be applied while gadget is bound
+ * @details True only for mass storage luns whose medium (file) or its
+ * ro and nofua flags change. Everything else is visible in descriptors
+ * or is refused by kernel while bound, so gadget has to be unbound.
+ */
+int gt_scheme_change_live(const struct gt_scheme_change *ch);
+
+/**
+ * @brief Compare values as gt_scheme_diff() does
+ * @details Members of group a missing in b are not compared.
+ * @return 1 if equal, 0 otherwise
+ */
+int gt_scheme_setting_equal(const config_setting_t *a,
+		const config_setting_t *b);
+
+/**
+ * @brief Print change as single tab-separated line
+ * @details Format: <op> <path> <old value> <new value>, where op is
+ * '+', '-' or '~' and missing value is printed as '-'.
+ */
+void gt_scheme_change_print(FILE *fp, const struct gt_scheme_change *ch);
+
+/**
+ * @brief Copy members of src setting into dst group
+ * @return 0 on success, -1 otherwise
+ */
+int gt_scheme_copy(config_setting_t *dst, const config_setting_t *src);
+
+/**
+ * @brief Get type and instance name of function defined in scheme
+ * @details Instance defaults to the name of function setting.
+ * @return 0 on success, -1 if function has no type
+ */
+int gt_scheme_function_key(const config_setting_t *f, const char **type,
+		const char **instance);
+
+/**
+ * @brief Check if function attribute is set by kernel and cannot be
+ * written (eg. interface name of network functions)
+ */
+int gt_scheme_attr_ignored(const char *name);
+
+#endif //__GADGET_TOOL_GADGET_GADGET_SCHEME_H__
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file template_index.h
+ * @brief Index of gadget templates stored in lookup directories
+ * @details Each lookup directory may contain index file listing templates
+ * with their size, modification time and fingerprint. Index is valid as
+ * long as modification time of directory matches the one recorded in
+ * index, so listing templates requires a single stat() and a single
+ * read instead of scanning the directory. Lookup of a single template
+ * by load doesn't use it, stat() of the template is cheaper and can't
+ * be fooled by coarse directory mtime. Fingerprints are
+ * computed only if the index can be stored, so that read-only lookup
+ * directories aren't read whole on every listing.
+ */
+
+#ifndef __GADGET_TOOL_GADGET_TEMPLATE_INDEX_H__
+#define __GADGET_TOOL_GADGET_TEMPLATE_INDEX_H__
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+/* name of index file in lookup directory, hidden from template listing */
+#define GT_TEMPLATE_INDEX_FILE ".gt-index"
+
+/* fingerprint of template which hasn't been read */
+#define GT_TEMPLATE_HASH_UNKNOWN 0
+
+struct gt_template_entry {
+	char *name;
+	off_t size;
+	time_t mtime;
+	uint64_t hash;
+};
+
+struct gt_template_index {
+	struct gt_template_entry *entries;
+	int count;
+	struct timespec dir_mtime;
+};
+
+/**
+ * @brief Get index of directory
+ * @details Stored index is used if still valid. Otherwise directory is
+ * scanned and index is stored again if directory is writable.
+ * Fingerprints of unchanged templates are taken from the old index,
+ * others are computed only if directory is writable.
+ * @param[in] dir lookup directory
+ * @param[out] idx index, sorted by name
+ * @param[in] verify compare size and mtime of each template with its
+ * entry, so that fingerprints of templates edited in place are not stale
+ * @return 0 on success, -1 otherwise
+ */
+int gt_template_index_get(const char *dir, struct gt_template_index *idx,
+		int verify);
+
+/**
+ * @brief Scan directory and store its index unconditionally
+ * @param[in] dir lookup directory
+ * @param[out] idx index, sorted by name
+ * @return 0 on success, -1 otherwise
+ */
+int gt_template_index_rebuild(const char *dir, struct gt_template_index *idx);
+
+/**
+ * @brief Find template in index
+ * @return Entry or NULL if not found
+ */
+const struct gt_template_entry *gt_template_index_find(
+		const struct gt_template_index *idx, const char *name);
+
+void gt_template_index_free(struct gt_template_index *idx);
+
+#endif //__GADGET_TOOL_GADGET_TEMPLATE_INDEX_H__
@@ -24,23 +24,646 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <time.h>
+#include <dirent.h>
+#include <mntent.h>
+#include <sys/inotify.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
 
 #include "gadget.h"
 #include "common.h"
 #include "parser.h"
 #include "backend.h"
+#include "settings.h"
+#include "gadget_binary.h"
+#include "trace.h"
 
 #define GET_EXECUTABLE(func) \
 	(backend_ctx.backend->gadget->func ? \
 	 backend_ctx.backend->gadget->func : \
+	 backend_ctx.backend_type == GT_BACKEND_CONFIGFS && \
+	 gt_gadget_backend_libusbg.func ? \
+	 gt_gadget_backend_libusbg.func : \
 	 gt_gadget_backend_not_implemented.func)
 
+/*
+ * Commands implemented by configfs backend open only directories they
+ * touch, so configfs doesn't have to be scanned by libusbg before.
+ */
+#define GET_SCOPE(func, scope) \
+	(backend_ctx.backend_type == GT_BACKEND_CONFIGFS && \
+	 backend_ctx.backend->gadget->func ? GT_SCOPE_NONE : (scope))
+
 const struct gt_gadget_str gadget_strs[] = {
 	{ "product", usbg_set_gadget_product },
 	{ "manufacturer", usbg_set_gadget_manufacturer },
 	{ "serialnumber", usbg_set_gadget_serial_number },
 };
 
+void gt_print_gadget_attrs(const struct usbg_gadget_attrs *g_attrs,
+		const int *mask)
+{
+	if (!mask || mask[USBG_BCD_USB])
+		printf("  bcdUSB\t\t%x.%02x\n",
+			g_attrs->bcdUSB >> 8,
+			g_attrs->bcdUSB & 0x00ff);
+
+	if (!mask || mask[USBG_B_DEVICE_CLASS])
+		printf("  bDeviceClass\t\t0x%02x\n", g_attrs->bDeviceClass);
+	if (!mask || mask[USBG_B_DEVICE_SUB_CLASS])
+		printf("  bDeviceSubClass\t0x%02x\n", g_attrs->bDeviceSubClass);
+	if (!mask || mask[USBG_B_DEVICE_PROTOCOL])
+		printf("  bDeviceProtocol\t0x%02x\n", g_attrs->bDeviceProtocol);
+	if (!mask || mask[USBG_B_MAX_PACKET_SIZE_0])
+		printf("  bMaxPacketSize0\t%d\n", g_attrs->bMaxPacketSize0);
+	if (!mask || mask[USBG_ID_VENDOR])
+		printf("  idVendor\t\t0x%04x\n", g_attrs->idVendor);
+	if (!mask || mask[USBG_ID_PRODUCT])
+		printf("  idProduct\t\t0x%04x\n", g_attrs->idProduct);
+	if (!mask || mask[USBG_BCD_DEVICE])
+		printf("  bcdDevice\t\t%x.%02x\n",
+			g_attrs->bcdDevice >> 8,
+			g_attrs->bcdDevice & 0x00ff);
+}
+
+/* states reported by /sys/class/udc/<udc>/state */
+static const char *udc_states[] = {
+	"not attached",
+	"attached",
+	"powered",
+	"reconnecting",
+	"unauthenticated",
+	"default",
+	"addressed",
+	"configured",
+	"suspended",
+	NULL
+};
+
+static long elapsed_ms(const struct timespec *since)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - since->tv_sec) * 1000
+		+ (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+static int read_value(const char *path, char *buf, size_t size)
+{
+	ssize_t len;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	len = read(fd, buf, size - 1);
+	close(fd);
+	if (len <= 0)
+		return -1;
+
+	buf[len] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return 0;
+}
+
+const char *gadget_speed_attrs[GT_GADGET_SPEED_ATTR_MAX] = {
+	[GT_GADGET_MAX_SPEED] = "max_speed",
+	[GT_GADGET_SSP_RATE] = "ssp_rate",
+};
+
+/* values accepted by kernel */
+static const char *max_speed_values[] = {
+	"low-speed",
+	"full-speed",
+	"high-speed",
+	"super-speed",
+	"super-speed-plus",
+	NULL
+};
+
+static const char *ssp_rate_values[] = {
+	"super-speed-plus-gen2x1",
+	"super-speed-plus-gen1x2",
+	"super-speed-plus-gen2x2",
+	NULL
+};
+
+int gt_gadget_lookup_speed_attr(const char *name)
+{
+	int i;
+
+	for (i = 0; i < GT_GADGET_SPEED_ATTR_MAX; i++)
+		if (streq(gadget_speed_attrs[i], name))
+			return i;
+
+	return -1;
+}
+
+int gt_gadget_speed_attr_valid(int attr, const char *val)
+{
+	const char **v;
+
+	v = attr == GT_GADGET_MAX_SPEED ? max_speed_values : ssp_rate_values;
+	for (; *v; v++)
+		if (streq(*v, val))
+			return 1;
+
+	return 0;
+}
+
+static int speed_attr_path(char *buf, size_t size, const char *gadget,
+		int attr)
+{
+	return snprintf(buf, size, "%s/usb_gadget/%s/%s",
+			gt_settings.configfs_path, gadget,
+			gadget_speed_attrs[attr]) < size ? 0 : -1;
+}
+
+/**
+ * @brief Get name of udc gadget is bound to
+ * @return 0 if gadget is bound, -1 otherwise
+ */
+static int gadget_udc(const char *gadget, char *buf, size_t size)
+{
+	char path[PATH_MAX];
+
+	if (snprintf(path, sizeof(path), "%s/usb_gadget/%s/UDC",
+		     gt_settings.configfs_path, gadget) >= sizeof(path))
+		return -1;
+
+	return read_value(path, buf, size) == 0 && buf[0] ? 0 : -1;
+}
+
+int gt_gadget_get_speed_attr(const char *gadget, int attr, char *buf,
+		size_t size)
+{
+	char path[PATH_MAX];
+
+	if (speed_attr_path(path, sizeof(path), gadget, attr) < 0)
+		return -1;
+
+	return read_value(path, buf, size);
+}
+
+/**
+ * @brief Check that udc is not slower than requested max_speed
+ * @return 0 if udc supports speed or its maximum_speed can't be read,
+ * -1 otherwise
+ */
+static int udc_supports_speed(const char *udc, const char *speed)
+{
+	char path[PATH_MAX];
+	char max[32];
+
+	snprintf(path, sizeof(path), GT_UDC_DIR "/%s/maximum_speed", udc);
+	if (read_value(path, max, sizeof(max)) < 0)
+		return 0;
+
+	return gt_speed_rank(speed) > gt_speed_rank(max) ? -1 : 0;
+}
+
+int gt_gadget_set_speed_attr(const char *gadget, int attr, const char *val)
+{
+	const char *name = gadget_speed_attrs[attr];
+	char udc[NAME_MAX + 1];
+	char path[PATH_MAX];
+	long long start;
+	size_t len = strlen(val);
+	int ret = -1;
+	int fd;
+
+	if (speed_attr_path(path, sizeof(path), gadget, attr) < 0) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	/* bound gadget would never run faster than its controller */
+	if (attr == GT_GADGET_MAX_SPEED
+	    && gadget_udc(gadget, udc, sizeof(udc)) == 0
+	    && udc_supports_speed(udc, val) < 0) {
+		fprintf(stderr, "Unable to set %s to %s, udc %s is slower\n",
+			name, val, udc);
+		return -1;
+	}
+
+	start = gt_trace_now();
+	fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd >= 0) {
+		ret = write(fd, val, len) == len ? 0 : -1;
+		close(fd);
+	}
+	gt_trace_event("configfs", "write", path, start, ret);
+
+	if (ret < 0)
+		fprintf(stderr, "Unable to set %s: %s\n", name,
+			errno == ENOENT ? "not supported by kernel"
+			: strerror(errno));
+
+	return ret;
+}
+
+void gt_print_gadget_speed_attrs(const char *gadget, const int *mask)
+{
+	char buf[32];
+	int i;
+
+	for (i = 0; i < GT_GADGET_SPEED_ATTR_MAX; i++) {
+		if (mask && !mask[i])
+			continue;
+
+		if (gt_gadget_get_speed_attr(gadget, i, buf, sizeof(buf)) == 0)
+			printf("  %s\t\t%s\n", gadget_speed_attrs[i], buf);
+	}
+}
+
+void gt_gadget_check_max_speed(const char *gadget, const char *udc)
+{
+	char speed[32];
+
+	if (udc == NULL
+	    || gt_gadget_get_speed_attr(gadget, GT_GADGET_MAX_SPEED, speed,
+					sizeof(speed)) < 0)
+		return;
+
+	/* fastest speed is what kernel reports for max_speed never set */
+	if (streq(speed, "super-speed-plus")
+	    || udc_supports_speed(udc, speed) == 0)
+		return;
+
+	fprintf(stderr, "Warning: gadget %s max_speed %s exceeds maximum_speed of udc %s\n",
+		gadget, speed, udc);
+}
+
+/**
+ * @brief Warn if configured gadget runs slower than it could
+ * @details Expected speed is the lower of udc maximum_speed and gadget
+ * max_speed, as in udc -v. bcdUSB doesn't limit it, composite layer
+ * rewrites it according to udc. Attributes which can't be read (eg.
+ * max_speed on older kernels) don't limit it.
+ */
+static void check_speed(const char *gadget, const char *udc)
+{
+	char path[PATH_MAX];
+	char current[32], udc_max[32];
+	char gadget_max[32] = "";
+	const char *expected;
+
+	snprintf(path, sizeof(path), GT_UDC_DIR "/%s/current_speed", udc);
+	if (read_value(path, current, sizeof(current)) < 0)
+		return;
+
+	snprintf(path, sizeof(path), GT_UDC_DIR "/%s/maximum_speed", udc);
+	if (read_value(path, udc_max, sizeof(udc_max)) < 0)
+		return;
+	expected = udc_max;
+
+	snprintf(path, sizeof(path), "%s/usb_gadget/%s/max_speed",
+		 gt_settings.configfs_path, gadget);
+	if (read_value(path, gadget_max, sizeof(gadget_max)) == 0
+	    && gt_speed_rank(gadget_max) > 0
+	    && gt_speed_rank(gadget_max) < gt_speed_rank(expected))
+		expected = gadget_max;
+
+	if (gt_speed_rank(current) < gt_speed_rank(expected))
+		fprintf(stderr, "Warning: gadget %s runs at %s on %s, expected %s "
+			"(udc maximum_speed %s, max_speed %s)\n",
+			gadget, current, udc, expected, udc_max,
+			gadget_max[0] ? gadget_max : "-");
+}
+
+int gt_gadget_wait_udc(const char *gadget, const char *udc,
+		const char *state, int timeout, const struct timespec *bind)
+{
+	char path[PATH_MAX];
+	char buf[64];
+	struct pollfd pfd;
+	ssize_t len;
+	long elapsed;
+	int ret = -1;
+
+	if (snprintf(path, sizeof(path), GT_UDC_DIR "/%s/state", udc)
+	    >= sizeof(path)) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	pfd.fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (pfd.fd < 0) {
+		fprintf(stderr, "Unable to open %s: %s\n", path,
+			strerror(errno));
+		return -1;
+	}
+	pfd.events = POLLPRI | POLLERR;
+
+	while (1) {
+		/* reading the file rearms notification */
+		len = pread(pfd.fd, buf, sizeof(buf) - 1, 0);
+		if (len < 0) {
+			fprintf(stderr, "Unable to read %s: %s\n", path,
+				strerror(errno));
+			break;
+		}
+		buf[len] = '\0';
+		buf[strcspn(buf, "\n")] = '\0';
+
+		elapsed = elapsed_ms(bind);
+		if (streq(buf, state)) {
+			printf("%s %s after %ld ms\n", udc, state, elapsed);
+			if (streq(state, "configured"))
+				check_speed(gadget, udc);
+			ret = 0;
+			break;
+		}
+
+		if (timeout >= 0 && elapsed >= timeout) {
+			fprintf(stderr, "Timeout waiting for %s to be %s, it is %s\n",
+				udc, state, buf);
+			break;
+		}
+
+		if (poll(&pfd, 1, timeout >= 0 ? timeout - elapsed : -1) < 0
+		    && errno != EINTR) {
+			perror("poll");
+			break;
+		}
+	}
+
+	close(pfd.fd);
+	return ret;
+}
+
+/**
+ * @brief Find where FunctionFS instance is mounted
+ * @return 0 if found, -1 otherwise
+ */
+static int ffs_mount_point(const char *instance, char *buf, size_t size)
+{
+	struct mntent *m;
+	FILE *mounts;
+	int ret = -1;
+
+	mounts = setmntent("/proc/self/mounts", "r");
+	if (mounts == NULL)
+		return -1;
+
+	while ((m = getmntent(mounts)) != NULL) {
+		if (streq(m->mnt_type, "functionfs")
+		    && streq(m->mnt_fsname, instance)
+		    && snprintf(buf, size, "%s", m->mnt_dir) < size) {
+			ret = 0;
+			break;
+		}
+	}
+
+	endmntent(mounts);
+	return ret;
+}
+
+static int ffs_mount(const char *instance, const char *dir, char *buf,
+		size_t size)
+{
+	long long start;
+	int ret;
+
+	if (snprintf(buf, size, "%s/%s", dir, instance) >= size) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	if (mkdir(buf, 0755) < 0 && errno != EEXIST) {
+		fprintf(stderr, "Unable to create %s: %s\n", buf,
+			strerror(errno));
+		return -1;
+	}
+
+	start = gt_trace_now();
+	ret = mount(instance, buf, "functionfs", 0, NULL);
+	gt_trace_event("ffs", "mount", buf, start, ret);
+	if (ret < 0)
+		fprintf(stderr, "Unable to mount %s at %s: %s\n", instance, buf,
+			strerror(errno));
+
+	return ret;
+}
+
+/**
+ * @brief Check if daemon has written descriptors
+ * @details Only ep0 exists until then.
+ */
+static int ffs_ready(const char *path)
+{
+	struct dirent *d;
+	DIR *dir;
+	int ret = 0;
+
+	dir = opendir(path);
+	if (dir == NULL)
+		return 0;
+
+	while ((d = readdir(dir)) != NULL) {
+		if (d->d_name[0] != '.' && !streq(d->d_name, "ep0")) {
+			ret = 1;
+			break;
+		}
+	}
+
+	closedir(dir);
+	return ret;
+}
+
+int gt_gadget_wait_ffs(const char **instances, int count,
+		const char *mount_dir, int timeout)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	char path[PATH_MAX];
+	struct timespec start;
+	struct pollfd pfd;
+	int pending = 0;
+	long elapsed;
+	ssize_t len;
+	int ret = -1;
+	int *wd;
+	int i, n;
+
+	if (count == 0)
+		return 0;
+
+	wd = calloc(count, sizeof(*wd));
+	if (wd == NULL)
+		return -1;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pfd.events = POLLIN;
+	pfd.fd = inotify_init1(IN_CLOEXEC);
+	if (pfd.fd < 0) {
+		perror("inotify_init1");
+		free(wd);
+		return -1;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (ffs_mount_point(instances[i], path, sizeof(path)) < 0) {
+			if (mount_dir == NULL) {
+				fprintf(stderr, "FunctionFS instance %s is not mounted\n",
+					instances[i]);
+				goto out;
+			}
+
+			if (ffs_mount(instances[i], mount_dir, path,
+				      sizeof(path)) < 0)
+				goto out;
+		}
+
+		/* watch first, so files created meanwhile are not missed */
+		wd[i] = inotify_add_watch(pfd.fd, path, IN_CREATE | IN_ONLYDIR);
+		if (wd[i] < 0) {
+			fprintf(stderr, "Unable to watch %s: %s\n", path,
+				strerror(errno));
+			goto out;
+		}
+
+		if (ffs_ready(path)) {
+			printf("%s ready after %ld ms\n", instances[i],
+			       elapsed_ms(&start));
+			wd[i] = -1;
+		} else {
+			pending++;
+		}
+	}
+
+	while (pending > 0) {
+		elapsed = elapsed_ms(&start);
+		if (timeout >= 0 && elapsed >= timeout) {
+			for (i = 0; i < count; i++)
+				if (wd[i] >= 0)
+					fprintf(stderr, "Timeout waiting for FunctionFS daemon of %s\n",
+						instances[i]);
+			break;
+		}
+
+		n = poll(&pfd, 1, timeout >= 0 ? timeout - elapsed : -1);
+		if (n < 0 && errno != EINTR) {
+			perror("poll");
+			break;
+		}
+		if (n <= 0)
+			continue;
+
+		len = read(pfd.fd, buf, sizeof(buf));
+		if (len < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			perror("read");
+			break;
+		}
+
+		for (ev = (void *)buf; (char *)ev < buf + len;
+		     ev = (void *)((char *)ev + sizeof(*ev) + ev->len)) {
+			for (i = 0; i < count; i++)
+				if (wd[i] == ev->wd)
+					break;
+			if (i == count)
+				continue;
+
+			if (ev->mask & IN_IGNORED) {
+				fprintf(stderr, "FunctionFS instance %s has been unmounted\n",
+					instances[i]);
+				goto out;
+			}
+
+			if (ev->len == 0 || streq(ev->name, "ep0"))
+				continue;
+
+			printf("%s ready after %ld ms\n", instances[i],
+			       elapsed_ms(&start));
+			wd[i] = -1;
+			pending--;
+		}
+	}
+
+	if (pending == 0)
+		ret = 0;
+out:
+	close(pfd.fd);
+	free(wd);
+	return ret;
+}
+
+static int skip_dentry(const struct dirent *d)
+{
+	return d->d_name[0] != '.';
+}
+
+int gt_gadget_first_udc(char *buf, size_t size)
+{
+	struct dirent **names;
+	int ret = -1;
+	int n, i;
+
+	n = scandir(GT_UDC_DIR, &names, skip_dentry, alphasort);
+	if (n < 0)
+		return -1;
+
+	if (n > 0 && strlen(names[0]->d_name) < size) {
+		strcpy(buf, names[0]->d_name);
+		ret = 0;
+	}
+
+	for (i = 0; i < n; i++)
+		free(names[i]);
+	free(names);
+
+	return ret;
+}
+
+/*
+ * Checked with stat() rather than with template index, which is trusted
+ * by directory mtime only and could miss template added or removed within
+ * the same tick.
+ */
+int gt_gadget_find_template(const char *name, char *buf, size_t size)
+{
+	const char **ptr;
+	struct stat st;
+	int ret;
+
+	if (gt_settings.lookup_path == NULL)
+		return 0;
+
+	for (ptr = gt_settings.lookup_path; *ptr; ptr++) {
+		ret = snprintf(buf, size, "%s/%s", *ptr, name);
+		if (ret >= size) {
+			fprintf(stderr, "path too long\n");
+			return -1;
+		}
+
+		if (stat(buf, &st) == 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+void gt_gadget_switch_report(const char *udc, const char *from,
+		const char *to, const struct timespec *start,
+		const struct timespec *end)
+{
+	long gap;
+
+	gap = (end->tv_sec - start->tv_sec) * 1000000
+		+ (end->tv_nsec - start->tv_nsec) / 1000;
+
+	printf("%s: %s -> %s, disconnected for %ld us\n", udc,
+	       from ? from : "none", to, gap);
+}
+
 static void gt_gadget_create_destructor(void *data)
 {
 	struct gt_gadget_create_data *dt;
@@ -51,6 +674,8 @@ static void gt_gadget_create_destructor(void *data)
 	dt = (struct gt_gadget_create_data *)data;
 	for (i = 0; i < GT_GADGET_STRS_COUNT; i++)
 		free(dt->str_val[i]);
+	for (i = 0; i < GT_GADGET_SPEED_ATTR_MAX; i++)
+		free(dt->speed_val[i]);
 
 	free(dt);
 }
@@ -102,6 +727,8 @@ static int gt_gadget_create_help(void *data)
 
 	for (i = USBG_GADGET_ATTR_MIN; i < USBG_GADGET_ATTR_MAX; i++)
 		printf("  %s\n", usbg_get_gadget_attr_str(i));
+	for (i = 0; i < GT_GADGET_SPEED_ATTR_MAX; i++)
+		printf("  %s\n", gadget_speed_attrs[i]);
 
 	printf("Device strings (en_US locale):\n");
 
@@ -111,7 +738,8 @@ static int gt_gadget_create_help(void *data)
 	return -1;
 }
 
-static int gt_parse_gadget_attrs(struct gt_setting *attrs, int *attr_val, char **str_val)
+static int gt_parse_gadget_attrs(struct gt_setting *attrs, int *attr_val,
+		char **str_val, char **speed_val)
 {
 	struct gt_setting *setting;
 	int attr_id;
@@ -150,6 +778,22 @@ static int gt_parse_gadget_attrs(struct gt_setting *attrs, int *attr_val, char *
 #endif
 		}
 
+		attr_id = gt_gadget_lookup_speed_attr(setting->variable);
+		if (iter && attr_id >= 0) {
+			if (!gt_gadget_speed_attr_valid(attr_id, setting->value)) {
+				fprintf(stderr, "Invalid value '%s' for attribute '%s'\n",
+					setting->value, setting->variable);
+				return -1;
+			}
+
+			speed_val[attr_id] = setting->value;
+#ifdef WITH_GADGETD
+			iter = FALSE;
+#else
+			iter = false;
+#endif
+		}
+
 		for (i = 0; iter && i < GT_GADGET_STRS_COUNT; i++) {
 			if (streq(setting->variable, gadget_strs[i].name)) {
 				str_val[i] = setting->value;
@@ -201,11 +845,19 @@ static void gt_parse_gadget_create(const Command *cmd, int argc, char **argv,
 	for (i = 0; i < USBG_GADGET_ATTR_MAX; i++)
 		dt->attr_val[i] = -1;
 	memset(dt->str_val, 0, sizeof(dt->str_val));
+	memset(dt->speed_val, 0, sizeof(dt->speed_val));
 
-	gt_parse_gadget_attrs(attrs, dt->attr_val, dt->str_val);
+	if (gt_parse_gadget_attrs(attrs, dt->attr_val, dt->str_val,
+				  dt->speed_val) < 0) {
+		/* values are freed together with attrs */
+		memset(dt->str_val, 0, sizeof(dt->str_val));
+		memset(dt->speed_val, 0, sizeof(dt->speed_val));
+		goto out;
+	}
 
 	executable_command_set(exec, GET_EXECUTABLE(create),
 				(void *)dt, gt_gadget_create_destructor);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->name);
 
 	return;
 out:
@@ -247,6 +899,7 @@ static void gt_parse_gadget_rm(const Command *cmd, int argc, char **argv,
 	dt->name = argv[ind];
 	executable_command_set(exec, GET_EXECUTABLE(rm), (void *)dt,
 			free);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->name);
 	return;
 out:
 	free(dt);
@@ -305,12 +958,18 @@ static void gt_parse_gadget_get(const Command *cmd, int argc, char **argv,
 	iter = 0;
 	while (argv[ind]) {
 		attr_id = usbg_lookup_gadget_attr(argv[ind]);
-		if (attr_id < 0) {
-			fprintf(stderr, "%s: invalid attribute name\n", argv[ind]);
-			goto out;
+		if (attr_id >= 0) {
+			dt->attrs[attr_id] = 1;
+		} else {
+			attr_id = gt_gadget_lookup_speed_attr(argv[ind]);
+			if (attr_id < 0) {
+				fprintf(stderr, "%s: invalid attribute name\n",
+					argv[ind]);
+				goto out;
+			}
+			dt->speed_attrs[attr_id] = 1;
 		}
 
-		dt->attrs[attr_id] = 1;
 		ind++;
 		iter = 1;
 	}
@@ -318,11 +977,15 @@ static void gt_parse_gadget_get(const Command *cmd, int argc, char **argv,
 	if (!iter) {
 		for (i = 0; i < USBG_GADGET_ATTR_MAX; ++i)
 			dt->attrs[i] = 1;
+		for (i = 0; i < GT_GADGET_SPEED_ATTR_MAX; ++i)
+			dt->speed_attrs[i] = 1;
 	}
 
 
 	executable_command_set(exec, GET_EXECUTABLE(get), (void *)dt,
 			gt_gadget_get_destructor);
+	executable_command_set_scope(exec,
+			GET_SCOPE(get, GT_SCOPE_GADGET), dt->name);
 
 	return;
 out:
@@ -373,94 +1036,616 @@ static void gt_parse_gadget_set(const Command *cmd, int argc, char **argv,
 	if (argc - ind < 2)
 		goto out;
 
-	dt->name = argv[ind++];
-	tmp = gt_parse_setting_list(&attrs, argc - ind, argv + ind);
-	if (tmp < 0)
+	dt->name = argv[ind++];
+	tmp = gt_parse_setting_list(&attrs, argc - ind, argv + ind);
+	if (tmp < 0)
+		goto out;
+
+	for (i = 0; i < USBG_GADGET_ATTR_MAX; i++)
+		dt->attr_val[i] = -1;
+	memset(dt->str_val, 0, sizeof(dt->str_val));
+	memset(dt->speed_val, 0, sizeof(dt->speed_val));
+
+	if (gt_parse_gadget_attrs(attrs, dt->attr_val, dt->str_val,
+				  dt->speed_val) < 0)
+		goto out;
+
+	executable_command_set(exec, GET_EXECUTABLE(set), (void *)dt,
+			gt_gadget_set_destructor);
+	executable_command_set_scope(exec,
+			GET_SCOPE(set, GT_SCOPE_GADGET), dt->name);
+	return;
+out:
+	gt_gadget_set_destructor((void *)dt);
+	executable_command_set(exec, cmd->printHelp, data, NULL);
+}
+
+static int gt_gadget_enable_help(void *data)
+{
+	printf("usage: %s enable [options] <gadget> [udc] \n"
+	       "Enable gadget. If udc has not been specified, default one is used.\n"
+	       "\n"
+	       "Options:\n"
+	       "  --wait[=<state>]\tWait until udc is in state (default configured)\n"
+	       "\t\tand print time elapsed since bind\n"
+	       "  --timeout=<sec>\tFail if state is not reached in given time,\n"
+	       "\t\tapplies also to --ffs-wait\n"
+	       "  --disconnected\tBind gadget but keep it detached from host\n"
+	       "\t\tuntil 'udc connect' is called\n"
+	       "  --ffs-wait\tBefore bind, wait until daemons of all ffs\n"
+	       "\t\tfunctions have written their descriptors\n"
+	       "  --ffs-mount=<dir>\tAs --ffs-wait, mount instances which are\n"
+	       "\t\tnot mounted yet at <dir>/<instance> first\n"
+	       "  -h, --help\tPrint this help\n",
+	       program_name);
+
+	return -1;
+}
+
+/**
+ * @brief Parse --wait (c == 1) or --timeout (c == 2) option
+ * @return 0 on success, -1 if value is invalid
+ */
+static int parse_wait_option(int c, const char **wait, int *timeout)
+{
+	const char **state;
+	double val;
+	char *end;
+
+	if (c == 1) {
+		*wait = optarg ? optarg : "configured";
+		for (state = udc_states; *state; state++)
+			if (streq(*state, *wait))
+				return 0;
+
+		fprintf(stderr, "Unknown udc state %s\n", *wait);
+		return -1;
+	}
+
+	val = strtod(optarg, &end);
+	if (*end || end == optarg || val < 0 || val > INT_MAX / 1000)
+		return -1;
+
+	*timeout = val * 1000;
+	return 0;
+}
+
+static void gt_parse_gadget_enable(const Command *cmd, int argc,
+		char **argv, ExecutableCommand *exec, void * data)
+{
+	struct gt_gadget_enable_data *dt;
+	int c;
+	struct option opts[] = {
+		{"wait", optional_argument, 0, 1},
+		{"timeout", required_argument, 0, 2},
+		{"disconnected", no_argument, 0, 3},
+		{"ffs-wait", no_argument, 0, 4},
+		{"ffs-mount", required_argument, 0, 5},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	dt = zalloc(sizeof(*dt));
+	if (dt == NULL)
+		goto out;
+
+	dt->timeout = -1;
+	argv--;
+	argc++;
+	while (1) {
+		int opt_index = 0;
+		c = getopt_long(argc, argv, "h", opts, &opt_index);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 1:
+		case 2:
+			if (parse_wait_option(c, &dt->wait, &dt->timeout) < 0)
+				goto out;
+			break;
+		case 3:
+			dt->disconnected = 1;
+			break;
+		case 5:
+			dt->ffs_mount = optarg;
+			/* fall through */
+		case 4:
+			dt->ffs_wait = 1;
+			break;
+		case 'h':
+		default:
+			goto out;
+		}
+	}
+
+	if (dt->timeout >= 0 && !dt->wait && !dt->ffs_wait)
+		goto out;
+
+	/* host can't configure a device which is not attached */
+	if (dt->disconnected && dt->wait)
+		goto out;
+
+	switch (argc - optind) {
+	case 1:
+		dt->gadget = argv[optind++];
+		break;
+	case 2:
+		dt->gadget = argv[optind++];
+		dt->udc = argv[optind++];
+		break;
+	default:
+		goto out;
+	}
+
+	executable_command_set(exec, GET_EXECUTABLE(enable),
+				(void *)dt, free);
+	executable_command_set_scope(exec,
+			GET_SCOPE(enable, GT_SCOPE_GADGET), dt->gadget);
+	return;
+out:
+	free((void *)dt);
+	executable_command_set(exec, cmd->printHelp, data, NULL);
+}
+
+static int gt_gadget_disable_help(void *data)
+{
+	printf("usage: %s disable [options] [gadget] \n"
+	       "Disable gadget. If gadget has been specified it is disabled, otherwise: if "
+	       "only one gadget exist it is used, if more than one gadget exist including "
+	       "default gadget, the default is disabled else error due to ambiguous gadget name "
+	       "unless -u or --udc option was used."
+	       "\n"
+	       "Options:\n"
+	       "  -u=<udc>, --udc=<udc>\tDisable gadget which is active at given udc\n"
+	       "  -h, --help\tPrint this help\n",
+	       program_name);
+
+	return -1;
+}
+
+static void gt_parse_gadget_disable(const Command *cmd, int argc,
+		char **argv, ExecutableCommand *exec, void * data)
+{
+	struct gt_gadget_disable_data *dt;
+	int c;
+	struct option opts[] = {
+		{"udc", required_argument, 0, 'u'},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	dt = zalloc(sizeof(*dt));
+	if (dt == NULL)
+		goto out;
+	argv--;
+	argc++;
+	while (1) {
+		int opt_index = 0;
+		c = getopt_long(argc, argv, "u:h", opts, &opt_index);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'u':
+			dt->udc = optarg;
+			break;
+		case 'h':
+			goto out;
+			break;
+		default:
+			goto out;
+		}
+	}
+
+	if (optind < argc - 1 || (dt->udc && optind < argc)) {
+		printf("Too many arguments\n");
+		goto out;
+	}
+
+	dt->gadget = argv[optind];
+	executable_command_set(exec, GET_EXECUTABLE(disable), (void *)dt, free);
+	executable_command_set_scope(exec,
+			GET_SCOPE(disable, GT_SCOPE_GADGET), dt->gadget);
+	return;
+out:
+	free(dt);
+	executable_command_set(exec, cmd->printHelp, data, NULL);
+}
+
+static int gt_gadget_gadget_help(void *data)
+{
+	printf("usage: %s gadget [options] [gadget] \n"
+	       "If no gadget specified shows the list of gadgets, otherwise shows the gadget "
+	       "name, list of configurations and list of functions."
+	       "\n"
+	       "Options:\n"
+	       "  -v, --verbose\t\tShow not only name of gadget but also its attributes\n"
+	       "  -r, --recursive\tShow the details about each function and configuration\n"
+	       "  -q, --quiet\t\tShow only list of gadget names\n"
+	       "  --json\t\tShow gadgets with all details as JSON document\n"
+	       "  -h, --help\t\tPrint this help\n",
+	       program_name);
+
+	return -1;
+}
+
+static void gt_parse_gadget_gadget(const Command *cmd, int argc,
+		char **argv, ExecutableCommand *exec, void * data)
+{
+	struct gt_gadget_gadget_data *dt;
+	int ind;
+	int avaible_opts = GT_RECURSIVE | GT_VERBOSE | GT_HELP | GT_QUIET
+		| GT_JSON;
+
+	dt = zalloc(sizeof(*dt));
+	if (dt == NULL)
+		goto out;
+
+	ind = gt_get_options(&dt->opts, avaible_opts, argc, argv);
+	if (ind < 0 || dt->opts & GT_HELP)
+		goto out;
+
+	switch (argc - ind) {
+	case 0:
+		break;
+	case 1:
+		dt->name = argv[ind];
+		break;
+	default:
+		goto out;
+	}
+
+	executable_command_set(exec, GET_EXECUTABLE(gadget), (void *)dt,
+		free);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->name);
+	return;
+out:
+	free(dt);
+	executable_command_set(exec, cmd->printHelp, data, NULL);
+}
+
+static int gt_gadget_load_help(void *data)
+{
+	printf("usage: %s load <name> [gadget_name]\n"
+	       "Loads the gadget settings related to name, creates and enables\n"
+	       "the created gadget.\n"
+	       "Options:\n"
+	       "  -o, --off\t\tDon't enable gadget after load\n"
+	       "  --file=<gadget_file>\tloads gadget from file instead of from paths\n"
+	       "  --stdin\t\tloads gadget from stdin\n"
+	       "  --path=<path>\t\tloads gadget located in some path instead of from standard paths\n"
+	       "  --if-changed\t\tdo nothing if gadget has been loaded from the same\n"
+	       "\t\t\tscheme and has not been modified since, otherwise\n"
+	       "\t\t\treplace existing gadget\n"
+	       "  --record=<plan>\tstore configfs operations creating loaded\n"
+	       "\t\t\tgadget in plan, which can be used by replay\n"
+	       "  -h, --help\t\tPrint this help\n",
+	       program_name);
+
+	return -1;
+}
+
+/**
+ * @brief Check if load source resolves to compiled scheme
+ * @details Same lookup as done by load, file which can't be found is
+ * reported by load itself.
+ */
+static int load_compiled(const struct gt_gadget_load_data *dt)
+{
+	char buf[PATH_MAX];
+	const char *file = dt->name;
+
+	if (dt->opts & GT_STDIN)
+		return 0;
+
+	if (dt->file) {
+		file = dt->file;
+	} else if (dt->path) {
+		if (snprintf(buf, sizeof(buf), "%s/%s", dt->path, dt->name)
+		    >= sizeof(buf))
+			return 0;
+		file = buf;
+	} else if (gt_gadget_find_template(dt->name, buf, sizeof(buf)) > 0) {
+		file = buf;
+	}
+
+	return gt_binary_probe(file);
+}
+
+static void gt_parse_gadget_load(const Command *cmd, int argc,
+		char **argv, ExecutableCommand *exec, void * data)
+{
+	int c;
+	struct gt_gadget_load_data *dt;
+	struct option opts[] = {
+		{"off", no_argument, 0, 'o'},
+		{"file", required_argument, 0, 1},
+		{"stdin", no_argument, 0, 2},
+		{"path", required_argument, 0, 3},
+		{"if-changed", no_argument, 0, 4},
+		{"record", required_argument, 0, 5},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	dt = zalloc(sizeof(*dt));
+	if (dt == NULL)
+		goto out;
+	argv--;
+	argc++;
+	while (1) {
+		int opt_index = 0;
+		c = getopt_long(argc, argv, "oh", opts, &opt_index);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'o':
+			dt->opts |= GT_OFF;
+			break;
+		case 1:
+			if (dt->path || dt->opts & GT_STDIN)
+				goto out;
+			dt->file = optarg;
+			break;
+		case 2:
+			if (dt->path || dt->file)
+				goto out;
+			dt->opts |= GT_STDIN;
+			break;
+		case 3:
+			if (dt->file || dt->opts & GT_STDIN)
+				goto out;
+			dt->path = optarg;
+			break;
+		case 4:
+			dt->opts |= GT_IF_CHANGED;
+			break;
+		case 5:
+			dt->record = optarg;
+			break;
+		case 'h':
+			goto out;
+			break;
+		default:
+			goto out;
+		}
+	}
+
+	if (optind == argc || optind < argc - 2)
+		goto out;
+
+	dt->name = argv[optind++];
+	if (dt->opts & GT_STDIN || dt->file) {
+		dt->gadget_name = dt->name;
+		dt->name = NULL;
+		if (optind < argc)
+			goto out;
+	}
+
+	if (optind < argc)
+		dt->gadget_name = argv[optind++];
+
+	if (dt->gadget_name == NULL)
+		dt->gadget_name = dt->name;
+
+	executable_command_set(exec, GET_EXECUTABLE(load), (void *)dt, free);
+	/* compiled scheme is applied without libusbg, as replay is */
+	executable_command_set_scope(exec, load_compiled(dt) ? GT_SCOPE_NONE
+				     : GT_SCOPE_GADGET, dt->gadget_name);
+	return;
+out:
+	free(dt);
+	executable_command_set(exec, cmd->printHelp, data, NULL);
+}
+
+static int gt_gadget_apply_help(void *data)
+{
+	printf("usage: %s apply <scheme> <gadget>\n"
+	       "Changes existing gadget to match scheme file, touching only\n"
+	       "attributes, functions, configurations and bindings which differ.\n"
+	       "Gadget is unbound from UDC only if anything needs to be changed.\n"
+	       "If gadget does not exist it is loaded from scheme.\n"
+	       "Options:\n"
+	       "  -o, --off\t\tDon't enable gadget again after changes\n"
+	       "  -v, --verbose\t\tPrint applied changes\n"
+	       "  -h, --help\t\tPrint this help\n",
+	       program_name);
+
+	return -1;
+}
+
+static void gt_parse_gadget_apply(const Command *cmd, int argc,
+		char **argv, ExecutableCommand *exec, void * data)
+{
+	int c;
+	struct gt_gadget_apply_data *dt;
+	struct option opts[] = {
+		{"off", no_argument, 0, 'o'},
+		{"verbose", no_argument, 0, 'v'},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	dt = zalloc(sizeof(*dt));
+	if (dt == NULL)
+		goto out;
+	argv--;
+	argc++;
+	while (1) {
+		int opt_index = 0;
+		c = getopt_long(argc, argv, "ovh", opts, &opt_index);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'o':
+			dt->opts |= GT_OFF;
+			break;
+		case 'v':
+			dt->opts |= GT_VERBOSE;
+			break;
+		case 'h':
+			goto out;
+			break;
+		default:
+			goto out;
+		}
+	}
+
+	if (optind != argc - 2)
+		goto out;
+
+	dt->file = argv[optind++];
+	dt->gadget = argv[optind++];
+
+	executable_command_set(exec, GET_EXECUTABLE(apply), (void *)dt, free);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
+	return;
+out:
+	free(dt);
+	executable_command_set(exec, cmd->printHelp, data, NULL);
+}
+
+static int gt_gadget_diff_help(void *data)
+{
+	printf("usage: %s diff <gadget> <scheme|gadget>\n"
+	       "Compares gadget with scheme file or with another gadget, if gadget\n"
+	       "with given name exists. Differences are printed one per line as\n"
+	       "tab-separated fields: '+', '-' or '~', path, old value and new value.\n"
+	       "Exits with 1 if any difference has been found.\n"
+	       "Options:\n"
+	       "  -q, --quiet\t\tDon't print differences\n"
+	       "  -h, --help\t\tPrint this help\n",
+	       program_name);
+
+	return -1;
+}
+
+static void gt_parse_gadget_diff(const Command *cmd, int argc,
+		char **argv, ExecutableCommand *exec, void * data)
+{
+	int c;
+	struct gt_gadget_diff_data *dt;
+	struct option opts[] = {
+		{"quiet", no_argument, 0, 'q'},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	dt = zalloc(sizeof(*dt));
+	if (dt == NULL)
+		goto out;
+	argv--;
+	argc++;
+	while (1) {
+		int opt_index = 0;
+		c = getopt_long(argc, argv, "qh", opts, &opt_index);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'q':
+			dt->opts |= GT_QUIET;
+			break;
+		case 'h':
+			goto out;
+			break;
+		default:
+			goto out;
+		}
+	}
+
+	if (optind != argc - 2)
 		goto out;
 
-	for (i = 0; i < USBG_GADGET_ATTR_MAX; i++)
-		dt->attr_val[i] = -1;
-	memset(dt->str_val, 0, sizeof(dt->str_val));
+	dt->gadget = argv[optind++];
+	dt->other = argv[optind++];
 
-	gt_parse_gadget_attrs(attrs, dt->attr_val, dt->str_val);
-	executable_command_set(exec, GET_EXECUTABLE(set), (void *)dt,
-			gt_gadget_set_destructor);
+	executable_command_set(exec, GET_EXECUTABLE(diff), (void *)dt, free);
+	executable_command_set_scope(exec, GT_SCOPE_ALL, NULL);
 	return;
 out:
-	gt_gadget_set_destructor((void *)dt);
+	free(dt);
 	executable_command_set(exec, cmd->printHelp, data, NULL);
 }
 
-static int gt_gadget_enable_help(void *data)
+static int gt_gadget_compile_help(void *data)
 {
-	printf("usage: %s enable <gadget> [udc] \n"
-	       "Enable gadget. If udc has not been specified, default one is used.\n"
-	       "\n"
+	printf("usage: %s compile <scheme> [-o <output>]\n"
+	       "Validates scheme and stores it in binary form, which is loaded\n"
+	       "by load without parsing. Loading fails if scheme has been\n"
+	       "modified after compilation.\n"
 	       "Options:\n"
-	       "  -h, --help\tPrint this help\n",
+	       "  -o, --output=<file>\tOutput file (default <scheme>.gtb)\n"
+	       "  -h, --help\t\tPrint this help\n",
 	       program_name);
 
 	return -1;
 }
 
-static void gt_parse_gadget_enable(const Command *cmd, int argc,
+static void gt_parse_gadget_compile(const Command *cmd, int argc,
 		char **argv, ExecutableCommand *exec, void * data)
 {
-	struct gt_gadget_enable_data *dt;
-	int ind;
-	int avaible_opts = GT_HELP;
+	int c;
+	struct gt_gadget_compile_data *dt;
+	struct option opts[] = {
+		{"output", required_argument, 0, 'o'},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
 
 	dt = zalloc(sizeof(*dt));
 	if (dt == NULL)
 		goto out;
+	argv--;
+	argc++;
+	while (1) {
+		int opt_index = 0;
+		c = getopt_long(argc, argv, "o:h", opts, &opt_index);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'o':
+			dt->output = optarg;
+			break;
+		case 'h':
+			goto out;
+			break;
+		default:
+			goto out;
+		}
+	}
 
-	ind = gt_get_options(&dt->opts, avaible_opts, argc, argv);
-	if (ind < 0 || dt->opts & GT_HELP)
+	if (optind != argc - 1)
 		goto out;
 
-	switch (argc - ind) {
-	case 1:
-		dt->gadget = argv[ind++];
-		break;
-	case 2:
-		dt->gadget = argv[ind++];
-		dt->udc = argv[ind++];
-		break;
-	default:
-		goto out;
-	}
+	dt->file = argv[optind++];
 
-	executable_command_set(exec, GET_EXECUTABLE(enable),
-				(void *)dt, free);
+	executable_command_set(exec, GET_EXECUTABLE(compile), (void *)dt, free);
 	return;
 out:
-	free((void *)dt);
+	free(dt);
 	executable_command_set(exec, cmd->printHelp, data, NULL);
 }
 
-static int gt_gadget_disable_help(void *data)
+static int gt_gadget_replay_help(void *data)
 {
-	printf("usage: %s disable [options] [gadget] \n"
-	       "Disable gadget. If gadget has been specified it is disabled, otherwise: if "
-	       "only one gadget exist it is used, if more than one gadget exist including "
-	       "default gadget, the default is disabled else error due to ambiguous gadget name "
-	       "unless -u or --udc option was used."
-	       "\n"
+	printf("usage: %s replay <plan> [gadget]\n"
+	       "Creates gadget by repeating configfs operations recorded by\n"
+	       "load --record, without parsing scheme or reading state of other\n"
+	       "gadgets. Gadget is named and bound to UDC as when recorded.\n"
 	       "Options:\n"
-	       "  -u=<udc>, --udc=<udc>\tDisable gadget which is active at given udc\n"
-	       "  -h, --help\tPrint this help\n",
+	       "  -o, --off\t\tDon't enable gadget\n"
+	       "  -h, --help\t\tPrint this help\n",
 	       program_name);
 
 	return -1;
 }
 
-static void gt_parse_gadget_disable(const Command *cmd, int argc,
+static void gt_parse_gadget_replay(const Command *cmd, int argc,
 		char **argv, ExecutableCommand *exec, void * data)
 {
-	struct gt_gadget_disable_data *dt;
 	int c;
+	struct gt_gadget_replay_data *dt;
 	struct option opts[] = {
-		{"udc", required_argument, 0, 'u'},
+		{"off", no_argument, 0, 'o'},
 		{"help", no_argument, 0, 'h'},
 		{0, 0, 0, 0}
 	};
@@ -472,12 +1657,12 @@ static void gt_parse_gadget_disable(const Command *cmd, int argc,
 	argc++;
 	while (1) {
 		int opt_index = 0;
-		c = getopt_long(argc, argv, "u:h", opts, &opt_index);
+		c = getopt_long(argc, argv, "oh", opts, &opt_index);
 		if (c == -1)
 			break;
 		switch (c) {
-		case 'u':
-			dt->udc = optarg;
+		case 'o':
+			dt->opts |= GT_OFF;
 			break;
 		case 'h':
 			goto out;
@@ -487,94 +1672,191 @@ static void gt_parse_gadget_disable(const Command *cmd, int argc,
 		}
 	}
 
-	if (optind < argc - 1 || (dt->udc && optind < argc)) {
-		printf("Too many arguments\n");
+	if (optind == argc || optind < argc - 2)
 		goto out;
-	}
 
-	dt->gadget = argv[optind];
-	executable_command_set(exec, GET_EXECUTABLE(disable), (void *)dt, free);
+	dt->file = argv[optind++];
+	if (optind < argc)
+		dt->gadget = argv[optind++];
+
+	executable_command_set(exec, GET_EXECUTABLE(replay), (void *)dt, free);
 	return;
 out:
 	free(dt);
 	executable_command_set(exec, cmd->printHelp, data, NULL);
 }
 
-static int gt_gadget_gadget_help(void *data)
+static int gt_gadget_pool_help(void *data)
 {
-	printf("usage: %s gadget [options] [gadget] \n"
-	       "If no gadget specified shows the list of gadgets, otherwise shows the gadget "
-	       "name, list of configurations and list of functions."
-	       "\n"
+	printf("usage: %s pool <command> ...\n"
+	       "Keep gadgets composed but unbound, so udc can be switched\n"
+	       "between them without creating gadget again.\n"
+	       "Commands:\n"
+	       "  prepare\n"
+	       "  switch\n",
+	       program_name);
+
+	return -1;
+}
+
+static int gt_gadget_pool_prepare_help(void *data)
+{
+	printf("usage: %s pool prepare [options] [persona=]<scheme>...\n"
+	       "Creates unbound gadget from each scheme. Gadget is named after\n"
+	       "persona, by default name of scheme without extension. Gadgets\n"
+	       "which still match their scheme are left untouched.\n"
 	       "Options:\n"
-	       "  -v, --verbose\t\tShow not only name of gadget but also its attributes\n"
-	       "  -r, --recursive\tShow the details about each function and configuration\n"
-	       "  -q, --quiet\t\tShow only list of gadget names\n"
+	       "  --path=<path>\tSearch schemes in path instead of lookup paths\n"
 	       "  -h, --help\t\tPrint this help\n",
 	       program_name);
 
 	return -1;
 }
 
-static void gt_parse_gadget_gadget(const Command *cmd, int argc,
+static void gt_gadget_pool_prepare_destructor(void *data)
+{
+	struct gt_gadget_pool_prepare_data *dt;
+
+	if (data == NULL)
+		return;
+	dt = (struct gt_gadget_pool_prepare_data *)data;
+	gt_setting_list_cleanup(dt->personas);
+	free(dt);
+}
+
+/**
+ * @brief Parse [persona=]scheme, persona defaults to basename of scheme
+ * without extension
+ */
+static int gt_parse_pool_persona(struct gt_setting *dst, const char *str)
+{
+	const char *base;
+	char *dot;
+
+	if (strchr(str, '='))
+		return gt_parse_setting(dst, str);
+
+	base = strrchr(str, '/');
+	base = base ? base + 1 : str;
+
+	dst->variable = strdup(base);
+	if (dst->variable == NULL)
+		return -1;
+
+	dst->value = strdup(str);
+	if (dst->value == NULL)
+		return -1;
+
+	dot = strrchr(dst->variable, '.');
+	if (dot && dot != dst->variable)
+		*dot = '\0';
+
+	return 0;
+}
+
+static void gt_parse_gadget_pool_prepare(const Command *cmd, int argc,
 		char **argv, ExecutableCommand *exec, void * data)
 {
-	struct gt_gadget_gadget_data *dt;
-	int ind;
-	int avaible_opts = GT_RECURSIVE | GT_VERBOSE | GT_HELP | GT_QUIET;
+	struct gt_gadget_pool_prepare_data *dt;
+	struct gt_setting *persona;
+	int c;
+	struct option opts[] = {
+		{"path", required_argument, 0, 1},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
 
 	dt = zalloc(sizeof(*dt));
 	if (dt == NULL)
 		goto out;
+	argv--;
+	argc++;
+	while (1) {
+		int opt_index = 0;
+		c = getopt_long(argc, argv, "h", opts, &opt_index);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 1:
+			dt->path = optarg;
+			break;
+		case 'h':
+		default:
+			goto out;
+		}
+	}
 
-	ind = gt_get_options(&dt->opts, avaible_opts, argc, argv);
-	if (ind < 0 || dt->opts & GT_HELP)
+	if (optind == argc)
 		goto out;
 
-	switch (argc - ind) {
-	case 0:
-		break;
-	case 1:
-		dt->name = argv[ind];
-		break;
-	default:
+	dt->personas = calloc(argc - optind + 1, sizeof(*dt->personas));
+	if (dt->personas == NULL)
 		goto out;
+
+	for (persona = dt->personas; optind < argc; optind++, persona++) {
+		if (gt_parse_pool_persona(persona, argv[optind]) < 0
+		    || *persona->variable == '\0' || *persona->value == '\0')
+			goto out;
 	}
 
-	executable_command_set(exec, GET_EXECUTABLE(gadget), (void *)dt,
-		free);
+	executable_command_set(exec, GET_EXECUTABLE(pool_prepare), (void *)dt,
+			gt_gadget_pool_prepare_destructor);
+	executable_command_set_scope(exec,
+			GET_SCOPE(pool_prepare, GT_SCOPE_ALL), NULL);
 	return;
 out:
-	free(dt);
+	gt_gadget_pool_prepare_destructor(dt);
 	executable_command_set(exec, cmd->printHelp, data, NULL);
 }
 
-static int gt_gadget_load_help(void *data)
+static int gt_gadget_pool_switch_help(void *data)
 {
-	printf("usage: %s load <name> [gadget_name]\n"
-	       "Loads the gadget settings related to name, creates and enables\n"
-	       "the created gadget.\n"
+	printf("usage: %s pool switch [options] <udc> <persona>\n"
+	       "Unbinds gadget from udc and binds prepared gadget instead.\n"
+	       "Time for which udc had no gadget bound is printed.\n"
 	       "Options:\n"
-	       "  -o, --off\t\tDon't enable gadget after load\n"
-	       "  --file=<gadget_file>\tloads gadget from file instead of from paths\n"
-	       "  --stdin\t\tloads gadget from stdin\n"
-	       "  --path=<path>\t\tloads gadget located in some path instead of from standard paths\n"
+	       "  --soft-connect\tDisconnect udc for the time of switch\n"
+	       "  --wait[=<state>]\tWait until udc is in state (default configured)\n"
+	       "\t\tand print time elapsed since bind\n"
+	       "  --timeout=<sec>\tFail if state is not reached in given time\n"
 	       "  -h, --help\t\tPrint this help\n",
 	       program_name);
 
 	return -1;
 }
 
-static void gt_parse_gadget_load(const Command *cmd, int argc,
-		char **argv, ExecutableCommand *exec, void * data)
+static int gt_gadget_switch_help(void *data)
+{
+	printf("usage: %s switch [options] <udc> <from> <to>\n"
+	       "Replaces gadget bound to udc by other one. Both gadgets are\n"
+	       "looked up before unbinding, so udc is left without gadget only\n"
+	       "for unbind and bind. Time for which udc had no gadget bound is\n"
+	       "printed.\n"
+	       "Options:\n"
+	       "  --soft-connect\tDisconnect udc for the time of switch, so\n"
+	       "\t\thost sees single disconnect\n"
+	       "  --wait[=<state>]\tWait until udc is in state (default configured)\n"
+	       "\t\tand print time elapsed since bind\n"
+	       "  --timeout=<sec>\tFail if state is not reached in given time\n"
+	       "  -h, --help\t\tPrint this help\n",
+	       program_name);
+
+	return -1;
+}
+
+/**
+ * @brief Parse switch or pool switch, which doesn't name gadget being
+ * replaced
+ */
+static void gt_parse_switch(const Command *cmd, int argc, char **argv,
+		ExecutableCommand *exec, void *data, int with_from)
 {
+	struct gt_gadget_switch_data *dt;
 	int c;
-	struct gt_gadget_load_data *dt;
 	struct option opts[] = {
-		{"off", no_argument, 0, 'o'},
-		{"file", required_argument, 0, 1},
-		{"stdin", no_argument, 0, 2},
-		{"path", required_argument, 0, 3},
+		{"wait", optional_argument, 0, 1},
+		{"timeout", required_argument, 0, 2},
+		{"soft-connect", no_argument, 0, 3},
 		{"help", no_argument, 0, 'h'},
 		{0, 0, 0, 0}
 	};
@@ -582,64 +1864,74 @@ static void gt_parse_gadget_load(const Command *cmd, int argc,
 	dt = zalloc(sizeof(*dt));
 	if (dt == NULL)
 		goto out;
+
+	dt->timeout = -1;
 	argv--;
 	argc++;
 	while (1) {
 		int opt_index = 0;
-		c = getopt_long(argc, argv, "oh", opts, &opt_index);
+		c = getopt_long(argc, argv, "h", opts, &opt_index);
 		if (c == -1)
 			break;
 		switch (c) {
-		case 'o':
-			dt->opts |= GT_OFF;
-			break;
 		case 1:
-			if (dt->path || dt->opts & GT_STDIN)
-				goto out;
-			dt->file = optarg;
-			break;
 		case 2:
-			if (dt->path || dt->file)
+			if (parse_wait_option(c, &dt->wait, &dt->timeout) < 0)
 				goto out;
-			dt->opts |= GT_STDIN;
 			break;
 		case 3:
-			if (dt->file || dt->opts & GT_STDIN)
-				goto out;
-			dt->path = optarg;
+			dt->soft_connect = 1;
 			break;
 		case 'h':
-			goto out;
-			break;
 		default:
 			goto out;
 		}
 	}
 
-	if (optind == argc || optind < argc - 2)
+	if ((dt->timeout >= 0 && !dt->wait)
+	    || argc - optind != (with_from ? 3 : 2))
 		goto out;
 
-	dt->name = argv[optind++];
-	if (dt->opts & GT_STDIN || dt->file) {
-		dt->gadget_name = dt->name;
-		dt->name = NULL;
-		if (optind < argc)
-			goto out;
-	}
-
-	if (optind < argc)
-		dt->gadget_name = argv[optind++];
-
-	if (dt->gadget_name == NULL)
-		dt->gadget_name = dt->name;
+	dt->udc = argv[optind++];
+	if (with_from)
+		dt->from = argv[optind++];
+	dt->to = argv[optind++];
 
-	executable_command_set(exec, GET_EXECUTABLE(load), (void *)dt, free);
+	executable_command_set(exec, GET_EXECUTABLE(switch_udc), (void *)dt,
+			free);
+	executable_command_set_scope(exec,
+			GET_SCOPE(switch_udc, GT_SCOPE_ALL), NULL);
 	return;
 out:
 	free(dt);
 	executable_command_set(exec, cmd->printHelp, data, NULL);
 }
 
+static void gt_parse_gadget_pool_switch(const Command *cmd, int argc,
+		char **argv, ExecutableCommand *exec, void * data)
+{
+	gt_parse_switch(cmd, argc, argv, exec, data, 0);
+}
+
+static void gt_parse_gadget_switch(const Command *cmd, int argc,
+		char **argv, ExecutableCommand *exec, void * data)
+{
+	gt_parse_switch(cmd, argc, argv, exec, data, 1);
+}
+
+static const Command *get_gadget_pool_children(const Command *cmd)
+{
+	static Command commands[] = {
+		{"prepare", NEXT, gt_parse_gadget_pool_prepare, NULL,
+			gt_gadget_pool_prepare_help},
+		{"switch", NEXT, gt_parse_gadget_pool_switch, NULL,
+			gt_gadget_pool_switch_help},
+		CMD_LIST_END
+	};
+
+	return commands;
+}
+
 static void gt_gadget_save_destructor(void *data)
 {
 	struct gt_gadget_save_data *dt;
@@ -739,6 +2031,7 @@ static void gt_parse_gadget_save(const Command *cmd, int argc,
 
 	executable_command_set(exec, GET_EXECUTABLE(save), (void *)dt,
 		gt_gadget_save_destructor);
+	executable_command_set_scope(exec, GT_SCOPE_GADGET, dt->gadget);
 
 	return;
 out:
@@ -920,6 +2213,43 @@ out:
 	executable_command_set(exec, cmd->printHelp, data, NULL);
 }
 
+static int gt_gadget_template_reindex_help(void *data)
+{
+	printf("usage: %s template reindex\n"
+	       "Rebuild index of templates in each lookup path. Index is\n"
+	       "refreshed automatically when directory changes, this command\n"
+	       "allows to prepare it in advance, eg. on read-only image.\n",
+	       program_name);
+	return -1;
+}
+
+static void gt_parse_gadget_template_reindex(const Command *cmd, int argc,
+		char **argv, ExecutableCommand *exec, void * data)
+{
+	struct gt_gadget_template_reindex_data *dt = NULL;
+	int ind;
+	int avaible_opts = GT_HELP;
+
+	dt = zalloc(sizeof(*dt));
+	if (dt == NULL)
+		goto out;
+
+	ind = gt_get_options(&dt->opts, avaible_opts, argc, argv);
+	if (ind < 0 || dt->opts & GT_HELP)
+		goto out;
+
+	if (argc != ind)
+		goto out;
+
+	executable_command_set(exec, GET_EXECUTABLE(template_reindex),
+		(void *)dt, free);
+
+	return;
+out:
+	free(dt);
+	executable_command_set(exec, cmd->printHelp, data, NULL);
+}
+
 const Command *get_gadget_template_children(const Command *cmd)
 {
 	static Command commands[] = {
@@ -929,6 +2259,8 @@ const Command *get_gadget_template_children(const Command *cmd)
 			gt_gadget_template_set_help},
 		{"rm", NEXT, gt_parse_gadget_template_rm, NULL,
 			gt_gadget_template_rm_help},
+		{"reindex", NEXT, gt_parse_gadget_template_reindex, NULL,
+			gt_gadget_template_reindex_help},
 		{NULL, AGAIN, gt_parse_gadget_template, NULL,
 			gt_gadget_template_help},
 		CMD_LIST_END
@@ -957,6 +2289,18 @@ const Command *get_gadget_children(const Command *cmd)
 			gt_gadget_load_help},
 		{"save", NEXT, gt_parse_gadget_save, NULL,
 			gt_gadget_save_help},
+		{"apply", NEXT, gt_parse_gadget_apply, NULL,
+			gt_gadget_apply_help},
+		{"diff", NEXT, gt_parse_gadget_diff, NULL,
+			gt_gadget_diff_help},
+		{"compile", NEXT, gt_parse_gadget_compile, NULL,
+			gt_gadget_compile_help},
+		{"replay", NEXT, gt_parse_gadget_replay, NULL,
+			gt_gadget_replay_help},
+		{"pool", NEXT, command_parse, get_gadget_pool_children,
+			gt_gadget_pool_help},
+		{"switch", NEXT, gt_parse_gadget_switch, NULL,
+			gt_gadget_switch_help},
 		CMD_LIST_END
 	};
 
@@ -978,6 +2322,12 @@ int gt_gadget_help(void *data)
 	       " template\n"
 	       " load\n"
 	       " save\n"
+	       " apply\n"
+	       " diff\n"
+	       " compile\n"
+	       " replay\n"
+	       " pool\n"
+	       " switch\n"
 	       "try %1$s <command> --help for more help\n",
 	       program_name);
 	return -1;
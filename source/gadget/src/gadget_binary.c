@@ -0,0 +1,1305 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libconfig.h>
+#ifdef WITH_IO_URING
+#include <liburing.h>
+#endif
+
+#include "gadget_binary.h"
+#include "gadget_scheme.h"
+#include "common.h"
+#include "trace.h"
+
+/* label used by libusbgx when scheme doesn't name configuration */
+#define GT_BINARY_CONFIG_LABEL "config"
+/* attribute writes submitted at once */
+#define GT_URING_BATCH 32
+
+struct builder {
+	/* scheme being compiled */
+	const config_setting_t *root;
+	struct gt_binary_op *ops;
+	int count;
+	int size;
+	/* string table */
+	FILE *fp;
+	char *buf;
+	size_t len;
+	/* header fields */
+	uint32_t source;
+	uint64_t source_hash;
+	uint32_t name;
+	uint32_t udc;
+};
+
+static uint32_t add_string(struct builder *c, const char *str)
+{
+	long off;
+
+	off = ftell(c->fp);
+	fputs(str, c->fp);
+	fputc('\0', c->fp);
+
+	return off;
+}
+
+static int add_op(struct builder *c, enum gt_binary_op_type type,
+		const char *path, const char *value)
+{
+	struct gt_binary_op *op;
+
+	if (c->count == c->size) {
+		int size = c->size ? c->size * 2 : 64;
+
+		op = realloc(c->ops, size * sizeof(*op));
+		if (op == NULL)
+			return -1;
+		c->ops = op;
+		c->size = size;
+	}
+
+	op = &c->ops[c->count++];
+	op->type = type;
+	op->path = add_string(c, path);
+	op->value = value ? add_string(c, value) : 0;
+
+	return 0;
+}
+
+static int unsupported(const config_setting_t *s)
+{
+	fprintf(stderr, "Line %d: %s is not supported in compiled scheme\n",
+		config_setting_source_line(s),
+		config_setting_name(s) ? config_setting_name(s) : "setting");
+	return -1;
+}
+
+static int format_value(const config_setting_t *s, char *buf, size_t size)
+{
+	switch (config_setting_type(s)) {
+	case CONFIG_TYPE_INT:
+	case CONFIG_TYPE_INT64:
+		snprintf(buf, size, "%lld", config_setting_get_int64(s));
+		return 0;
+	case CONFIG_TYPE_BOOL:
+		snprintf(buf, size, "%d", !!config_setting_get_bool(s));
+		return 0;
+	case CONFIG_TYPE_STRING:
+		if (strlen(config_setting_get_string(s)) >= size)
+			break;
+		strcpy(buf, config_setting_get_string(s));
+		return 0;
+	}
+
+	return unsupported(s);
+}
+
+static int compile_attrs(struct builder *c, const char *dir,
+		const config_setting_t *attrs);
+
+static int compile_luns(struct builder *c, const char *dir,
+		const config_setting_t *luns)
+{
+	char path[PATH_MAX];
+	int i, n;
+
+	if (config_setting_type(luns) != CONFIG_TYPE_LIST)
+		return unsupported(luns);
+
+	n = config_setting_length(luns);
+	for (i = 0; i < n; i++) {
+		snprintf(path, sizeof(path), "%s/lun.%d", dir, i);
+		/* lun.0 is created by kernel together with function */
+		if (i > 0 && add_op(c, GT_BINARY_MKDIR, path, NULL) < 0)
+			return -1;
+
+		if (compile_attrs(c, path, config_setting_get_elem(luns, i)) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int compile_attr(struct builder *c, const char *dir,
+		const config_setting_t *m)
+{
+	char path[PATH_MAX];
+	char value[PATH_MAX];
+	const char *name;
+
+	name = config_setting_name(m);
+	if (name == NULL || gt_scheme_attr_ignored(name))
+		return 0;
+
+	if (config_setting_is_aggregate(m)) {
+		if (streq(name, "luns"))
+			return compile_luns(c, dir, m);
+		return unsupported(m);
+	}
+
+	if (format_value(m, value, sizeof(value)) < 0)
+		return -1;
+
+	/* empty value is kernel default */
+	if (value[0] == '\0')
+		return 0;
+
+	/* scheme uses libusbgx name of configuration attribute */
+	if (streq(name, "bMaxPower"))
+		name = "MaxPower";
+
+	snprintf(path, sizeof(path), "%s%s%s", dir, dir[0] ? "/" : "", name);
+	return add_op(c, GT_BINARY_WRITE, path, value);
+}
+
+static int compile_attrs(struct builder *c, const char *dir,
+		const config_setting_t *attrs)
+{
+	const config_setting_t *m;
+	int i, n;
+
+	if (attrs == NULL)
+		return 0;
+
+	if (config_setting_type(attrs) != CONFIG_TYPE_GROUP)
+		return unsupported(attrs);
+
+	n = config_setting_length(attrs);
+	for (i = 0; i < n; i++) {
+		m = config_setting_get_elem(attrs, i);
+		/* backing file is opened using other attributes */
+		if (streq(config_setting_name(m), "file"))
+			continue;
+		if (compile_attr(c, dir, m) < 0)
+			return -1;
+	}
+
+	m = config_setting_get_member(attrs, "file");
+	return m ? compile_attr(c, dir, m) : 0;
+}
+
+static int compile_strings(struct builder *c, const char *dir,
+		const config_setting_t *list)
+{
+	const config_setting_t *s, *m;
+	char path[PATH_MAX];
+	int i, j, lang;
+
+	if (list == NULL)
+		return 0;
+
+	if (config_setting_type(list) != CONFIG_TYPE_LIST)
+		return unsupported(list);
+
+	for (i = 0; i < config_setting_length(list); i++) {
+		s = config_setting_get_elem(list, i);
+		if (config_setting_lookup_int(s, "lang", &lang) != CONFIG_TRUE)
+			return unsupported(s);
+
+		snprintf(path, sizeof(path), "%s%sstrings/0x%x", dir,
+			 dir[0] ? "/" : "", lang);
+		if (add_op(c, GT_BINARY_MKDIR, path, NULL) < 0)
+			return -1;
+
+		for (j = 0; j < config_setting_length(s); j++) {
+			m = config_setting_get_elem(s, j);
+			if (streq(config_setting_name(m), "lang"))
+				continue;
+			if (config_setting_type(m) != CONFIG_TYPE_STRING)
+				return unsupported(m);
+			if (compile_attr(c, path, m) < 0)
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int function_created(struct builder *c, const char *path)
+{
+	int i;
+
+	fflush(c->fp);
+	for (i = 0; i < c->count; i++)
+		if (c->ops[i].type == GT_BINARY_MKDIR
+		    && streq(c->buf + c->ops[i].path, path))
+			return 1;
+
+	return 0;
+}
+
+static int compile_function(struct builder *c, const config_setting_t *f,
+		char *path, size_t size)
+{
+	const char *type, *instance, *name;
+	int i;
+
+	if (gt_scheme_function_key(f, &type, &instance) < 0) {
+		fprintf(stderr, "Function %s has no type\n",
+			config_setting_name(f));
+		return -1;
+	}
+
+	if (usbg_lookup_function_type(type) < 0) {
+		fprintf(stderr, "Unknown function type %s\n", type);
+		return -1;
+	}
+
+	snprintf(path, size, "functions/%s.%s", type, instance);
+	if (function_created(c, path))
+		return 0;
+
+	for (i = 0; i < config_setting_length(f); i++) {
+		name = config_setting_name(config_setting_get_elem(f, i));
+		if (!streq(name, "type") && !streq(name, "instance")
+		    && !streq(name, "attrs"))
+			return unsupported(config_setting_get_elem(f, i));
+	}
+
+	if (add_op(c, GT_BINARY_MKDIR, path, NULL) < 0)
+		return -1;
+
+	return compile_attrs(c, path, config_setting_get_member(f, "attrs"));
+}
+
+static int compile_binding(struct builder *c, const char *dir,
+		const config_setting_t *b)
+{
+	const config_setting_t *f = b;
+	const char *name = NULL;
+	const char *label;
+	char target[PATH_MAX];
+	char path[PATH_MAX];
+
+	if (config_setting_type(b) == CONFIG_TYPE_GROUP) {
+		config_setting_lookup_string(b, "name", &name);
+		f = config_setting_get_member(b, "function");
+		if (f == NULL)
+			return unsupported(b);
+	}
+
+	if (config_setting_type(f) == CONFIG_TYPE_STRING) {
+		label = config_setting_get_string(f);
+		f = config_setting_get_member(c->root, "functions");
+		if (f)
+			f = config_setting_get_member(f, label);
+		if (f == NULL) {
+			fprintf(stderr, "Function %s not defined\n", label);
+			return -1;
+		}
+	}
+
+	if (compile_function(c, f, target, sizeof(target)) < 0)
+		return -1;
+
+	/* binding is named after function by default */
+	snprintf(path, sizeof(path), "%s/%s", dir,
+		 name ? name : target + strlen("functions/"));
+
+	return add_op(c, GT_BINARY_LINK, path, target);
+}
+
+static int compile_config(struct builder *c, const config_setting_t *cfg)
+{
+	const config_setting_t *funcs;
+	const char *label = GT_BINARY_CONFIG_LABEL;
+	char dir[PATH_MAX];
+	int i, id;
+
+	if (config_setting_lookup_int(cfg, "id", &id) != CONFIG_TRUE) {
+		fprintf(stderr, "Configuration without id\n");
+		return -1;
+	}
+
+	config_setting_lookup_string(cfg, "name", &label);
+	snprintf(dir, sizeof(dir), "configs/%s.%d", label, id);
+
+	if (add_op(c, GT_BINARY_MKDIR, dir, NULL) < 0
+	    || compile_attrs(c, dir, config_setting_get_member(cfg, "attrs")) < 0
+	    || compile_strings(c, dir,
+			       config_setting_get_member(cfg, "strings")) < 0)
+		return -1;
+
+	funcs = config_setting_get_member(cfg, "functions");
+	for (i = 0; funcs && i < config_setting_length(funcs); i++)
+		if (compile_binding(c, dir, config_setting_get_elem(funcs, i)) < 0)
+			return -1;
+
+	return 0;
+}
+
+/* libusbgx refuses unknown gadget attributes on load, so does compile */
+static int compile_gadget_attrs(struct builder *c,
+		const config_setting_t *attrs)
+{
+	const char *name;
+	int i;
+
+	for (i = 0; attrs && config_setting_is_group(attrs)
+		     && i < config_setting_length(attrs); i++) {
+		name = config_setting_name(config_setting_get_elem(attrs, i));
+		if (!gt_scheme_attr_ignored(name)
+		    && usbg_lookup_gadget_attr(name) < 0) {
+			fprintf(stderr, "Unknown gadget attribute %s\n", name);
+			return -1;
+		}
+	}
+
+	return compile_attrs(c, "", attrs);
+}
+
+static int compile_scheme(struct builder *c)
+{
+	const config_setting_t *s;
+	char path[PATH_MAX];
+	const char *name;
+	int i;
+
+	for (i = 0; i < config_setting_length(c->root); i++) {
+		s = config_setting_get_elem(c->root, i);
+		name = config_setting_name(s);
+		if (!streq(name, "attrs") && !streq(name, "strings")
+		    && !streq(name, "functions") && !streq(name, "configs"))
+			return unsupported(s);
+	}
+
+	if (compile_gadget_attrs(c,
+			config_setting_get_member(c->root, "attrs")) < 0
+	    || compile_strings(c, "",
+			       config_setting_get_member(c->root, "strings")) < 0)
+		return -1;
+
+	s = config_setting_get_member(c->root, "functions");
+	for (i = 0; s && i < config_setting_length(s); i++)
+		if (compile_function(c, config_setting_get_elem(s, i),
+				     path, sizeof(path)) < 0)
+			return -1;
+
+	s = config_setting_get_member(c->root, "configs");
+	for (i = 0; s && i < config_setting_length(s); i++)
+		if (compile_config(c, config_setting_get_elem(s, i)) < 0)
+			return -1;
+
+	return 0;
+}
+
+static char *read_file(const char *file, size_t *size)
+{
+	struct stat st;
+	char *buf;
+	int fd;
+
+	fd = open(file, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	buf = malloc(st.st_size + 1);
+	if (buf && read(fd, buf, st.st_size) != st.st_size) {
+		free(buf);
+		buf = NULL;
+	}
+
+	close(fd);
+	*size = st.st_size;
+	return buf;
+}
+
+static int write_file(const char *file, const void *buf, size_t size)
+{
+	char tmp[PATH_MAX];
+	int fd;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp", file) >= sizeof(tmp)) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		goto err;
+
+	if (write(fd, buf, size) != size) {
+		close(fd);
+		goto err_unlink;
+	}
+
+	if (close(fd) < 0 || rename(tmp, file) < 0)
+		goto err_unlink;
+
+	return 0;
+
+err_unlink:
+	unlink(tmp);
+err:
+	perror("Error writing compiled scheme");
+	return -1;
+}
+
+static int builder_init(struct builder *c)
+{
+	memset(c, 0, sizeof(*c));
+
+	c->fp = open_memstream(&c->buf, &c->len);
+	if (c->fp == NULL)
+		return -1;
+
+	/* offset 0 is an empty string, used for missing values */
+	fputc('\0', c->fp);
+
+	return 0;
+}
+
+static void builder_free(struct builder *c)
+{
+	fclose(c->fp);
+	free(c->buf);
+	free(c->ops);
+}
+
+static int builder_write(struct builder *c, const char *output)
+{
+	struct gt_binary_header *hdr;
+	size_t size, ops_size;
+	char *out;
+	int ret;
+
+	if (fflush(c->fp) != 0)
+		return -1;
+
+	ops_size = c->count * sizeof(*c->ops);
+	size = sizeof(*hdr) + ops_size + c->len;
+	if (size > UINT32_MAX) {
+		fprintf(stderr, "Scheme too large\n");
+		return -1;
+	}
+
+	out = zalloc(size);
+	if (out == NULL)
+		return -1;
+
+	hdr = (struct gt_binary_header *)out;
+	memcpy(hdr->magic, GT_BINARY_MAGIC, sizeof(hdr->magic));
+	hdr->order = GT_BINARY_ORDER;
+	hdr->size = size;
+	hdr->count = c->count;
+	hdr->strings = sizeof(*hdr) + ops_size;
+	hdr->source = c->source;
+	hdr->source_hash = c->source_hash;
+	hdr->name = c->name;
+	hdr->udc = c->udc;
+	memcpy(out + sizeof(*hdr), c->ops, ops_size);
+	memcpy(out + hdr->strings, c->buf, c->len);
+	hdr->hash = gt_hash(out + sizeof(*hdr), size - sizeof(*hdr));
+
+	ret = write_file(output, out, size);
+
+	free(out);
+	return ret;
+}
+
+int gt_binary_compile(const char *source, const char *output)
+{
+	struct builder c;
+	char path[PATH_MAX];
+	size_t src_size;
+	config_t cfg;
+	char *src;
+	FILE *fp;
+	int ret = -1;
+
+	src = read_file(source, &src_size);
+	if (src == NULL) {
+		perror("Error reading scheme");
+		return -1;
+	}
+
+	fp = fmemopen(src, src_size, "r");
+	if (fp == NULL)
+		goto out_src;
+
+	ret = gt_scheme_read(fp, source, &cfg);
+	fclose(fp);
+	if (ret < 0)
+		goto out_src;
+	ret = -1;
+
+	if (builder_init(&c) < 0)
+		goto out_cfg;
+
+	c.root = config_root_setting(&cfg);
+	c.source_hash = gt_hash(src, src_size);
+	if (realpath(source, path) == NULL)
+		goto out_builder;
+	c.source = add_string(&c, path);
+
+	if (compile_scheme(&c) < 0)
+		goto out_builder;
+
+	ret = builder_write(&c, output);
+
+out_builder:
+	builder_free(&c);
+out_cfg:
+	config_destroy(&cfg);
+out_src:
+	free(src);
+	return ret;
+}
+
+/**
+ * @brief Read attribute value without trailing newline
+ * @return length of value, -1 if it can't be read or is binary
+ */
+static ssize_t read_attr(int dirfd, const char *name, char *buf, size_t size)
+{
+	ssize_t len;
+	int fd;
+
+	fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	len = read(fd, buf, size - 1);
+	close(fd);
+	if (len < 0)
+		return -1;
+
+	if (len > 0 && buf[len - 1] == '\n')
+		len--;
+	buf[len] = '\0';
+
+	return strlen(buf) == len ? len : -1;
+}
+
+/* order of gadget subdirectories, so that link targets exist */
+static int dir_rank(const char *name)
+{
+	static const char *order[] = { "strings", "functions", "configs", NULL };
+	int i;
+
+	for (i = 0; order[i]; i++)
+		if (streq(name, order[i]))
+			return i;
+
+	return i;
+}
+
+static int dentry_cmp(const struct dirent **a, const struct dirent **b)
+{
+	int ra = dir_rank((*a)->d_name);
+	int rb = dir_rank((*b)->d_name);
+
+	return ra != rb ? ra - rb : strcmp((*a)->d_name, (*b)->d_name);
+}
+
+static int skip_dentry(const struct dirent *d)
+{
+	return !streq(d->d_name, ".") && !streq(d->d_name, "..");
+}
+
+/**
+ * @brief Record directory of gadget
+ * @param[in] prefix path of directory relative to gadget, "" for gadget
+ * @param[in] links record symlinks instead of directories and attributes
+ */
+static int record_dir(struct builder *c, int dirfd, const char *prefix,
+		const char *gadget, int links)
+{
+	char value[PATH_MAX];
+	char path[PATH_MAX];
+	struct dirent **dentry;
+	const char *name, *rel;
+	struct stat st;
+	ssize_t len;
+	int i, n, fd;
+	int pass;
+	int ret = 0;
+
+	fd = dup(dirfd);
+	n = fd < 0 ? -1 : scandirat(fd, ".", &dentry, skip_dentry, dentry_cmp);
+	close(fd);
+	if (n < 0) {
+		perror("Error reading gadget");
+		return -1;
+	}
+
+	/* backing file is opened using other attributes */
+	for (pass = 0; pass < 3 && ret == 0; pass++) {
+		for (i = 0; i < n && ret == 0; i++) {
+			name = dentry[i]->d_name;
+			snprintf(path, sizeof(path), "%s%s%s", prefix,
+				 prefix[0] ? "/" : "", name);
+
+			if (fstatat(dirfd, name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+				ret = -1;
+				break;
+			}
+
+			if (S_ISLNK(st.st_mode)) {
+				if (pass != 0 || !links)
+					continue;
+
+				len = readlinkat(dirfd, name, value, sizeof(value) - 1);
+				if (len < 0) {
+					ret = -1;
+					break;
+				}
+				value[len] = '\0';
+
+				rel = strstr(value, gadget);
+				if (rel == NULL) {
+					fprintf(stderr, "Link %s points outside of gadget\n",
+						path);
+					ret = -1;
+					break;
+				}
+				ret = add_op(c, GT_BINARY_LINK, path,
+					     rel + strlen(gadget));
+			} else if (S_ISREG(st.st_mode)) {
+				if (links || pass != (streq(name, "file") ? 1 : 0)
+				    || !(st.st_mode & S_IWUSR)
+				    || gt_scheme_attr_ignored(name)
+				    || (!prefix[0] && streq(name, "UDC")))
+					continue;
+
+				/* empty value is kernel default */
+				if (read_attr(dirfd, name, value, sizeof(value)) <= 0)
+					continue;
+
+				ret = add_op(c, GT_BINARY_WRITE, path, value);
+			} else if (S_ISDIR(st.st_mode)) {
+				if (pass != 2)
+					continue;
+
+				fd = openat(dirfd, name,
+					    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+				if (fd < 0) {
+					ret = -1;
+					break;
+				}
+
+				if (!links)
+					ret = add_op(c, GT_BINARY_MKDIR, path, NULL);
+				if (ret == 0)
+					ret = record_dir(c, fd, path, gadget, links);
+				close(fd);
+			}
+		}
+	}
+
+	for (i = 0; i < n; i++)
+		free(dentry[i]);
+	free(dentry);
+
+	return ret;
+}
+
+int gt_binary_record(const char *root, const char *name, const char *output)
+{
+	char gadget[PATH_MAX];
+	char udc[PATH_MAX];
+	struct builder c;
+	int dirfd;
+	int ret = -1;
+
+	/* link targets are relative to this part of their path */
+	if (snprintf(gadget, sizeof(gadget), "usb_gadget/%s/", name)
+	    >= sizeof(gadget)) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	if (snprintf(udc, sizeof(udc), "%s/%s", root, name) >= sizeof(udc)) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	dirfd = open(udc, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd < 0) {
+		perror("Error opening gadget");
+		return -1;
+	}
+
+	if (builder_init(&c) < 0)
+		goto out;
+
+	c.name = add_string(&c, name);
+	if (read_attr(dirfd, "UDC", udc, sizeof(udc)) > 0)
+		c.udc = add_string(&c, udc);
+
+	if (record_dir(&c, dirfd, "", gadget, 0) < 0
+	    || record_dir(&c, dirfd, "", gadget, 1) < 0) {
+		fprintf(stderr, "Failed to record gadget %s\n", name);
+		goto out_builder;
+	}
+
+	ret = builder_write(&c, output);
+
+out_builder:
+	builder_free(&c);
+out:
+	close(dirfd);
+	return ret;
+}
+
+static int valid_path(const char *path)
+{
+	const char *p;
+
+	if (path[0] == '\0' || path[0] == '/')
+		return 0;
+
+	for (p = path; p; p = strchr(p, '/')) {
+		if (*p == '/')
+			p++;
+		if (strncmp(p, "..", 2) == 0 && (p[2] == '/' || p[2] == '\0'))
+			return 0;
+	}
+
+	return 1;
+}
+
+static int validate(const struct gt_binary *bin)
+{
+	const struct gt_binary_header *hdr = bin->header;
+	const struct gt_binary_op *op;
+	size_t strings_size;
+	uint32_t i;
+
+	if (hdr->order != GT_BINARY_ORDER) {
+		fprintf(stderr, "Scheme compiled for other architecture\n");
+		return -1;
+	}
+
+	if (hdr->size != bin->size || hdr->strings >= bin->size
+	    || hdr->strings != sizeof(*hdr) + (uint64_t)hdr->count * sizeof(*op)
+	    || bin->strings[bin->size - hdr->strings - 1] != '\0')
+		goto corrupted;
+
+	if (hdr->hash != gt_hash((char *)bin->map + sizeof(*hdr),
+				 bin->size - sizeof(*hdr)))
+		goto corrupted;
+
+	strings_size = bin->size - hdr->strings;
+	if (hdr->source >= strings_size || hdr->name >= strings_size
+	    || hdr->udc >= strings_size)
+		goto corrupted;
+
+	for (i = 0; i < hdr->count; i++) {
+		op = &bin->ops[i];
+		if (op->type < GT_BINARY_MKDIR || op->type > GT_BINARY_LINK
+		    || op->path >= strings_size || op->value >= strings_size
+		    || !valid_path(bin->strings + op->path)
+		    || (op->type == GT_BINARY_LINK
+			&& !valid_path(bin->strings + op->value)))
+			goto corrupted;
+	}
+
+	return 0;
+
+corrupted:
+	fprintf(stderr, "Compiled scheme is corrupted\n");
+	return -1;
+}
+
+int gt_binary_open(const char *file, struct gt_binary *bin)
+{
+	struct stat st;
+	int fd;
+
+	memset(bin, 0, sizeof(*bin));
+
+	fd = open(file, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		perror("Error opening file");
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		perror("Error opening file");
+		close(fd);
+		return -1;
+	}
+
+	if (st.st_size < sizeof(*bin->header) || st.st_size > UINT32_MAX) {
+		close(fd);
+		return 1;
+	}
+
+	bin->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (bin->map == MAP_FAILED) {
+		perror("Error mapping file");
+		bin->map = NULL;
+		return -1;
+	}
+
+	bin->size = st.st_size;
+	bin->header = bin->map;
+	if (memcmp(bin->header->magic, GT_BINARY_MAGIC,
+		   sizeof(bin->header->magic)) != 0) {
+		gt_binary_close(bin);
+		return 1;
+	}
+
+	bin->ops = (const struct gt_binary_op *)(bin->header + 1);
+	bin->strings = (const char *)bin->map + bin->header->strings;
+
+	if (validate(bin) < 0) {
+		gt_binary_close(bin);
+		return -1;
+	}
+
+	return 0;
+}
+
+int gt_binary_probe(const char *file)
+{
+	char magic[sizeof(GT_BINARY_MAGIC) - 1];
+	int fd, ret;
+
+	fd = open(file, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return 0;
+
+	ret = read(fd, magic, sizeof(magic)) == sizeof(magic)
+		&& memcmp(magic, GT_BINARY_MAGIC, sizeof(magic)) == 0;
+
+	close(fd);
+	return ret;
+}
+
+void gt_binary_close(struct gt_binary *bin)
+{
+	if (bin->map)
+		munmap(bin->map, bin->size);
+	memset(bin, 0, sizeof(*bin));
+}
+
+int gt_binary_check_source(const struct gt_binary *bin)
+{
+	const char *source;
+	size_t size;
+	char *buf;
+	int ret = 0;
+
+	if (bin->header->source == 0)
+		return 0;
+
+	source = bin->strings + bin->header->source;
+	buf = read_file(source, &size);
+	if (buf == NULL)
+		return 0;
+
+	if (gt_hash(buf, size) != bin->header->source_hash) {
+		fprintf(stderr, "Compiled scheme is out of date, "
+			"compile %s again\n", source);
+		ret = -1;
+	}
+
+	free(buf);
+	return ret;
+}
+
+static int write_attr(int dirfd, const char *path, const char *value)
+{
+	size_t len = strlen(value);
+	int fd;
+	int ret;
+
+	fd = openat(dirfd, path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	ret = write(fd, value, len) == len ? 0 : -1;
+	close(fd);
+	return ret;
+}
+
+/*
+ * Attribute writes don't depend on each other, except for mass storage
+ * backing file written after other LUN attributes, so with io_uring
+ * they are issued in batches of linked open, write and close.
+ */
+struct writer {
+	/* gadget directory */
+	int dirfd;
+#ifdef WITH_IO_URING
+	struct io_uring ring;
+	int enabled;
+	int count;
+	const char *paths[GT_URING_BATCH];
+	size_t lens[GT_URING_BATCH];
+#endif
+};
+
+#ifdef WITH_IO_URING
+static void writer_init(struct writer *w, int dirfd)
+{
+	struct io_uring_probe *probe;
+
+	memset(w, 0, sizeof(*w));
+	w->dirfd = dirfd;
+
+	if (io_uring_queue_init(GT_URING_BATCH * 3, &w->ring, 0) < 0)
+		return;
+
+	/* fall back to plain writes on kernels without needed operations */
+	probe = io_uring_get_probe_ring(&w->ring);
+	if (probe && io_uring_opcode_supported(probe, IORING_OP_OPENAT)
+	    && io_uring_opcode_supported(probe, IORING_OP_WRITE)
+	    && io_uring_opcode_supported(probe, IORING_OP_CLOSE)
+	    && io_uring_register_files_sparse(&w->ring, GT_URING_BATCH) == 0)
+		w->enabled = 1;
+	else
+		io_uring_queue_exit(&w->ring);
+
+	io_uring_free_probe(probe);
+}
+
+/* ring holds sqes or cqes of a broken batch, write the rest without it */
+static void writer_disable(struct writer *w)
+{
+	io_uring_queue_exit(&w->ring);
+	w->enabled = 0;
+}
+
+static int writer_flush(struct writer *w, const char **failed)
+{
+	struct io_uring_cqe *cqe;
+	int idx, stage, res;
+	long long start;
+	int i, n, submitted;
+	int ret = 0;
+
+	if (!w->enabled || w->count == 0)
+		return 0;
+
+	n = w->count * 3;
+	w->count = 0;
+	start = gt_trace_now();
+
+	/* kernel stops at first sqe it can't issue, retry the remainder */
+	for (submitted = 0; submitted < n; submitted += ret) {
+		ret = io_uring_submit_and_wait(&w->ring, n - submitted);
+		if (ret <= 0)
+			break;
+	}
+
+	if (submitted < n) {
+		errno = ret < 0 ? -ret : EIO;
+		*failed = w->paths[submitted / 3];
+		ret = -1;
+	} else {
+		ret = 0;
+	}
+
+	/* reap only what kernel took, remaining sqes are dropped with ring */
+	for (i = 0; i < submitted; i++) {
+		res = io_uring_wait_cqe(&w->ring, &cqe);
+		if (res < 0) {
+			if (ret == 0) {
+				errno = -res;
+				*failed = w->paths[0];
+			}
+			ret = -1;
+			break;
+		}
+
+		idx = cqe->user_data >> 2;
+		stage = cqe->user_data & 3;
+		res = cqe->res;
+		io_uring_cqe_seen(&w->ring, cqe);
+
+		/* report first error, close result is not interesting */
+		if (ret < 0 || stage == 2
+		    || (stage == 1 && res == w->lens[idx]))
+			continue;
+
+		if (res >= 0 && stage == 0)
+			continue;
+
+		errno = res < 0 ? -res : EIO;
+		*failed = w->paths[idx];
+		ret = -1;
+	}
+
+	if (submitted < n || i < submitted)
+		writer_disable(w);
+
+	/* single event for the whole batch, named by its first attribute */
+	gt_trace_event("configfs", "io_uring", w->paths[0], start, ret);
+
+	return ret;
+}
+
+static int writer_write(struct writer *w, int fd, const char *base,
+		const char *path, const char *value, const char **failed)
+{
+	struct io_uring_sqe *sqe;
+	int idx;
+
+	if (!w->enabled) {
+		if (GT_TRACE("configfs", path, write_attr, fd, base, value) < 0) {
+			*failed = path;
+			return -1;
+		}
+		return 0;
+	}
+
+	idx = w->count++;
+	w->paths[idx] = path;
+	w->lens[idx] = strlen(value);
+
+	/* path is resolved from gadget, cached parent may be closed meanwhile */
+	sqe = io_uring_get_sqe(&w->ring);
+	io_uring_prep_openat_direct(sqe, w->dirfd, path, O_WRONLY, 0, idx);
+	sqe->flags |= IOSQE_IO_LINK;
+	sqe->user_data = idx << 2;
+
+	sqe = io_uring_get_sqe(&w->ring);
+	io_uring_prep_write(sqe, idx, value, w->lens[idx], 0);
+	sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+	sqe->user_data = idx << 2 | 1;
+
+	sqe = io_uring_get_sqe(&w->ring);
+	io_uring_prep_close_direct(sqe, idx);
+	sqe->user_data = idx << 2 | 2;
+
+	if (w->count == GT_URING_BATCH)
+		return writer_flush(w, failed);
+
+	return 0;
+}
+
+static void writer_free(struct writer *w)
+{
+	if (w->enabled)
+		io_uring_queue_exit(&w->ring);
+}
+#else
+static void writer_init(struct writer *w, int dirfd)
+{
+	w->dirfd = dirfd;
+}
+
+static int writer_flush(struct writer *w, const char **failed)
+{
+	return 0;
+}
+
+static int writer_write(struct writer *w, int fd, const char *base,
+		const char *path, const char *value, const char **failed)
+{
+	if (GT_TRACE("configfs", path, write_attr, fd, base, value) < 0) {
+		*failed = path;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void writer_free(struct writer *w)
+{
+}
+#endif
+
+static void rollback(const struct gt_binary *bin, int dirfd, uint32_t count)
+{
+	const struct gt_binary_op *op;
+
+	while (count--) {
+		op = &bin->ops[count];
+		if (op->type == GT_BINARY_LINK)
+			unlinkat(dirfd, bin->strings + op->path, 0);
+		else if (op->type == GT_BINARY_MKDIR)
+			unlinkat(dirfd, bin->strings + op->path, AT_REMOVEDIR);
+	}
+}
+
+/* most recently used parent directory, operations are grouped by it */
+struct dir_cache {
+	char path[PATH_MAX];
+	int fd;
+};
+
+/**
+ * @brief Get directory containing path and last component of path
+ * @return fd of directory or -1 on error
+ */
+static int parent_dir(int dirfd, struct dir_cache *dc, const char *path,
+		const char **name)
+{
+	const char *slash;
+	size_t len;
+
+	slash = strrchr(path, '/');
+	if (slash == NULL) {
+		*name = path;
+		return dirfd;
+	}
+
+	*name = slash + 1;
+	len = slash - path;
+	if (dc->fd >= 0 && strncmp(dc->path, path, len) == 0
+	    && dc->path[len] == '\0')
+		return dc->fd;
+
+	if (dc->fd >= 0)
+		close(dc->fd);
+
+	memcpy(dc->path, path, len);
+	dc->path[len] = '\0';
+	dc->fd = openat(dirfd, dc->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	return dc->fd;
+}
+
+int gt_binary_apply(const struct gt_binary *bin, const char *root,
+		const char *name, const char *udc)
+{
+	const struct gt_binary_op *op;
+	struct dir_cache dc = { .fd = -1 };
+	struct writer w;
+	char target[PATH_MAX];
+	char dir[PATH_MAX];
+	const char *path, *base;
+	uint32_t i;
+	int dirfd, fd;
+	int ret;
+
+	if (strchr(name, '/')) {
+		fprintf(stderr, "Invalid gadget name %s\n", name);
+		return -1;
+	}
+
+	if (snprintf(dir, sizeof(dir), "%s/%s", root, name) >= sizeof(dir)) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	if (GT_TRACE("configfs", dir, mkdir, dir, 0) < 0) {
+		if (errno == EEXIST)
+			fprintf(stderr, "Gadget %s already exists\n", name);
+		else
+			perror("Error creating gadget");
+		return -1;
+	}
+
+	dirfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd < 0) {
+		perror("Error opening gadget");
+		rmdir(dir);
+		return -1;
+	}
+
+	writer_init(&w, dirfd);
+
+	for (i = 0; i < bin->header->count; i++) {
+		op = &bin->ops[i];
+		path = bin->strings + op->path;
+
+		fd = parent_dir(dirfd, &dc, path, &base);
+		if (fd < 0) {
+			ret = -1;
+			goto err;
+		}
+
+		switch (op->type) {
+		case GT_BINARY_MKDIR:
+			ret = GT_TRACE("configfs", path, mkdirat, fd, base, 0);
+			/* default group created by kernel */
+			if (ret < 0 && errno == EEXIST)
+				ret = 0;
+			break;
+		case GT_BINARY_WRITE:
+			/* backing file is opened using other attributes */
+			ret = 0;
+			if (streq(base, "file"))
+				ret = writer_flush(&w, &path);
+			if (ret == 0)
+				ret = writer_write(&w, fd, base, path,
+						   bin->strings + op->value, &path);
+			break;
+		case GT_BINARY_LINK:
+			/* function may be locked once it is linked */
+			ret = writer_flush(&w, &path);
+			if (ret < 0)
+				break;
+
+			ret = snprintf(target, sizeof(target), "%s/%s", dir,
+				       bin->strings + op->value);
+			if (ret >= sizeof(target)) {
+				errno = ENAMETOOLONG;
+				ret = -1;
+				break;
+			}
+			ret = GT_TRACE("configfs", path, symlinkat,
+				       target, fd, base);
+			break;
+		default:
+			errno = EINVAL;
+			ret = -1;
+		}
+
+		if (ret < 0)
+			goto err;
+	}
+
+	if (writer_flush(&w, &path) < 0)
+		goto err;
+
+	writer_free(&w);
+	if (dc.fd >= 0)
+		close(dc.fd);
+
+	ret = 0;
+	if (udc && GT_TRACE("configfs", "UDC", write_attr,
+			    dirfd, "UDC", udc) < 0) {
+		fprintf(stderr, "Failed to enable gadget %s\n", strerror(errno));
+		ret = -1;
+	}
+
+	close(dirfd);
+	return ret;
+
+err:
+	fprintf(stderr, "Error on %s: %s\n", path, strerror(errno));
+	writer_free(&w);
+	if (dc.fd >= 0)
+		close(dc.fd);
+	rollback(bin, dirfd, i);
+	close(dirfd);
+	rmdir(dir);
+	return -1;
+}
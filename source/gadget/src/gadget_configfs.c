@@ -0,0 +1,691 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file gadget_configfs.c
+ * @brief Gadget commands working directly on configfs
+ * @details Unlike libusbg, which reads whole configfs into memory before
+ * any command, these commands open only the gadget directory they need
+ * and access its attributes relative to it. Directory of usb_gadget and
+ * of the last used gadget are kept open, so following commands of batch
+ * don't have to look them up again.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <usbg/usbg.h>
+
+#include "gadget.h"
+#include "backend.h"
+#include "common.h"
+#include "settings.h"
+#include "udc.h"
+#include "trace.h"
+
+static struct {
+	int root;
+	int gadget;
+	char name[NAME_MAX + 1];
+} dirs = {
+	.root = -1,
+	.gadget = -1,
+};
+
+static int root_dir(void)
+{
+	char path[PATH_MAX];
+	int ret;
+
+	if (dirs.root >= 0)
+		return dirs.root;
+
+	ret = snprintf(path, sizeof(path), "%s/usb_gadget",
+		       gt_settings.configfs_path);
+	if (ret >= sizeof(path)) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	dirs.root = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirs.root < 0)
+		fprintf(stderr, "Unable to open %s: %s\n", path, strerror(errno));
+
+	return dirs.root;
+}
+
+/**
+ * @brief Open directory of gadget
+ * @details Cached directory is reused only if it is still the one
+ * linked under given name, gadget could be recreated meanwhile.
+ * @return fd of gadget directory, which must not be closed, or -1
+ */
+static int gadget_dir(const char *name)
+{
+	struct stat st, cached;
+	int root;
+
+	if (strchr(name, '/') || name[0] == '.' || strlen(name) > NAME_MAX) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	root = root_dir();
+	if (root < 0)
+		return -1;
+
+	if (fstatat(root, name, &st, 0) < 0 || !S_ISDIR(st.st_mode))
+		return -1;
+
+	if (dirs.gadget >= 0 && streq(dirs.name, name)
+	    && fstat(dirs.gadget, &cached) == 0
+	    && cached.st_ino == st.st_ino && cached.st_dev == st.st_dev)
+		return dirs.gadget;
+
+	if (dirs.gadget >= 0)
+		close(dirs.gadget);
+
+	dirs.gadget = openat(root, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirs.gadget >= 0)
+		strcpy(dirs.name, name);
+
+	return dirs.gadget;
+}
+
+static int read_attr(int dirfd, const char *path, char *buf, size_t size)
+{
+	ssize_t len;
+	int fd;
+
+	fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	len = read(fd, buf, size - 1);
+	close(fd);
+	if (len < 0)
+		return -1;
+
+	while (len > 0 && buf[len - 1] == '\n')
+		len--;
+	buf[len] = '\0';
+
+	return 0;
+}
+
+static int write_attr(int dirfd, const char *path, const char *value)
+{
+	size_t len = strlen(value);
+	long long start = gt_trace_now();
+	int fd;
+	int ret = -1;
+
+	fd = openat(dirfd, path, O_WRONLY | O_CLOEXEC);
+	if (fd >= 0) {
+		ret = write(fd, value, len) == len ? 0 : -1;
+		close(fd);
+	}
+
+	gt_trace_event("configfs", "write", path, start, ret);
+	return ret;
+}
+
+static int skip_dentry(const struct dirent *d)
+{
+	return d->d_name[0] != '.';
+}
+
+/**
+ * @brief Get implicite gadget
+ * @return The only gadget, default gadget if there are more of them,
+ * or NULL if cannot select an implicite gadget.
+ */
+static const char *get_implicite_gadget(char *buf, size_t size)
+{
+	struct dirent **names;
+	const char *ret = NULL;
+	int root;
+	int n, i;
+
+	root = root_dir();
+	if (root < 0)
+		return NULL;
+
+	n = scandirat(root, ".", &names, skip_dentry, alphasort);
+	if (n < 0)
+		return NULL;
+
+	if (n == 1 && strlen(names[0]->d_name) < size) {
+		strcpy(buf, names[0]->d_name);
+		ret = buf;
+	} else if (n > 1 && gt_settings.default_gadget) {
+		ret = gt_settings.default_gadget;
+	}
+
+	for (i = 0; i < n; i++)
+		free(names[i]);
+	free(names);
+
+	return ret;
+}
+
+/**
+ * @brief Find gadget bound to UDC
+ * @return 0 if found, -1 otherwise
+ */
+static int udc_gadget(const char *udc, char *buf, size_t size)
+{
+	struct dirent **names;
+	char bound[NAME_MAX + 1];
+	int ret = -1;
+	int root;
+	int n, i;
+
+	root = root_dir();
+	if (root < 0)
+		return -1;
+
+	n = scandirat(root, ".", &names, skip_dentry, alphasort);
+	if (n < 0)
+		return -1;
+
+	for (i = 0; i < n; i++) {
+		if (ret < 0 && strlen(names[i]->d_name) < size
+		    && snprintf(bound, sizeof(bound), "%s/UDC",
+				names[i]->d_name) < sizeof(bound)
+		    && read_attr(root, bound, bound, sizeof(bound)) == 0
+		    && streq(bound, udc)) {
+			strcpy(buf, names[i]->d_name);
+			ret = 0;
+		}
+		free(names[i]);
+	}
+	free(names);
+
+	return ret;
+}
+
+static int ffs_dentry(const struct dirent *d)
+{
+	return strncmp(d->d_name, "ffs.", 4) == 0;
+}
+
+/**
+ * @brief Wait for daemons of all ffs functions of gadget
+ */
+static int wait_ffs_functions(int dirfd, const char *mount_dir, int timeout)
+{
+	struct dirent **names;
+	const char **instances;
+	int ret = -1;
+	int i, n;
+
+	n = scandirat(dirfd, "functions", &names, ffs_dentry, alphasort);
+	if (n < 0) {
+		fprintf(stderr, "Unable to read functions: %s\n",
+			strerror(errno));
+		return -1;
+	}
+
+	instances = calloc(n ? n : 1, sizeof(*instances));
+	if (instances == NULL)
+		goto out;
+
+	for (i = 0; i < n; i++)
+		instances[i] = names[i]->d_name + 4;
+
+	ret = gt_gadget_wait_ffs(instances, n, mount_dir, timeout);
+	free(instances);
+out:
+	for (i = 0; i < n; i++)
+		free(names[i]);
+	free(names);
+	return ret;
+}
+
+static int enable_func(void *data)
+{
+	struct gt_gadget_enable_data *dt;
+	char udc[NAME_MAX + 1];
+	struct timespec bind;
+	int dirfd;
+
+	dt = (struct gt_gadget_enable_data *)data;
+
+	dirfd = gadget_dir(dt->gadget);
+	if (dirfd < 0) {
+		fprintf(stderr, "Failed to get gadget\n");
+		return -1;
+	}
+
+	if (dt->udc == NULL) {
+		if (gt_gadget_first_udc(udc, sizeof(udc)) < 0) {
+			fprintf(stderr, "Failed to get udc\n");
+			return -1;
+		}
+	} else if (snprintf(udc, sizeof(udc), "%s", dt->udc) >= sizeof(udc)) {
+		fprintf(stderr, "Failed to get udc\n");
+		return -1;
+	}
+
+	if (dt->ffs_wait &&
+	    wait_ffs_functions(dirfd, dt->ffs_mount, dt->timeout) < 0)
+		return -1;
+
+	gt_gadget_check_max_speed(dt->gadget, udc);
+
+	clock_gettime(CLOCK_MONOTONIC, &bind);
+	if (write_attr(dirfd, "UDC", udc) < 0) {
+		fprintf(stderr, "Failed to enable gadget %s\n", strerror(errno));
+		return -1;
+	}
+
+	/* soft_connect is refused until gadget is bound, so host may
+	 * notice the device for a moment */
+	if (dt->disconnected && gt_udc_soft_connect(udc, 0) < 0) {
+		write_attr(dirfd, "UDC", "\n");
+		gt_backend_unload();
+		return -1;
+	}
+
+	/* libusbg state, if any, doesn't know about the change */
+	gt_backend_unload();
+
+	if (dt->wait)
+		return gt_gadget_wait_udc(dt->gadget, udc, dt->wait,
+					  dt->timeout, &bind);
+
+	return 0;
+}
+
+static int disable_func(void *data)
+{
+	struct gt_gadget_disable_data *dt;
+	char buf[NAME_MAX + 1];
+	const char *name;
+	struct stat st;
+	int dirfd;
+
+	dt = (struct gt_gadget_disable_data *)data;
+
+	if (dt->gadget) {
+		name = dt->gadget;
+	} else if (dt->udc) {
+		if (snprintf(buf, sizeof(buf), GT_UDC_DIR "/%s", dt->udc)
+		    >= sizeof(buf) || stat(buf, &st) < 0) {
+			fprintf(stderr, "UDC '%s' not found\n", dt->udc);
+			return -1;
+		}
+
+		if (udc_gadget(dt->udc, buf, sizeof(buf)) < 0) {
+			fprintf(stderr, "No gadget enabled on this UDC\n");
+			return -1;
+		}
+		name = buf;
+	} else {
+		name = get_implicite_gadget(buf, sizeof(buf));
+		if (name == NULL) {
+			fprintf(stderr, "Gadget not specified\n");
+			return -1;
+		}
+	}
+
+	dirfd = gadget_dir(name);
+	if (dirfd < 0) {
+		fprintf(stderr, "Gadget '%s' not found\n", name);
+		return -1;
+	}
+
+	if (write_attr(dirfd, "UDC", "\n") < 0) {
+		fprintf(stderr, "Error on disable gadget: %s\n",
+			strerror(errno));
+		return -1;
+	}
+
+	gt_backend_unload();
+	return 0;
+}
+
+/**
+ * @brief Open UDC attribute of gadget for writing
+ */
+static int open_udc_attr(int root, const char *gadget, char *path,
+		size_t size)
+{
+	if (snprintf(path, size, "%s/UDC", gadget) >= size) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	return openat(root, path, O_WRONLY | O_CLOEXEC);
+}
+
+/**
+ * @brief Write to attribute opened in advance, possibly not for the first time
+ */
+static int write_fd(int fd, const char *path, const char *value)
+{
+	size_t len = strlen(value);
+	long long start = gt_trace_now();
+	int ret;
+
+	ret = pwrite(fd, value, len, 0) == len ? 0 : -1;
+	gt_trace_event("configfs", "write", path, start, ret);
+
+	return ret;
+}
+
+static int switch_func(void *data)
+{
+	struct gt_gadget_switch_data *dt;
+	char from_path[NAME_MAX + 8], to_path[NAME_MAX + 8];
+	char from[NAME_MAX + 1];
+	char bound[NAME_MAX + 1];
+	char conn_path[PATH_MAX];
+	struct timespec start, bind, end;
+	int from_fd = -1, to_fd = -1, conn_fd = -1;
+	int ret = -1;
+	int root;
+
+	dt = (struct gt_gadget_switch_data *)data;
+
+	if (snprintf(conn_path, sizeof(conn_path), GT_UDC_DIR "/%s",
+		     dt->udc) >= sizeof(conn_path)
+	    || access(conn_path, F_OK) < 0) {
+		fprintf(stderr, "UDC '%s' not found\n", dt->udc);
+		return -1;
+	}
+
+	/* not every controller driver provides soft_connect */
+	if (snprintf(conn_path, sizeof(conn_path), GT_UDC_DIR "/%s/soft_connect",
+		     dt->udc) >= sizeof(conn_path)
+	    || (dt->soft_connect && access(conn_path, F_OK) < 0)) {
+		fprintf(stderr, "UDC '%s' doesn't support soft_connect\n",
+			dt->udc);
+		return -1;
+	}
+
+	root = root_dir();
+	if (root < 0)
+		return -1;
+
+	if (gadget_dir(dt->to) < 0) {
+		fprintf(stderr, "Gadget '%s' not found\n", dt->to);
+		return -1;
+	}
+
+	if (read_attr(dirs.gadget, "UDC", bound, sizeof(bound)) == 0
+	    && bound[0] && !streq(bound, dt->udc)) {
+		fprintf(stderr, "Gadget %s is bound to %s\n", dt->to, bound);
+		return -1;
+	}
+
+	if (udc_gadget(dt->udc, from, sizeof(from)) < 0)
+		from[0] = '\0';
+
+	if (dt->from && !streq(from, dt->from)) {
+		fprintf(stderr, "Gadget %s is not bound to %s\n", dt->from,
+			dt->udc);
+		return -1;
+	}
+
+	if (streq(from, dt->to)) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		gt_gadget_switch_report(dt->udc, from, dt->to, &start, &start);
+		bind = start;
+		goto wait;
+	}
+
+	/* open attributes upfront, so udc is left alone only for the writes */
+	if (from[0]) {
+		from_fd = open_udc_attr(root, from, from_path,
+					sizeof(from_path));
+		if (from_fd < 0) {
+			fprintf(stderr, "Unable to open %s: %s\n", from_path,
+				strerror(errno));
+			goto out;
+		}
+
+		if (dt->soft_connect) {
+			conn_fd = open(conn_path, O_WRONLY | O_CLOEXEC);
+			if (conn_fd < 0) {
+				fprintf(stderr, "Unable to open %s: %s\n",
+					conn_path, strerror(errno));
+				goto out;
+			}
+		}
+	}
+
+	to_fd = open_udc_attr(root, dt->to, to_path, sizeof(to_path));
+	if (to_fd < 0) {
+		fprintf(stderr, "Unable to open %s: %s\n", to_path,
+			strerror(errno));
+		goto out;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	/* host sees single disconnect instead of gadget going away */
+	if (conn_fd >= 0 && write_fd(conn_fd, conn_path, "disconnect") < 0) {
+		fprintf(stderr, "Unable to disconnect %s: %s\n", dt->udc,
+			strerror(errno));
+		goto out;
+	}
+
+	if (from_fd >= 0 && write_fd(from_fd, from_path, "\n") < 0) {
+		fprintf(stderr, "Error on disable gadget: %s\n",
+			strerror(errno));
+		goto reconnect;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &bind);
+	if (write_fd(to_fd, to_path, dt->udc) < 0) {
+		fprintf(stderr, "Failed to enable gadget %s\n", strerror(errno));
+		/* don't leave udc without gadget */
+		if (from_fd >= 0)
+			write_attr(root, from_path, dt->udc);
+		goto reconnect;
+	}
+
+	/* binding connects on its own, unless udc has been disconnected */
+	if (conn_fd >= 0 && write_fd(conn_fd, conn_path, "connect") < 0) {
+		fprintf(stderr, "Unable to connect %s: %s\n", dt->udc,
+			strerror(errno));
+		goto out;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	gt_backend_unload();
+	gt_gadget_switch_report(dt->udc, from[0] ? from : NULL, dt->to,
+				&start, &end);
+
+wait:
+	ret = 0;
+	if (dt->wait)
+		ret = gt_gadget_wait_udc(dt->to, dt->udc, dt->wait,
+					 dt->timeout, &bind);
+	goto out;
+
+reconnect:
+	if (conn_fd >= 0)
+		write_fd(conn_fd, conn_path, "connect");
+out:
+	if (from_fd >= 0)
+		close(from_fd);
+	if (to_fd >= 0)
+		close(to_fd);
+	if (conn_fd >= 0)
+		close(conn_fd);
+	return ret;
+}
+
+static void set_gadget_attr(struct usbg_gadget_attrs *g_attrs, int attr,
+		unsigned long val)
+{
+	switch (attr) {
+	case USBG_BCD_USB:
+		g_attrs->bcdUSB = val;
+		break;
+	case USBG_B_DEVICE_CLASS:
+		g_attrs->bDeviceClass = val;
+		break;
+	case USBG_B_DEVICE_SUB_CLASS:
+		g_attrs->bDeviceSubClass = val;
+		break;
+	case USBG_B_DEVICE_PROTOCOL:
+		g_attrs->bDeviceProtocol = val;
+		break;
+	case USBG_B_MAX_PACKET_SIZE_0:
+		g_attrs->bMaxPacketSize0 = val;
+		break;
+	case USBG_ID_VENDOR:
+		g_attrs->idVendor = val;
+		break;
+	case USBG_ID_PRODUCT:
+		g_attrs->idProduct = val;
+		break;
+	case USBG_BCD_DEVICE:
+		g_attrs->bcdDevice = val;
+		break;
+	}
+}
+
+static int get_func(void *data)
+{
+	struct gt_gadget_get_data *dt;
+	struct usbg_gadget_attrs g_attrs;
+	const char *name;
+	char buf[32];
+	char *end;
+	unsigned long val;
+	int dirfd;
+	int i;
+
+	dt = (struct gt_gadget_get_data *)data;
+
+	dirfd = gadget_dir(dt->name);
+	if (dirfd < 0) {
+		fprintf(stderr, "Gadget '%s' not found\n", dt->name);
+		return -1;
+	}
+
+	memset(&g_attrs, 0, sizeof(g_attrs));
+	for (i = USBG_GADGET_ATTR_MIN; i < USBG_GADGET_ATTR_MAX; i++) {
+		if (!dt->attrs[i])
+			continue;
+
+		name = usbg_get_gadget_attr_str(i);
+		if (read_attr(dirfd, name, buf, sizeof(buf)) < 0) {
+			fprintf(stderr, "Error on %s: %s\n", name,
+				strerror(errno));
+			return -1;
+		}
+
+		errno = 0;
+		val = strtoul(buf, &end, 0);
+		if (errno || end == buf || *end != '\0') {
+			fprintf(stderr, "Invalid value of %s: %s\n", name, buf);
+			return -1;
+		}
+
+		set_gadget_attr(&g_attrs, i, val);
+	}
+
+	gt_print_gadget_attrs(&g_attrs, dt->attrs);
+	gt_print_gadget_speed_attrs(dt->name, dt->speed_attrs);
+
+	return 0;
+}
+
+static int set_func(void *data)
+{
+	struct gt_gadget_set_data *dt;
+	char lang[16];
+	char path[64];
+	char buf[16];
+	int dirfd;
+	int ret = -1;
+	int i;
+
+	dt = (struct gt_gadget_set_data *)data;
+
+	dirfd = gadget_dir(dt->name);
+	if (dirfd < 0) {
+		fprintf(stderr, "Error on get gadget\n");
+		return -1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(dt->attr_val); ++i) {
+		if (dt->attr_val[i] < 0)
+			continue;
+
+		snprintf(buf, sizeof(buf), "0x%x", dt->attr_val[i]);
+		if (write_attr(dirfd, usbg_get_gadget_attr_str(i), buf) < 0) {
+			fprintf(stderr, "Unable to set attribute %s: %s\n",
+				usbg_get_gadget_attr_str(i),
+				strerror(errno));
+			goto out;
+		}
+	}
+
+	snprintf(lang, sizeof(lang), "strings/0x%x", LANG_US_ENG);
+	for (i = 0; i < GT_GADGET_STRS_COUNT; i++) {
+		if (dt->str_val[i] == NULL)
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", lang, gadget_strs[i].name);
+		/* kernel creates language directory only on request */
+		if ((GT_TRACE("configfs", lang, mkdirat, dirfd, lang,
+			      S_IRWXU | S_IRWXG | S_IRWXO) < 0
+		     && errno != EEXIST)
+		    || write_attr(dirfd, path, dt->str_val[i]) < 0) {
+			fprintf(stderr, "Unable to set string %s: %s\n",
+				gadget_strs[i].name, strerror(errno));
+			goto out;
+		}
+	}
+
+	for (i = 0; i < GT_GADGET_SPEED_ATTR_MAX; i++) {
+		if (dt->speed_val[i] != NULL
+		    && gt_gadget_set_speed_attr(dt->name, i,
+						dt->speed_val[i]) < 0)
+			goto out;
+	}
+
+	ret = 0;
+out:
+	/* libusbg state, if any, doesn't know about the change */
+	gt_backend_unload();
+	return ret;
+}
+
+/*
+ * Commands not listed here are executed by libusbg backend.
+ */
+struct gt_gadget_backend gt_gadget_backend_configfs = {
+	.get = get_func,
+	.set = set_func,
+	.enable = enable_func,
+	.disable = disable_func,
+	.switch_udc = switch_func,
+};
@@ -58,20 +58,20 @@ static int create_func(void *data)
 	}
 	gstrs = g_variant_builder_end(b);
 
-	v = g_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
-					"org.usb.gadgetd",
-					"/org/usb/Gadget",
-					"org.usb.device.GadgetManager",
-					"CreateGadget",
-					g_variant_new("(s@a{sv}@a{sv})",
-						      dt->name,
-						      gattrs,
-						      gstrs),
-					NULL,
-					G_DBUS_CALL_FLAGS_NONE,
-					-1,
-					NULL,
-					&err);
+	v = gt_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
+					 "org.usb.gadgetd",
+					 "/org/usb/Gadget",
+					 "org.usb.device.GadgetManager",
+					 "CreateGadget",
+					 g_variant_new("(s@a{sv}@a{sv})",
+						       dt->name,
+						       gattrs,
+						       gstrs),
+					 NULL,
+					 G_DBUS_CALL_FLAGS_NONE,
+					 -1,
+					 NULL,
+					 &err);
 
 	if (err) {
 		fprintf(stderr, "Unable to create gadget: %s\n", err->message);
@@ -99,18 +99,18 @@ static int enable_func(void *data)
 	const gchar *msg = NULL;
 	gboolean out_gadget_enabled = 0;
 
-	gret = g_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
-					   "org.usb.gadgetd",
-					   "/org/usb/Gadget",
-					   "org.usb.device.GadgetManager",
-					   "FindGadgetByName",
-					   g_variant_new("(s)",
-							 dt->gadget),
-					   NULL,
-					   G_DBUS_CALL_FLAGS_NONE,
-					   -1,
-					   NULL,
-					   &error);
+	gret = gt_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
+					    "org.usb.gadgetd",
+					    "/org/usb/Gadget",
+					    "org.usb.device.GadgetManager",
+					    "FindGadgetByName",
+					    g_variant_new("(s)",
+							  dt->gadget),
+					    NULL,
+					    G_DBUS_CALL_FLAGS_NONE,
+					    -1,
+					    NULL,
+					    &error);
 
 	if (error) {
 		fprintf(stderr, "Failed to get gadget, %s\n", error->message);
@@ -145,18 +145,18 @@ static int enable_func(void *data)
 		if (g_str_has_prefix(obj_path, "/org/usb/Gadget/UDC")) {
 			obj_path = g_dbus_object_get_object_path(G_DBUS_OBJECT(object));
 
-			gret = g_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
-							   "org.usb.gadgetd",
-							   obj_path,
-							   "org.usb.device.UDC",
-							   "EnableGadget",
-							   g_variant_new("(o)",
-									 g_path),
-							   NULL,
-							   G_DBUS_CALL_FLAGS_NONE,
-							   -1,
-							   NULL,
-							   &error);
+			gret = gt_dbus_connection_call_sync(backend_ctx.gadgetd_conn,
+							    "org.usb.gadgetd",
+							    obj_path,
+							    "org.usb.device.UDC",
+							    "EnableGadget",
+							    g_variant_new("(o)",
+									  g_path),
+							    NULL,
+							    G_DBUS_CALL_FLAGS_NONE,
+							    -1,
+							    NULL,
+							    &error);
 			if (error) {
 				msg = error->message;
 				goto out;
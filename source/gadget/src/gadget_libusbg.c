@@ -15,16 +15,25 @@
  */
 
 #include <usbg/usbg.h>
+#include <usbg/function/ms.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <libconfig.h>
 #include <sys/stat.h>
-#include <dirent.h>
 
 #include "gadget.h"
+#include "gadget_scheme.h"
+#include "gadget_binary.h"
+#include "template_index.h"
 #include "backend.h"
 #include "common.h"
 #include "settings.h"
 #include "function.h"
+#include "udc.h"
 #include "configuration.h"
+#include "trace.h"
 
 #ifndef WITH_GADGETD
 #define G_N_ELEMENTS(arr)	(sizeof(arr) / sizeof((arr)[0]))
@@ -60,11 +69,12 @@ static int create_func(void *data)
 
 	dt = (struct gt_gadget_create_data *)data;
 
-	r = usbg_create_gadget(backend_ctx.libusbg_state,
-			       dt->name,
-			       NULL,
-			       NULL,
-			       &g);
+	r = GT_TRACE("usbg", dt->name, usbg_create_gadget,
+		     backend_ctx.libusbg_state,
+		     dt->name,
+		     NULL,
+		     NULL,
+		     &g);
 	if (r != USBG_SUCCESS) {
 		fprintf(stderr, "Unable to create gadget %s: %s\n",
 			dt->name, usbg_strerror(r));
@@ -75,7 +85,8 @@ static int create_func(void *data)
 		if (dt->attr_val[i] == -1)
 			continue;
 
-		r = usbg_set_gadget_attr(g, i, dt->attr_val[i]);
+		r = GT_TRACE("usbg", usbg_get_gadget_name(g),
+			     usbg_set_gadget_attr, g, i, dt->attr_val[i]);
 		if (r != USBG_SUCCESS) {
 			fprintf(stderr, "Unable to set attribute %s: %s\n",
 				usbg_get_gadget_attr_str(i),
@@ -97,10 +108,18 @@ static int create_func(void *data)
 		}
 	}
 
+	for (i = 0; i < GT_GADGET_SPEED_ATTR_MAX; i++) {
+		if (dt->speed_val[i] != NULL
+		    && gt_gadget_set_speed_attr(dt->name, i,
+						dt->speed_val[i]) < 0)
+			goto err_usbg;
+	}
+
 	return 0;
 
 err_usbg:
-	usbg_rm_gadget(g, USBG_RM_RECURSE);
+	GT_TRACE("usbg", usbg_get_gadget_name(g),
+		 usbg_rm_gadget, g, USBG_RM_RECURSE);
 	return -1;
 }
 
@@ -128,7 +147,8 @@ static int rm_func(void *data)
 			goto err;
 		}
 
-		usbg_ret = usbg_disable_gadget(g);
+		usbg_ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+				    usbg_disable_gadget, g);
 		if (usbg_ret != USBG_SUCCESS) {
 			fprintf(stderr, "Error on disable gadget: %s : %s\n",
 				usbg_error_name(usbg_ret), usbg_strerror(usbg_ret));
@@ -139,7 +159,8 @@ static int rm_func(void *data)
 	if (dt->opts & GT_RECURSIVE)
 		opts |= USBG_RM_RECURSE;
 
-	usbg_ret = usbg_rm_gadget(g, opts);
+	usbg_ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+			    usbg_rm_gadget, g, opts);
 	if (usbg_ret != USBG_SUCCESS){
 		fprintf(stderr, "Error on gadget remove: %s : %s\n",
 			usbg_error_name(usbg_ret), usbg_strerror(usbg_ret));
@@ -151,6 +172,38 @@ err:
 	return -1;
 }
 
+/**
+ * @brief Wait for daemons of all ffs functions of gadget
+ */
+static int wait_ffs_functions(usbg_gadget *g, const char *mount_dir,
+		int timeout)
+{
+	const char **instances;
+	usbg_function *f;
+	int count = 0;
+	int ret;
+
+	usbg_for_each_function(f, g)
+		if (usbg_get_function_type(f) == USBG_F_FFS)
+			count++;
+
+	if (count == 0)
+		return 0;
+
+	instances = calloc(count, sizeof(*instances));
+	if (instances == NULL)
+		return -1;
+
+	count = 0;
+	usbg_for_each_function(f, g)
+		if (usbg_get_function_type(f) == USBG_F_FFS)
+			instances[count++] = usbg_get_function_instance(f);
+
+	ret = gt_gadget_wait_ffs(instances, count, mount_dir, timeout);
+	free(instances);
+	return ret;
+}
+
 static int enable_func(void *data)
 {
 	struct gt_gadget_enable_data *dt;
@@ -159,6 +212,7 @@ static int enable_func(void *data)
 
 	usbg_gadget *g;
 	usbg_udc *udc = NULL;
+	struct timespec bind;
 	int usbg_ret;
 
 	if (dt->udc != NULL) {
@@ -183,12 +237,37 @@ static int enable_func(void *data)
 		}
 	}
 
-	usbg_ret = usbg_enable_gadget(g, udc);
+	if (dt->ffs_wait &&
+	    wait_ffs_functions(g, dt->ffs_mount, dt->timeout) < 0)
+		return -1;
+
+	gt_gadget_check_max_speed(usbg_get_gadget_name(g),
+		usbg_get_udc_name(udc ? udc
+			: usbg_get_first_udc(backend_ctx.libusbg_state)));
+
+	clock_gettime(CLOCK_MONOTONIC, &bind);
+	usbg_ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+			    usbg_enable_gadget, g, udc);
 	if (usbg_ret != USBG_SUCCESS) {
 		fprintf(stderr, "Failed to enable gadget %s\n", usbg_strerror(usbg_ret));
 		return -1;
 	}
 
+	/* soft_connect is refused until gadget is bound, so host may
+	 * notice the device for a moment */
+	if (dt->disconnected &&
+	    gt_udc_soft_connect(usbg_get_udc_name(usbg_get_gadget_udc(g)),
+				0) < 0) {
+		GT_TRACE("usbg", usbg_get_gadget_name(g),
+			 usbg_disable_gadget, g);
+		return -1;
+	}
+
+	if (dt->wait)
+		return gt_gadget_wait_udc(usbg_get_gadget_name(g),
+			usbg_get_udc_name(usbg_get_gadget_udc(g)),
+			dt->wait, dt->timeout, &bind);
+
 	return 0;
 }
 
@@ -228,7 +307,8 @@ static int disable_func(void *data)
 		}
 	}
 
-	usbg_ret = usbg_disable_gadget(g);
+	usbg_ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+			    usbg_disable_gadget, g);
 	if (usbg_ret != USBG_SUCCESS) {
 		fprintf(stderr, "Error on disable gadget: %s : %s\n",
 			usbg_error_name(usbg_ret), usbg_strerror(usbg_ret));
@@ -238,30 +318,6 @@ static int disable_func(void *data)
 	return 0;
 }
 
-static void print_gadget_attrs(struct usbg_gadget_attrs *g_attrs, int *mask) {
-	if (!mask || mask[USBG_BCD_USB])
-		printf("  bcdUSB\t\t%x.%02x\n",
-			g_attrs->bcdUSB >> 8,
-			g_attrs->bcdUSB & 0x00ff);
-
-	if (!mask || mask[USBG_B_DEVICE_CLASS])
-		printf("  bDeviceClass\t\t0x%02x\n", g_attrs->bDeviceClass);
-	if (!mask || mask[USBG_B_DEVICE_SUB_CLASS])
-		printf("  bDeviceSubClass\t0x%02x\n", g_attrs->bDeviceSubClass);
-	if (!mask || mask[USBG_B_DEVICE_PROTOCOL])
-		printf("  bDeviceProtocol\t0x%02x\n", g_attrs->bDeviceProtocol);
-	if (!mask || mask[USBG_B_MAX_PACKET_SIZE_0])
-		printf("  bMaxPacketSize0\t%d\n", g_attrs->bMaxPacketSize0);
-	if (!mask || mask[USBG_ID_VENDOR])
-		printf("  idVendor\t\t0x%04x\n", g_attrs->idVendor);
-	if (!mask || mask[USBG_ID_PRODUCT])
-		printf("  idProduct\t\t0x%04x\n", g_attrs->idProduct);
-	if (!mask || mask[USBG_BCD_DEVICE])
-		printf("  bcdDevice\t\t%x.%02x\n",
-			g_attrs->bcdDevice >> 8,
-			g_attrs->bcdDevice & 0x00ff);
-}
-
 static int get_func(void *data)
 {
 	struct gt_gadget_get_data *dt;
@@ -285,7 +341,8 @@ static int get_func(void *data)
 		return -1;
 	}
 
-	print_gadget_attrs(&g_attrs, dt->attrs);
+	gt_print_gadget_attrs(&g_attrs, dt->attrs);
+	gt_print_gadget_speed_attrs(dt->name, dt->speed_attrs);
 
 	return 0;
 }
@@ -326,8 +383,10 @@ static int print_gadget(usbg_gadget *g, int opts)
 		putchar('\n');
 	}
 
-	if (opts & GT_VERBOSE)
-		print_gadget_attrs(&g_attrs, NULL);
+	if (opts & GT_VERBOSE) {
+		gt_print_gadget_attrs(&g_attrs, NULL);
+		gt_print_gadget_speed_attrs(name, NULL);
+	}
 
 	if (opts & GT_RECURSIVE) {
 		usbg_for_each_function(f, g) {
@@ -342,6 +401,122 @@ static int print_gadget(usbg_gadget *g, int opts)
 	return 0;
 }
 
+static int json_gadget(struct gt_json *j, usbg_gadget *g)
+{
+	struct usbg_gadget_attrs g_attrs;
+	struct usbg_gadget_strs g_strs;
+	usbg_function *f;
+	usbg_config *c;
+	usbg_udc *u;
+	char speed[32];
+	int usbg_ret;
+	int i;
+
+	usbg_ret = usbg_get_gadget_attrs(g, &g_attrs);
+	if (usbg_ret != USBG_SUCCESS) {
+		fprintf(stderr, "Error: %s : %s\n",
+			usbg_error_name(usbg_ret), usbg_strerror(usbg_ret));
+		return -1;
+	}
+
+	usbg_ret = usbg_get_gadget_strs(g, LANG_US_ENG, &g_strs);
+	if (usbg_ret != USBG_SUCCESS && usbg_ret != USBG_ERROR_NOT_FOUND) {
+		fprintf(stderr, "Error: %s : %s\n",
+			usbg_error_name(usbg_ret), usbg_strerror(usbg_ret));
+		return -1;
+	}
+
+	u = usbg_get_gadget_udc(g);
+
+	gt_json_begin_object(j, NULL);
+	gt_json_string(j, "name", usbg_get_gadget_name(g));
+	gt_json_string(j, "udc", u ? usbg_get_udc_name(u) : NULL);
+
+	gt_json_begin_object(j, "attrs");
+	gt_json_int(j, "bcdUSB", g_attrs.bcdUSB);
+	gt_json_int(j, "bDeviceClass", g_attrs.bDeviceClass);
+	gt_json_int(j, "bDeviceSubClass", g_attrs.bDeviceSubClass);
+	gt_json_int(j, "bDeviceProtocol", g_attrs.bDeviceProtocol);
+	gt_json_int(j, "bMaxPacketSize0", g_attrs.bMaxPacketSize0);
+	gt_json_int(j, "idVendor", g_attrs.idVendor);
+	gt_json_int(j, "idProduct", g_attrs.idProduct);
+	gt_json_int(j, "bcdDevice", g_attrs.bcdDevice);
+	for (i = 0; i < GT_GADGET_SPEED_ATTR_MAX; i++)
+		if (gt_gadget_get_speed_attr(usbg_get_gadget_name(g), i,
+					     speed, sizeof(speed)) == 0)
+			gt_json_string(j, gadget_speed_attrs[i], speed);
+	gt_json_end_object(j);
+
+	gt_json_begin_object(j, "strings");
+	if (usbg_ret == USBG_SUCCESS) {
+		gt_json_string(j, "manufacturer", g_strs.manufacturer);
+		gt_json_string(j, "product", g_strs.product);
+		gt_json_string(j, "serialnumber", g_strs.serial);
+		usbg_free_gadget_strs(&g_strs);
+	} else {
+		gt_json_string(j, "manufacturer", NULL);
+		gt_json_string(j, "product", NULL);
+		gt_json_string(j, "serialnumber", NULL);
+	}
+	gt_json_end_object(j);
+
+	gt_json_begin_array(j, "functions");
+	usbg_for_each_function(f, g) {
+		if (gt_json_function_libusbg(j, f) < 0)
+			return -1;
+	}
+	gt_json_end_array(j);
+
+	gt_json_begin_array(j, "configs");
+	usbg_for_each_config(c, g) {
+		if (gt_json_config_libusbg(j, c) < 0)
+			return -1;
+	}
+	gt_json_end_array(j);
+
+	gt_json_end_object(j);
+	return 0;
+}
+
+static int gadget_json(struct gt_gadget_gadget_data *dt)
+{
+	struct gt_json j;
+	usbg_gadget *g;
+	int ret = 0;
+
+	if (dt->name) {
+		g = usbg_get_gadget(backend_ctx.libusbg_state, dt->name);
+		if (g == NULL) {
+			fprintf(stderr, "Gadget '%s' not found\n", dt->name);
+			return -1;
+		}
+	}
+
+	if (gt_json_init(&j) < 0)
+		return -1;
+
+	gt_json_begin_object(&j, NULL);
+	gt_json_begin_array(&j, "gadgets");
+	if (dt->name) {
+		ret = json_gadget(&j, g);
+	} else {
+		usbg_for_each_gadget(g, backend_ctx.libusbg_state) {
+			ret = json_gadget(&j, g);
+			if (ret < 0)
+				break;
+		}
+	}
+	gt_json_end_array(&j);
+	gt_json_end_object(&j);
+
+	if (ret < 0)
+		gt_json_free(&j);
+	else
+		ret = gt_json_flush(&j, stdout);
+
+	return ret;
+}
+
 static int gadget_func(void *data)
 {
 	struct gt_gadget_gadget_data *dt;
@@ -351,6 +526,9 @@ static int gadget_func(void *data)
 
 	dt = (struct gt_gadget_gadget_data *)data;
 
+	if (dt->opts & GT_JSON)
+		return gadget_json(dt);
+
 	if (dt->name) {
 		g = usbg_get_gadget(backend_ctx.libusbg_state, dt->name);
 		if (g == NULL) {
@@ -374,69 +552,88 @@ out:
 	return usbg_ret;
 }
 
-static int load_func(void *data)
+/**
+ * @brief Set speed attributes given in scheme, libusbg ignores them
+ */
+static int import_speed_attrs(const config_t *cfg, const char *gadget)
 {
-	FILE *fp = NULL;
-	struct gt_gadget_load_data *dt;
-	const char *filename = NULL;
-	const char **ptr;
-	struct stat st;
-	char buf[PATH_MAX];
-	usbg_gadget *g;
-	int ret;
+	config_setting_t *attrs, *m;
+	const char *val;
+	int ret = 0;
+	int i;
 
-	dt = (struct gt_gadget_load_data *)data;
+	attrs = config_lookup(cfg, "attrs");
+	for (i = 0; attrs && i < GT_GADGET_SPEED_ATTR_MAX; i++) {
+		m = config_setting_get_member(attrs, gadget_speed_attrs[i]);
+		if (m == NULL)
+			continue;
 
-	if (dt->opts & GT_STDIN) {
-		fp = stdin;
-	} else if (dt->file) {
-		filename = dt->file;
-	} else if (dt->path) {
-		ret = snprintf(buf, sizeof(buf), "%s/%s", dt->path, dt->name);
-		if (ret >= sizeof(buf)) {
-			fprintf(stderr, "path too long\n");
+		val = config_setting_get_string(m);
+		if (val == NULL || !gt_gadget_speed_attr_valid(i, val)) {
+			fprintf(stderr, "Invalid value of %s\n",
+				gadget_speed_attrs[i]);
 			return -1;
 		}
 
-		filename = buf;
-	} else {
-		if (gt_settings.lookup_path != NULL) {
-			ptr = gt_settings.lookup_path;
-			while (*ptr) {
-				ret = snprintf(buf, sizeof(buf), "%s/%s", *ptr, dt->name);
-				if (ret >= sizeof(buf)) {
-					fprintf(stderr, "path too long\n");
-					return -1;
-				}
-
-				if (stat(buf, &st) == 0) {
-					filename = buf;
-					break;
-				}
-
-				ptr++;
-			}
-		}
-
-		/* use current directory as path */
-		if (filename == NULL && stat(dt->name, &st) == 0)
-			filename = dt->name;
+		ret = gt_gadget_set_speed_attr(gadget, i, val);
+		if (ret < 0)
+			break;
 	}
 
-	if (filename == NULL && fp == NULL) {
-		fprintf(stderr, "Could not find matching gadget file.\n");
+	return ret;
+}
+
+/**
+ * @brief Parse scheme for what libusbg doesn't do on import
+ * @details Errors are not reported, usbg_import_gadget() reports them.
+ * @return 0 if scheme has been parsed, -1 otherwise
+ */
+static int parse_scheme(char *buf, size_t size, const char *name,
+		config_t *cfg)
+{
+	FILE *fp;
+	int ret;
+
+	fp = fmemopen(buf, size, "r");
+	if (fp == NULL)
+		return -1;
+
+	config_init(cfg);
+	ret = GT_TRACE("libconfig", name, config_read, cfg, fp);
+	fclose(fp);
+	if (ret != CONFIG_TRUE) {
+		config_destroy(cfg);
 		return -1;
 	}
 
+	return 0;
+}
+
+static int import_gadget(char *buf, size_t size,
+		struct gt_gadget_load_data *dt, usbg_gadget **g)
+{
+	int types[USBG_FUNCTION_TYPE_MAX] = {0};
+	config_t cfg;
+	FILE *fp;
+	int parsed;
+	int ret;
+
+	parsed = parse_scheme(buf, size, dt->gadget_name, &cfg) == 0;
+
+	/* modules load concurrently instead of one by one on each mkdir */
+	if (parsed && gt_func_scheme_types(config_root_setting(&cfg), types))
+		gt_func_preload(types, GT_QUIET);
+
+	fp = fmemopen(buf, size, "r");
 	if (fp == NULL) {
-		fp = fopen(filename, "r");
-		if (fp == NULL) {
-			perror("Error opening file");
-			return -1;
-		}
+		ret = -1;
+		goto out;
 	}
 
-	ret = usbg_import_gadget(backend_ctx.libusbg_state, fp, dt->gadget_name, &g);
+	ret = GT_TRACE("usbg", dt->gadget_name,
+		       usbg_import_gadget, backend_ctx.libusbg_state, fp,
+		       dt->gadget_name, g);
+	fclose(fp);
 	if (ret != USBG_SUCCESS) {
 		fprintf(stderr, "Error on import gadget\n");
 		fprintf(stderr, "Error: %s : %s\n", usbg_error_name(ret),
@@ -448,180 +645,1392 @@ static int load_func(void *data)
 		goto out;
 	}
 
+	if (parsed && import_speed_attrs(&cfg, dt->gadget_name) < 0) {
+		GT_TRACE("usbg", usbg_get_gadget_name(*g),
+			 usbg_rm_gadget, *g, USBG_RM_RECURSE);
+		ret = USBG_ERROR_INVALID_PARAM;
+		goto out;
+	}
+
 	if (!(dt->opts & GT_OFF)) {
-		ret = usbg_enable_gadget(g, NULL);
-		if (ret != USBG_SUCCESS) {
+		ret = GT_TRACE("usbg", usbg_get_gadget_name(*g),
+			       usbg_enable_gadget, *g, NULL);
+		if (ret != USBG_SUCCESS)
 			fprintf(stderr, "Failed to enable gadget %s\n", usbg_strerror(ret));
-			goto out;
-		}
 	}
 
 out:
-	if (fp != stdin)
-		fclose(fp);
-
+	if (parsed)
+		config_destroy(&cfg);
 	return ret;
 }
 
-static int save_func(void *data)
+/**
+ * @brief Read whole stream into newly allocated buffer
+ */
+static char *read_stream(FILE *fp, size_t *size)
 {
-	struct gt_gadget_save_data *dt;
-	const char *filename = NULL;
-	FILE *fp = NULL;
-	char buf[PATH_MAX];
-	usbg_gadget *g;
-	struct stat st;
-	int ret;
+	char *buf = NULL;
+	char chunk[4096];
+	FILE *mem;
+	size_t n;
+
+	mem = open_memstream(&buf, size);
+	if (mem == NULL)
+		return NULL;
+
+	while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+		fwrite(chunk, 1, n, mem);
+
+	fclose(mem);
+	if (ferror(fp)) {
+		free(buf);
+		return NULL;
+	}
 
-	dt = (struct gt_gadget_save_data *)data;
+	return buf;
+}
 
-	if (dt->opts & GT_STDOUT) {
-		fp = stdout;
-	} else if (dt->file) {
-		filename = dt->file;
-	} else if (dt->path) {
-		ret = snprintf(buf, sizeof(buf), "%s/%s", dt->path, dt->name);
-		if (ret >= sizeof(buf)) {
-			fprintf(stderr, "path too long\n");
-			return -1;
+/**
+ * @brief Compute fingerprint of gadget scheme
+ * @details Scheme is normalized by libconfig, so comments and formatting
+ * don't affect the result.
+ */
+static uint64_t scheme_hash(char *buf, size_t size)
+{
+	char *canon = NULL;
+	size_t len = 0;
+	uint64_t hash;
+	config_t cfg;
+	FILE *in, *out;
+
+	hash = gt_hash(buf, size);
+
+	in = fmemopen(buf, size, "r");
+	if (in == NULL)
+		return hash;
+
+	config_init(&cfg);
+	if (GT_TRACE("libconfig", NULL, config_read, &cfg, in) == CONFIG_TRUE) {
+		out = open_memstream(&canon, &len);
+		if (out) {
+			config_write(&cfg, out);
+			fclose(out);
+			hash = gt_hash(canon, len);
+			free(canon);
 		}
+	}
 
-		filename = buf;
-	} else if (gt_settings.default_template_path) {
-		ret = snprintf(buf, sizeof(buf), "%s/%s",
-				gt_settings.default_template_path, dt->name);
-		if (ret >= sizeof(buf)) {
-			fprintf(stderr, "path too long\n");
-			return -1;
-		}
+	config_destroy(&cfg);
+	fclose(in);
+	return hash;
+}
 
-		filename = buf;
-	} else {
-		fprintf(stderr, "Path not specified\n");
-		return -1;
-	}
+/**
+ * @brief Compute fingerprint of gadget present in configfs
+ */
+static int gadget_hash(usbg_gadget *g, uint64_t *hash)
+{
+	char *buf = NULL;
+	size_t size = 0;
+	FILE *mem;
+	int ret;
 
-	g = usbg_get_gadget(backend_ctx.libusbg_state, dt->gadget);
-	if (!g) {
-		fprintf(stderr, "Error on get gadget\n");
+	mem = open_memstream(&buf, &size);
+	if (mem == NULL)
 		return -1;
+
+	ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+		       usbg_export_gadget, g, mem);
+	if (ret == USBG_SUCCESS) {
+		char val[32];
+		int i;
+
+		/* libusbg doesn't export them, but they are part of gadget */
+		for (i = 0; i < GT_GADGET_SPEED_ATTR_MAX; i++)
+			if (gt_gadget_get_speed_attr(usbg_get_gadget_name(g), i,
+						     val, sizeof(val)) == 0)
+				fprintf(mem, "%s = \"%s\";\n",
+					gadget_speed_attrs[i], val);
 	}
+	fclose(mem);
+	if (ret == USBG_SUCCESS)
+		*hash = gt_hash(buf, size);
 
-	if (fp == NULL) {
-		if (!(dt->opts & GT_FORCE) && stat(filename, &st) == 0) {
-			fprintf(stderr, "File exists.\n");
-			return -1;
-		}
+	free(buf);
+	return ret == USBG_SUCCESS ? 0 : -1;
+}
 
-		fp = fopen(filename, "w");
-		if (fp == NULL) {
-			perror("Error opening file\n");
-			return -1;
-		}
-	}
+/**
+ * @brief Get path of file with load state of gadget
+ * @details Gadgets in other configfs than the default one may have the
+ * same names, so their state is kept apart, distinguished by the root.
+ */
+static int load_state_path(char *buf, size_t size, const char *name)
+{
+	const char *root = gt_settings.configfs_path;
+	size_t len = strlen(root);
+	int ret;
 
-	ret = usbg_export_gadget(g, fp);
-	if (ret != USBG_SUCCESS) {
-		fprintf(stderr, "Error on export gadget\n");
-		fprintf(stderr, "Error: %s : %s\n", usbg_error_name(ret),
-				usbg_strerror(ret));
-		goto out;
-	}
+	while (len > 1 && root[len - 1] == '/')
+		len--;
 
-out:
-	fclose(fp);
-	return ret;
+	if (len == strlen(GT_DEFAULT_CONFIGFS_PATH) - 1
+	    && strncmp(root, GT_DEFAULT_CONFIGFS_PATH, len) == 0)
+		ret = snprintf(buf, size, "%s/%s", GT_STATE_PATH, name);
+	else
+		ret = snprintf(buf, size, "%s/%s.%016" PRIx64, GT_STATE_PATH,
+			       name, gt_hash(root, len));
+
+	return ret < size ? 0 : -1;
 }
 
-static int set_func(void *data)
+static int read_load_state(const char *name, uint64_t *scheme, uint64_t *live)
 {
-	struct gt_gadget_set_data *dt;
-	int i;
-	usbg_gadget *g;
+	char path[PATH_MAX];
+	FILE *fp;
 	int ret;
 
-	dt = (struct gt_gadget_set_data *)data;
+	if (load_state_path(path, sizeof(path), name) < 0)
+		return -1;
 
-	g = usbg_get_gadget(backend_ctx.libusbg_state, dt->name);
-	if (!g) {
-		fprintf(stderr, "Error on get gadget\n");
+	fp = fopen(path, "r");
+	if (fp == NULL)
 		return -1;
-	}
 
-	for (i = 0; i < ARRAY_SIZE(dt->attr_val); ++i) {
-		if (dt->attr_val[i] < 0)
-			continue;
+	ret = fscanf(fp, "%" SCNx64 " %" SCNx64, scheme, live);
+	fclose(fp);
 
-		ret = usbg_set_gadget_attr(g, i, dt->attr_val[i]);
-		if (ret != USBG_SUCCESS) {
-			fprintf(stderr, "Unable to set attribute %s: %s\n",
-				usbg_get_gadget_attr_str(i),
-				usbg_strerror(ret));
-			return -1;
-		}
-	}
+	return ret == 2 ? 0 : -1;
+}
 
-	for (i = 0; i < G_N_ELEMENTS(dt->str_val); i++) {
-		if (dt->str_val[i] == NULL)
-			continue;
+static void write_load_state(const char *name, uint64_t scheme, uint64_t live)
+{
+	char path[PATH_MAX];
+	FILE *fp;
 
-		ret = gadget_strs[i].set_fn(g, LANG_US_ENG, dt->str_val[i]);
-		if (ret != USBG_SUCCESS) {
-			fprintf(stderr, "Unable to set string %s: %s\n",
-				gadget_strs[i].name,
+	if (load_state_path(path, sizeof(path), name) < 0)
+		return;
+
+	if (mkdir(GT_STATE_PATH, 0755) < 0 && errno != EEXIST)
+		goto err;
+
+	fp = fopen(path, "w");
+	if (fp == NULL)
+		goto err;
+
+	fprintf(fp, "%016" PRIx64 " %016" PRIx64 "\n", scheme, live);
+	if (fclose(fp) == 0)
+		return;
+err:
+	fprintf(stderr, "Unable to store state of gadget %s: %s\n",
+		name, strerror(errno));
+}
+
+/**
+ * @brief Load gadget only if scheme or gadget has changed since last load
+ * @details Fingerprints of scheme and resulting gadget are stored in
+ * GT_STATE_PATH. If both match, gadget is left untouched (only enabled if
+ * needed), so host doesn't see a disconnect. Otherwise existing gadget
+ * is removed and loaded again.
+ */
+static int load_if_changed(char *buf, size_t size,
+		struct gt_gadget_load_data *dt)
+{
+	uint64_t scheme, live, old_scheme, old_live;
+	usbg_gadget *g;
+	int ret;
+
+	scheme = scheme_hash(buf, size);
+
+	g = usbg_get_gadget(backend_ctx.libusbg_state, dt->gadget_name);
+	if (g && gadget_hash(g, &live) == 0
+	    && read_load_state(dt->gadget_name, &old_scheme, &old_live) == 0
+	    && scheme == old_scheme && live == old_live) {
+		ret = USBG_SUCCESS;
+		if (!(dt->opts & GT_OFF) && usbg_get_gadget_udc(g) == NULL) {
+			ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+				       usbg_enable_gadget, g, NULL);
+			if (ret != USBG_SUCCESS)
+				fprintf(stderr, "Failed to enable gadget %s\n",
+					usbg_strerror(ret));
+		}
+		return ret;
+	}
+
+	if (g) {
+		if (usbg_get_gadget_udc(g))
+			GT_TRACE("usbg", usbg_get_gadget_name(g),
+				 usbg_disable_gadget, g);
+
+		ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+			       usbg_rm_gadget, g, USBG_RM_RECURSE);
+		if (ret != USBG_SUCCESS) {
+			fprintf(stderr, "Error on removing gadget\n");
+			fprintf(stderr, "Error: %s : %s\n", usbg_error_name(ret),
+					usbg_strerror(ret));
+			return ret;
+		}
+	}
+
+	ret = import_gadget(buf, size, dt, &g);
+	if (ret != USBG_SUCCESS)
+		return ret;
+
+	if (gadget_hash(g, &live) == 0)
+		write_load_state(dt->gadget_name, scheme, live);
+
+	return ret;
+}
+
+/**
+ * @brief Load modules of functions created by compiled scheme
+ */
+static void preload_binary_functions(const struct gt_binary *bin)
+{
+	int types[USBG_FUNCTION_TYPE_MAX] = {0};
+	const struct gt_binary_op *op;
+	const char *path, *dot;
+	char type[32];
+	uint32_t i;
+	int t;
+
+	for (i = 0; i < bin->header->count; i++) {
+		op = &bin->ops[i];
+		path = bin->strings + op->path;
+		if (op->type != GT_BINARY_MKDIR
+		    || strncmp(path, "functions/", strlen("functions/")) != 0)
+			continue;
+
+		path += strlen("functions/");
+		dot = strchr(path, '.');
+		if (dot == NULL || dot - path >= sizeof(type))
+			continue;
+
+		snprintf(type, sizeof(type), "%.*s", (int)(dot - path), path);
+		t = usbg_lookup_function_type(type);
+		if (t >= 0)
+			types[t] = 1;
+	}
+
+	gt_func_preload(types, GT_QUIET);
+}
+
+static int load_binary(const struct gt_binary *bin,
+		struct gt_gadget_load_data *dt)
+{
+	char root[PATH_MAX];
+	char udc[NAME_MAX + 1];
+	int ret;
+
+	if (dt->opts & GT_IF_CHANGED) {
+		fprintf(stderr, "--if-changed can't be used with compiled scheme\n");
+		return -1;
+	}
+
+	if (gt_binary_check_source(bin) < 0)
+		return -1;
+
+	/* libusbg is not initialized, scheme is applied without it */
+	ret = snprintf(root, sizeof(root), "%s/usb_gadget",
+		       gt_settings.configfs_path);
+	if (ret >= sizeof(root)) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	preload_binary_functions(bin);
+
+	/* same controller as usbg_enable_gadget() would choose */
+	if (!(dt->opts & GT_OFF)
+	    && gt_gadget_first_udc(udc, sizeof(udc)) < 0) {
+		fprintf(stderr, "Failed to enable gadget: no UDC\n");
+		return -1;
+	}
+
+	return gt_binary_apply(bin, root, dt->gadget_name,
+			       dt->opts & GT_OFF ? NULL : udc);
+}
+
+static int load_func(void *data)
+{
+	FILE *fp = NULL;
+	struct gt_gadget_load_data *dt;
+	const char *filename = NULL;
+	struct gt_binary bin;
+	struct stat st;
+	char buf[PATH_MAX];
+	char *scheme;
+	size_t size;
+	usbg_gadget *g;
+	int ret;
+
+	dt = (struct gt_gadget_load_data *)data;
+
+	if (dt->opts & GT_STDIN) {
+		fp = stdin;
+	} else if (dt->file) {
+		filename = dt->file;
+	} else if (dt->path) {
+		ret = snprintf(buf, sizeof(buf), "%s/%s", dt->path, dt->name);
+		if (ret >= sizeof(buf)) {
+			fprintf(stderr, "path too long\n");
+			return -1;
+		}
+
+		filename = buf;
+	} else {
+		ret = gt_gadget_find_template(dt->name, buf, sizeof(buf));
+		if (ret < 0)
+			return -1;
+		if (ret > 0)
+			filename = buf;
+
+		/* use current directory as path */
+		if (filename == NULL && stat(dt->name, &st) == 0)
+			filename = dt->name;
+	}
+
+	if (filename == NULL && fp == NULL) {
+		fprintf(stderr, "Could not find matching gadget file.\n");
+		return -1;
+	}
+
+	if (fp == NULL) {
+		ret = gt_binary_open(filename, &bin);
+		if (ret < 0)
+			return ret;
+
+		if (ret == 0) {
+			ret = load_binary(&bin, dt);
+			gt_binary_close(&bin);
+			goto record;
+		}
+
+		fp = fopen(filename, "r");
+		if (fp == NULL) {
+			perror("Error opening file");
+			return -1;
+		}
+	}
+
+	scheme = read_stream(fp, &size);
+	if (fp != stdin)
+		fclose(fp);
+
+	if (scheme == NULL) {
+		fprintf(stderr, "Error reading gadget file\n");
+		return -1;
+	}
+
+	if (size == 0) {
+		fprintf(stderr, "Gadget file is empty\n");
+		free(scheme);
+		return -1;
+	}
+
+	if (dt->opts & GT_IF_CHANGED)
+		ret = load_if_changed(scheme, size, dt);
+	else
+		ret = import_gadget(scheme, size, dt, &g);
+
+	free(scheme);
+
+record:
+	if (ret == USBG_SUCCESS && dt->record) {
+		ret = snprintf(buf, sizeof(buf), "%s/usb_gadget",
+			       gt_settings.configfs_path);
+		if (ret >= sizeof(buf)) {
+			fprintf(stderr, "path too long\n");
+			return -1;
+		}
+
+		ret = gt_binary_record(buf, dt->gadget_name, dt->record);
+	}
+
+	return ret;
+}
+
+static int replay_func(void *data)
+{
+	struct gt_gadget_replay_data *dt;
+	struct gt_binary bin;
+	char root[PATH_MAX];
+	const char *name, *udc = NULL;
+	int ret;
+
+	dt = (struct gt_gadget_replay_data *)data;
+
+	/* libusbg is not initialized, plan is applied without it */
+	ret = snprintf(root, sizeof(root), "%s/usb_gadget",
+		       gt_settings.configfs_path);
+	if (ret >= sizeof(root)) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	ret = gt_binary_open(dt->file, &bin);
+	if (ret != 0) {
+		if (ret > 0)
+			fprintf(stderr, "%s is not a replay plan\n", dt->file);
+		return -1;
+	}
+
+	name = dt->gadget;
+	if (name == NULL && bin.header->name)
+		name = bin.strings + bin.header->name;
+	if (name == NULL) {
+		fprintf(stderr, "Gadget name not specified\n");
+		ret = -1;
+		goto out;
+	}
+
+	if (!(dt->opts & GT_OFF) && bin.header->udc)
+		udc = bin.strings + bin.header->udc;
+
+	ret = gt_binary_check_source(&bin);
+	if (ret == 0) {
+		preload_binary_functions(&bin);
+		ret = gt_binary_apply(&bin, root, name, udc);
+	}
+
+out:
+	gt_binary_close(&bin);
+	return ret;
+}
+
+static int save_func(void *data)
+{
+	struct gt_gadget_save_data *dt;
+	const char *filename = NULL;
+	FILE *fp = NULL;
+	char buf[PATH_MAX];
+	usbg_gadget *g;
+	struct stat st;
+	config_t cfg;
+	int ret;
+
+	dt = (struct gt_gadget_save_data *)data;
+
+	if (dt->opts & GT_STDOUT) {
+		fp = stdout;
+	} else if (dt->file) {
+		filename = dt->file;
+	} else if (dt->path) {
+		ret = snprintf(buf, sizeof(buf), "%s/%s", dt->path, dt->name);
+		if (ret >= sizeof(buf)) {
+			fprintf(stderr, "path too long\n");
+			return -1;
+		}
+
+		filename = buf;
+	} else if (gt_settings.default_template_path) {
+		ret = snprintf(buf, sizeof(buf), "%s/%s",
+				gt_settings.default_template_path, dt->name);
+		if (ret >= sizeof(buf)) {
+			fprintf(stderr, "path too long\n");
+			return -1;
+		}
+
+		filename = buf;
+	} else {
+		fprintf(stderr, "Path not specified\n");
+		return -1;
+	}
+
+	g = usbg_get_gadget(backend_ctx.libusbg_state, dt->gadget);
+	if (!g) {
+		fprintf(stderr, "Error on get gadget\n");
+		return -1;
+	}
+
+	if (fp == NULL) {
+		if (!(dt->opts & GT_FORCE) && stat(filename, &st) == 0) {
+			fprintf(stderr, "File exists.\n");
+			return -1;
+		}
+
+		fp = fopen(filename, "w");
+		if (fp == NULL) {
+			perror("Error opening file\n");
+			return -1;
+		}
+	}
+
+	/* export through libconfig, so speed attributes are saved too */
+	ret = gt_scheme_export(g, &cfg);
+	if (ret < 0)
+		goto out;
+
+	config_write(&cfg, fp);
+	config_destroy(&cfg);
+out:
+	fclose(fp);
+	return ret;
+}
+
+static usbg_function *lookup_function(usbg_gadget *g, const char *type,
+		const char *instance)
+{
+	int t;
+
+	t = usbg_lookup_function_type(type);
+	if (t < 0)
+		return NULL;
+
+	return usbg_get_function(g, t, instance);
+}
+
+static int import_function(usbg_gadget *g, const struct gt_scheme_change *ch)
+{
+	usbg_function *f;
+	char *buf = NULL;
+	size_t size = 0;
+	config_t cfg;
+	FILE *fp;
+	int ret = USBG_ERROR_NO_MEM;
+
+	config_init(&cfg);
+	if (gt_scheme_copy(config_root_setting(&cfg), ch->new_val) < 0)
+		goto out;
+
+	fp = open_memstream(&buf, &size);
+	if (fp == NULL)
+		goto out;
+	config_write(&cfg, fp);
+	fclose(fp);
+
+	fp = fmemopen(buf, size, "r");
+	if (fp == NULL)
+		goto out;
+	ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+		       usbg_import_function, g, fp, ch->instance, &f);
+	fclose(fp);
+out:
+	free(buf);
+	config_destroy(&cfg);
+	return ret;
+}
+
+/**
+ * @brief Recreate function with new attributes
+ * @details Function attributes can't be set generically, so function is
+ * removed and imported again. Its bindings are restored afterwards.
+ */
+static int replace_function(usbg_gadget *g, const struct gt_scheme_change *ch)
+{
+	struct {
+		usbg_config *c;
+		char *name;
+	} *bindings = NULL, *tmp;
+	usbg_function *f;
+	usbg_binding *b;
+	usbg_config *c;
+	int count = 0;
+	int i;
+	int ret;
+
+	f = lookup_function(g, ch->func_type, ch->instance);
+	if (f == NULL)
+		return USBG_ERROR_NOT_FOUND;
+
+	usbg_for_each_config(c, g) {
+		usbg_for_each_binding(b, c) {
+			if (usbg_get_binding_target(b) != f)
+				continue;
+
+			tmp = realloc(bindings, (count + 1) * sizeof(*bindings));
+			if (tmp == NULL) {
+				ret = USBG_ERROR_NO_MEM;
+				goto out;
+			}
+			bindings = tmp;
+			bindings[count].c = c;
+			bindings[count].name = strdup(usbg_get_binding_name(b));
+			if (bindings[count++].name == NULL) {
+				ret = USBG_ERROR_NO_MEM;
+				goto out;
+			}
+		}
+	}
+
+	ret = GT_TRACE("usbg", usbg_get_function_instance(f),
+		       usbg_rm_function, f, USBG_RM_RECURSE);
+	if (ret != USBG_SUCCESS)
+		goto out;
+
+	ret = import_function(g, ch);
+	if (ret != USBG_SUCCESS)
+		goto out;
+
+	f = lookup_function(g, ch->func_type, ch->instance);
+	for (i = 0; i < count && ret == USBG_SUCCESS; i++)
+		ret = GT_TRACE("usbg", usbg_get_config_label(bindings[i].c),
+			       usbg_add_config_function, bindings[i].c,
+			       bindings[i].name, f);
+
+out:
+	for (i = 0; i < count; i++)
+		free(bindings[i].name);
+	free(bindings);
+	return ret;
+}
+
+static int setting_flag(const config_setting_t *s)
+{
+	if (config_setting_type(s) == CONFIG_TYPE_BOOL)
+		return config_setting_get_bool(s);
+	return config_setting_get_int(s) != 0;
+}
+
+/**
+ * @brief Change luns of mass storage function in place
+ * @details Used for changes accepted by gt_scheme_change_live(), so
+ * function keeps working while gadget stays bound. Kernel refuses to
+ * change ro while medium is loaded, so medium is ejected first then
+ * (writing empty line to file ejects it).
+ */
+static int update_function_luns(usbg_gadget *g,
+		const struct gt_scheme_change *ch)
+{
+	const config_setting_t *luns, *oluns, *l, *o, *file, *ofile, *ro, *nofua;
+	usbg_function *f;
+	usbg_f_ms *mf;
+	int reload;
+	int ret;
+	int i, n;
+
+	f = lookup_function(g, ch->func_type, ch->instance);
+	if (f == NULL)
+		return USBG_ERROR_NOT_FOUND;
+
+	mf = usbg_to_ms_function(f);
+	luns = config_setting_get_member(ch->new_val, "attrs");
+	luns = luns ? config_setting_get_member(luns, "luns") : NULL;
+	oluns = config_setting_get_member(ch->old_val, "attrs");
+	oluns = oluns ? config_setting_get_member(oluns, "luns") : NULL;
+	n = luns ? config_setting_length(luns) : 0;
+
+	for (i = 0; i < n; i++) {
+		l = config_setting_get_elem(luns, i);
+		o = config_setting_get_elem(oluns, i);
+		file = config_setting_get_member(l, "file");
+		ofile = config_setting_get_member(o, "file");
+		ro = config_setting_get_member(l, "ro");
+		nofua = config_setting_get_member(l, "nofua");
+
+		reload = file && (!ofile || !gt_scheme_setting_equal(file, ofile));
+		if (file == NULL)
+			file = ofile;
+
+		if (ro && !gt_scheme_setting_equal(ro,
+					config_setting_get_member(o, "ro"))) {
+			ret = GT_TRACE("usbg", usbg_get_function_instance(f),
+				       usbg_f_ms_set_lun_file, mf, i, "\n");
+			if (ret == USBG_SUCCESS)
+				ret = GT_TRACE("usbg",
+					usbg_get_function_instance(f),
+					usbg_f_ms_set_lun_ro, mf, i,
+					setting_flag(ro));
+			if (ret != USBG_SUCCESS)
+				return ret;
+			reload = file != NULL;
+		}
+
+		if (nofua && !gt_scheme_setting_equal(nofua,
+					config_setting_get_member(o, "nofua"))) {
+			ret = GT_TRACE("usbg", usbg_get_function_instance(f),
+				       usbg_f_ms_set_lun_nofua, mf, i,
+				       setting_flag(nofua));
+			if (ret != USBG_SUCCESS)
+				return ret;
+		}
+
+		if (reload) {
+			ret = GT_TRACE("usbg", usbg_get_function_instance(f),
+				       usbg_f_ms_set_lun_file, mf, i,
+				       config_setting_get_string(file));
+			if (ret != USBG_SUCCESS)
+				return ret;
+		}
+	}
+
+	return USBG_SUCCESS;
+}
+
+static int set_config_attr(usbg_config *c, const struct gt_scheme_change *ch)
+{
+	struct usbg_config_attrs attrs;
+	int val;
+	int ret;
+
+	ret = usbg_get_config_attrs(c, &attrs);
+	if (ret != USBG_SUCCESS)
+		return ret;
+
+	val = config_setting_get_int(ch->new_val);
+	if (streq(ch->name, "bmAttributes"))
+		attrs.bmAttributes = val;
+	else if (streq(ch->name, "bMaxPower"))
+		attrs.bMaxPower = val;
+	else
+		return USBG_ERROR_INVALID_PARAM;
+
+	return GT_TRACE("usbg", usbg_get_config_label(c),
+			usbg_set_config_attrs, c, &attrs);
+}
+
+static int apply_change(usbg_gadget *g, const struct gt_scheme_change *ch)
+{
+	char name[USBG_MAX_NAME_LENGTH];
+	usbg_function *f;
+	usbg_binding *b;
+	usbg_config *c = NULL;
+	int ret;
+	int i;
+
+	if (ch->label) {
+		c = usbg_get_config(g, ch->id, ch->label);
+		if (c == NULL && ch->type != GT_CHANGE_CONFIG_ADD)
+			return USBG_ERROR_NOT_FOUND;
+	}
+
+	switch (ch->type) {
+	case GT_CHANGE_ATTR:
+		ret = gt_gadget_lookup_speed_attr(ch->name);
+		if (ret >= 0) {
+			const char *val = config_setting_get_string(ch->new_val);
+
+			if (val == NULL || !gt_gadget_speed_attr_valid(ret, val))
+				return USBG_ERROR_INVALID_PARAM;
+			return gt_gadget_set_speed_attr(usbg_get_gadget_name(g),
+					ret, val) == 0 ? USBG_SUCCESS
+					: USBG_ERROR_OTHER_ERROR;
+		}
+
+		ret = usbg_lookup_gadget_attr(ch->name);
+		if (ret < 0)
+			return USBG_ERROR_INVALID_PARAM;
+		return GT_TRACE("usbg", usbg_get_gadget_name(g),
+				usbg_set_gadget_attr, g, ret,
+				config_setting_get_int(ch->new_val));
+	case GT_CHANGE_STRING:
+		if (config_setting_type(ch->new_val) != CONFIG_TYPE_STRING)
+			return USBG_ERROR_INVALID_TYPE;
+		for (i = 0; i < GT_GADGET_STRS_COUNT; i++)
+			if (streq(gadget_strs[i].name, ch->name))
+				return gadget_strs[i].set_fn(g, ch->lang,
+					config_setting_get_string(ch->new_val));
+		return USBG_ERROR_INVALID_PARAM;
+	case GT_CHANGE_FUNC_ADD:
+		return import_function(g, ch);
+	case GT_CHANGE_FUNC_RM:
+		f = lookup_function(g, ch->func_type, ch->instance);
+		if (f == NULL)
+			return USBG_ERROR_NOT_FOUND;
+		return GT_TRACE("usbg", usbg_get_function_instance(f),
+				usbg_rm_function, f, USBG_RM_RECURSE);
+	case GT_CHANGE_FUNC_ATTRS:
+		if (gt_scheme_change_live(ch))
+			return update_function_luns(g, ch);
+		return replace_function(g, ch);
+	case GT_CHANGE_CONFIG_ADD:
+		return GT_TRACE("usbg", usbg_get_gadget_name(g),
+				usbg_create_config, g, ch->id, ch->label,
+				NULL, NULL, &c);
+	case GT_CHANGE_CONFIG_RM:
+		return GT_TRACE("usbg", usbg_get_config_label(c),
+				usbg_rm_config, c, USBG_RM_RECURSE);
+	case GT_CHANGE_CONFIG_ATTR:
+		return set_config_attr(c, ch);
+	case GT_CHANGE_CONFIG_STRING:
+		if (!streq(ch->name, "configuration"))
+			return USBG_ERROR_INVALID_PARAM;
+		if (config_setting_type(ch->new_val) != CONFIG_TYPE_STRING)
+			return USBG_ERROR_INVALID_TYPE;
+		return GT_TRACE("usbg", usbg_get_config_label(c),
+				usbg_set_config_string, c, ch->lang,
+				config_setting_get_string(ch->new_val));
+	case GT_CHANGE_BINDING_ADD:
+		f = lookup_function(g, ch->func_type, ch->instance);
+		if (f == NULL)
+			return USBG_ERROR_NOT_FOUND;
+		if (ch->name == NULL) {
+			ret = snprintf(name, sizeof(name), "%s.%s",
+				       ch->func_type, ch->instance);
+			if (ret >= sizeof(name))
+				return USBG_ERROR_PATH_TOO_LONG;
+		}
+		return GT_TRACE("usbg", usbg_get_config_label(c),
+				usbg_add_config_function, c,
+				ch->name ? ch->name : name, f);
+	case GT_CHANGE_BINDING_RM:
+		usbg_for_each_binding(b, c)
+			if (streq(usbg_get_binding_name(b), ch->name))
+				return GT_TRACE("usbg", usbg_get_binding_name(b),
+						usbg_rm_binding, b);
+		return USBG_ERROR_NOT_FOUND;
+	}
+
+	return USBG_ERROR_INVALID_PARAM;
+}
+
+/* Removals go first, so that recreated objects don't collide */
+static const enum gt_scheme_change_type apply_order[] = {
+	GT_CHANGE_BINDING_RM,
+	GT_CHANGE_CONFIG_RM,
+	GT_CHANGE_FUNC_RM,
+	GT_CHANGE_FUNC_ATTRS,
+	GT_CHANGE_FUNC_ADD,
+	GT_CHANGE_ATTR,
+	GT_CHANGE_STRING,
+	GT_CHANGE_CONFIG_ADD,
+	GT_CHANGE_CONFIG_ATTR,
+	GT_CHANGE_CONFIG_STRING,
+	GT_CHANGE_BINDING_ADD,
+};
+
+static int apply_func(void *data)
+{
+	int types[USBG_FUNCTION_TYPE_MAX] = {0};
+	struct gt_gadget_apply_data *dt;
+	struct gt_scheme_diff diff;
+	config_t scheme, live;
+	usbg_gadget *g;
+	usbg_udc *udc;
+	FILE *fp;
+	int usbg_ret;
+	int unbind = 0;
+	int i, j;
+	int ret;
+
+	dt = (struct gt_gadget_apply_data *)data;
+
+	fp = fopen(dt->file, "r");
+	if (fp == NULL) {
+		perror("Error opening file");
+		return -1;
+	}
+
+	g = usbg_get_gadget(backend_ctx.libusbg_state, dt->gadget);
+	if (g == NULL) {
+		/* Nothing to reconcile with, create gadget from scratch */
+		struct gt_gadget_load_data load = {
+			.gadget_name = dt->gadget,
+			.opts = dt->opts,
+		};
+
+		char *buf;
+		size_t size;
+
+		buf = read_stream(fp, &size);
+		fclose(fp);
+		if (buf == NULL || size == 0) {
+			fprintf(stderr, "Error reading gadget file\n");
+			free(buf);
+			return -1;
+		}
+
+		ret = import_gadget(buf, size, &load, &g);
+		free(buf);
+		return ret;
+	}
+
+	ret = gt_scheme_read(fp, dt->file, &scheme);
+	fclose(fp);
+	if (ret < 0)
+		return -1;
+
+	ret = gt_scheme_export(g, &live);
+	if (ret < 0)
+		goto out_scheme;
+
+	ret = gt_scheme_diff(config_root_setting(&live),
+			     config_root_setting(&scheme), &diff);
+	if (ret < 0)
+		goto out_live;
+
+	if (diff.count == 0)
+		goto out_diff;
+
+	/* load modules of new functions while gadget is still enabled */
+	for (j = 0; j < diff.count; j++) {
+		if (diff.changes[j].type != GT_CHANGE_FUNC_ADD)
+			continue;
+
+		i = usbg_lookup_function_type(diff.changes[j].func_type);
+		if (i >= 0)
+			types[i] = 1;
+	}
+	gt_func_preload(types, GT_QUIET);
+
+	/* host is disconnected only for changes visible in descriptors */
+	for (j = 0; j < diff.count; j++)
+		if (!gt_scheme_change_live(&diff.changes[j]))
+			unbind = 1;
+
+	udc = unbind ? usbg_get_gadget_udc(g) : NULL;
+	if (udc) {
+		ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+			       usbg_disable_gadget, g);
+		if (ret != USBG_SUCCESS) {
+			fprintf(stderr, "Error on disable gadget\n");
+			fprintf(stderr, "Error: %s : %s\n", usbg_error_name(ret),
+					usbg_strerror(ret));
+			goto out_diff;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(apply_order); i++) {
+		for (j = 0; j < diff.count; j++) {
+			if (diff.changes[j].type != apply_order[i])
+				continue;
+
+			if (dt->opts & GT_VERBOSE)
+				gt_scheme_change_print(stdout, &diff.changes[j]);
+
+			ret = apply_change(g, &diff.changes[j]);
+			if (ret != USBG_SUCCESS) {
+				fprintf(stderr, "Error on applying change:\n");
+				gt_scheme_change_print(stderr, &diff.changes[j]);
+				fprintf(stderr, "Error: %s : %s\n",
+					usbg_error_name(ret), usbg_strerror(ret));
+				goto out_enable;
+			}
+		}
+	}
+
+out_enable:
+	/* even half-applied gadget is better than one detached from host */
+	if (udc && !(dt->opts & GT_OFF)) {
+		usbg_ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+				    usbg_enable_gadget, g, udc);
+		if (usbg_ret != USBG_SUCCESS) {
+			fprintf(stderr, "Failed to enable gadget %s\n",
+				usbg_strerror(usbg_ret));
+			if (ret == USBG_SUCCESS)
+				ret = usbg_ret;
+		}
+	}
+
+out_diff:
+	gt_scheme_diff_free(&diff);
+out_live:
+	config_destroy(&live);
+out_scheme:
+	config_destroy(&scheme);
+	return ret;
+}
+
+static int line_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/**
+ * @brief Print differences sorted, so that output doesn't depend on
+ * order of objects in configfs
+ */
+static int print_diff(const struct gt_scheme_diff *diff)
+{
+	char *buf = NULL;
+	char **lines;
+	size_t size = 0;
+	char *ptr;
+	FILE *fp;
+	int i, n = 0;
+
+	fp = open_memstream(&buf, &size);
+	if (fp == NULL)
+		return -1;
+
+	for (i = 0; i < diff->count; i++)
+		gt_scheme_change_print(fp, &diff->changes[i]);
+	fclose(fp);
+
+	for (ptr = buf; *ptr; ptr++)
+		if (*ptr == '\n')
+			n++;
+
+	lines = calloc(n + 1, sizeof(*lines));
+	if (lines == NULL) {
+		free(buf);
+		return -1;
+	}
+
+	for (i = 0, ptr = buf; i < n; i++) {
+		lines[i] = ptr;
+		ptr = strchr(ptr, '\n');
+		*ptr++ = '\0';
+	}
+
+	qsort(lines, n, sizeof(*lines), line_cmp);
+	for (i = 0; i < n; i++)
+		puts(lines[i]);
+
+	free(lines);
+	free(buf);
+	return 0;
+}
+
+static int diff_func(void *data)
+{
+	struct gt_gadget_diff_data *dt;
+	struct gt_scheme_diff diff;
+	config_t old, new;
+	usbg_gadget *g;
+	FILE *fp;
+	int ret;
+
+	dt = (struct gt_gadget_diff_data *)data;
+
+	g = usbg_get_gadget(backend_ctx.libusbg_state, dt->gadget);
+	if (g == NULL) {
+		fprintf(stderr, "Error on get gadget\n");
+		return -1;
+	}
+
+	if (gt_scheme_export(g, &old) < 0)
+		return -1;
+
+	g = usbg_get_gadget(backend_ctx.libusbg_state, dt->other);
+	if (g) {
+		ret = gt_scheme_export(g, &new);
+	} else {
+		fp = fopen(dt->other, "r");
+		if (fp == NULL) {
+			perror("Error opening file");
+			ret = -1;
+			goto out_old;
+		}
+
+		ret = gt_scheme_read(fp, dt->other, &new);
+		fclose(fp);
+	}
+
+	if (ret < 0)
+		goto out_old;
+
+	ret = gt_scheme_diff(config_root_setting(&old),
+			     config_root_setting(&new), &diff);
+	if (ret < 0)
+		goto out_new;
+
+	if (!(dt->opts & GT_QUIET) && print_diff(&diff) < 0)
+		ret = -1;
+	else
+		ret = diff.count ? 1 : 0;
+
+	gt_scheme_diff_free(&diff);
+out_new:
+	config_destroy(&new);
+out_old:
+	config_destroy(&old);
+	return ret;
+}
+
+static int set_func(void *data)
+{
+	struct gt_gadget_set_data *dt;
+	int i;
+	usbg_gadget *g;
+	int ret;
+
+	dt = (struct gt_gadget_set_data *)data;
+
+	g = usbg_get_gadget(backend_ctx.libusbg_state, dt->name);
+	if (!g) {
+		fprintf(stderr, "Error on get gadget\n");
+		return -1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(dt->attr_val); ++i) {
+		if (dt->attr_val[i] < 0)
+			continue;
+
+		ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+			       usbg_set_gadget_attr, g, i, dt->attr_val[i]);
+		if (ret != USBG_SUCCESS) {
+			fprintf(stderr, "Unable to set attribute %s: %s\n",
+				usbg_get_gadget_attr_str(i),
+				usbg_strerror(ret));
+			return -1;
+		}
+	}
+
+	for (i = 0; i < G_N_ELEMENTS(dt->str_val); i++) {
+		if (dt->str_val[i] == NULL)
+			continue;
+
+		ret = gadget_strs[i].set_fn(g, LANG_US_ENG, dt->str_val[i]);
+		if (ret != USBG_SUCCESS) {
+			fprintf(stderr, "Unable to set string %s: %s\n",
+				gadget_strs[i].name,
 				usbg_strerror(ret));
 			return -1;
 		}
 	}
 
+	for (i = 0; i < GT_GADGET_SPEED_ATTR_MAX; i++) {
+		if (dt->speed_val[i] != NULL
+		    && gt_gadget_set_speed_attr(dt->name, i,
+						dt->speed_val[i]) < 0)
+			return -1;
+	}
+
 	return 0;
 }
 
-int template_filter(const struct dirent *entry)
+static void print_template(const char *dir,
+		const struct gt_template_entry *e, int opts)
 {
-	if (entry->d_name[0] == '.')
-		return 0;
+	printf("%s\n", e->name);
+	if (opts & GT_VERBOSE) {
+		printf("  path\t\t%s/%s\n", dir, e->name);
+		printf("  size\t\t%lld\n", (long long)e->size);
+		if (e->hash == GT_TEMPLATE_HASH_UNKNOWN)
+			printf("  fingerprint\tunknown\n");
+		else
+			printf("  fingerprint\t%016" PRIx64 "\n", e->hash);
+	}
+}
+
+/**
+ * @brief Show template which would be used by load
+ * @details Found the same way as by load, index only provides fingerprint
+ * if its entry matches the file.
+ */
+static int show_template(const char *name, int opts)
+{
+	const struct gt_template_entry *e;
+	struct gt_template_entry entry;
+	struct gt_template_index idx;
+	char path[PATH_MAX];
+	struct stat st;
+	char *dir;
+
+	if (gt_gadget_find_template(name, path, sizeof(path)) <= 0
+	    || stat(path, &st) < 0) {
+		fprintf(stderr, "Template %s not found\n", name);
+		return -1;
+	}
+
+	dir = strndup(path, strlen(path) - strlen(name) - 1);
+	if (dir == NULL)
+		return -1;
+
+	entry.name = (char *)name;
+	entry.size = st.st_size;
+	entry.mtime = st.st_mtime;
+	entry.hash = GT_TEMPLATE_HASH_UNKNOWN;
+
+	if (opts & GT_VERBOSE && gt_template_index_get(dir, &idx, 1) == 0) {
+		e = gt_template_index_find(&idx, name);
+		if (e && e->size == entry.size && e->mtime == entry.mtime)
+			entry.hash = e->hash;
+		gt_template_index_free(&idx);
+	}
 
-	return 1;
+	print_template(dir, &entry, opts);
+	free(dir);
+	return 0;
 }
 
 static int template_func(void *data)
 {
 	struct gt_gadget_template_data *dt;
-	struct dirent **dentry;
-	char buf[PATH_MAX];
-	int ret;
+	struct gt_template_index idx;
 	const char **ptr;
+	int i;
 
 	dt = (struct gt_gadget_template_data *)data;
 
-	if (gt_settings.lookup_path != NULL) {
-		ptr = gt_settings.lookup_path;
-		while (*ptr) {
-			ret = snprintf(buf, sizeof(buf), "%s/%s", *ptr, dt->name);
-			if (ret >= sizeof(buf)) {
-				fprintf(stderr, "path too long\n");
-				return -1;
-			}
+	if (dt->name)
+		return show_template(dt->name, dt->opts);
 
-			ret = scandir(*ptr, &dentry, template_filter, alphasort);
-			if (ret < 0) {
-				perror("Error reading directory");
-				return -1;
-			}
+	if (gt_settings.lookup_path == NULL)
+		return 0;
 
-			while (ret--) {
-				printf("%s\n", dentry[ret]->d_name);
-				free(dentry[ret]);
-			}
+	for (ptr = gt_settings.lookup_path; *ptr; ptr++) {
+		if (gt_template_index_get(*ptr, &idx,
+					  dt->opts & GT_VERBOSE) < 0) {
+			perror("Error reading directory");
+			return -1;
+		}
+
+		for (i = 0; i < idx.count; i++)
+			print_template(*ptr, &idx.entries[i], dt->opts);
+
+		gt_template_index_free(&idx);
+	}
+
+	return 0;
+}
+
+static int template_reindex_func(void *data)
+{
+	struct gt_template_index idx;
+	const char **ptr;
+	int ret = 0;
+
+	if (gt_settings.lookup_path == NULL) {
+		fprintf(stderr, "No lookup path set\n");
+		return -1;
+	}
+
+	for (ptr = gt_settings.lookup_path; *ptr; ptr++) {
+		if (gt_template_index_rebuild(*ptr, &idx) < 0) {
+			fprintf(stderr, "Failed to index %s\n", *ptr);
+			ret = -1;
+			continue;
+		}
+
+		printf("%s: %d templates\n", *ptr, idx.count);
+		gt_template_index_free(&idx);
+	}
+
+	return ret;
+}
+
+static int compile_func(void *data)
+{
+	struct gt_gadget_compile_data *dt;
+	char buf[PATH_MAX];
+	const char *output;
+	int ret;
+
+	dt = (struct gt_gadget_compile_data *)data;
+
+	output = dt->output;
+	if (output == NULL) {
+		ret = snprintf(buf, sizeof(buf), "%s.gtb", dt->file);
+		if (ret >= sizeof(buf)) {
+			fprintf(stderr, "path too long\n");
+			return -1;
+		}
+		output = buf;
+	}
+
+	return gt_binary_compile(dt->file, output);
+}
+
+static int pool_prepare_func(void *data)
+{
+	struct gt_gadget_pool_prepare_data *dt;
+	struct gt_gadget_load_data load;
+	struct gt_setting *persona;
+	int ret = 0;
+
+	dt = (struct gt_gadget_pool_prepare_data *)data;
+
+	for (persona = dt->personas; persona->variable; persona++) {
+		/* gadget which still matches its scheme is kept as it is */
+		load = (struct gt_gadget_load_data) {
+			.name = persona->value,
+			.gadget_name = persona->variable,
+			.path = dt->path,
+			.opts = GT_OFF | GT_IF_CHANGED,
+		};
+
+		if (load_func(&load) != USBG_SUCCESS) {
+			fprintf(stderr, "Unable to prepare %s\n",
+				persona->variable);
+			ret = -1;
+		}
+	}
 
-			free(dentry);
+	return ret;
+}
+
+static int switch_func(void *data)
+{
+	struct gt_gadget_switch_data *dt;
+	struct timespec start, bind, end;
+	usbg_gadget *g, *from;
+	usbg_udc *u, *bound;
+	int ret = -1;
+
+	dt = (struct gt_gadget_switch_data *)data;
+
+	u = usbg_get_udc(backend_ctx.libusbg_state, dt->udc);
+	if (u == NULL) {
+		fprintf(stderr, "Failed to get udc\n");
+		return -1;
+	}
+
+	g = usbg_get_gadget(backend_ctx.libusbg_state, dt->to);
+	if (g == NULL) {
+		fprintf(stderr, "Failed to get gadget %s\n", dt->to);
+		return -1;
+	}
+
+	from = usbg_get_udc_gadget(u);
+	if (dt->from && (from == NULL
+			 || !streq(usbg_get_gadget_name(from), dt->from))) {
+		fprintf(stderr, "Gadget %s is not bound to %s\n", dt->from,
+			dt->udc);
+		return -1;
+	}
+
+	bound = usbg_get_gadget_udc(g);
+	if (bound && bound != u) {
+		fprintf(stderr, "Gadget %s is bound to %s\n", dt->to,
+			usbg_get_udc_name(bound));
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	bind = start;
+	if (from == g)
+		goto done;
+
+	/* host sees single disconnect instead of gadget going away */
+	if (dt->soft_connect && from && gt_udc_soft_connect(dt->udc, 0) < 0)
+		return -1;
 
-			ptr++;
+	if (from) {
+		ret = GT_TRACE("usbg", usbg_get_gadget_name(from),
+			       usbg_disable_gadget, from);
+		if (ret != USBG_SUCCESS) {
+			fprintf(stderr, "Error on disable gadget: %s\n",
+				usbg_strerror(ret));
+			goto reconnect;
 		}
 	}
 
+	clock_gettime(CLOCK_MONOTONIC, &bind);
+	ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+		       usbg_enable_gadget, g, u);
+	if (ret != USBG_SUCCESS) {
+		fprintf(stderr, "Failed to enable gadget %s\n",
+			usbg_strerror(ret));
+		/* don't leave udc without gadget */
+		if (from)
+			GT_TRACE("usbg", usbg_get_gadget_name(from),
+				 usbg_enable_gadget, from, u);
+		goto reconnect;
+	}
+
+	/* binding connects on its own, unless udc has been disconnected */
+	if (dt->soft_connect && from && gt_udc_soft_connect(dt->udc, 1) < 0)
+		return -1;
+
+done:
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	gt_gadget_switch_report(dt->udc,
+			from ? usbg_get_gadget_name(from) : NULL,
+			dt->to, &start, &end);
+
+	if (dt->wait)
+		return gt_gadget_wait_udc(dt->to, dt->udc, dt->wait,
+					  dt->timeout, &bind);
+
 	return 0;
+
+reconnect:
+	if (dt->soft_connect && from)
+		gt_udc_soft_connect(dt->udc, 1);
+	return -1;
 }
 
 struct gt_gadget_backend gt_gadget_backend_libusbg = {
@@ -634,8 +2043,15 @@ struct gt_gadget_backend gt_gadget_backend_libusbg = {
 	.gadget = gadget_func,
 	.load = load_func,
 	.save = save_func,
+	.apply = apply_func,
+	.diff = diff_func,
+	.compile = compile_func,
+	.replay = replay_func,
 	.template_default = template_func,
 	.template_get = NULL,
 	.template_set = NULL,
 	.template_rm = NULL,
+	.template_reindex = template_reindex_func,
+	.pool_prepare = pool_prepare_func,
+	.switch_udc = switch_func,
 };
@@ -46,6 +46,13 @@ static int create_func(void *data)
 		}
 	}
 
+	for (i = 0; i < ARRAY_SIZE(dt->speed_val); ++i) {
+		if (dt->speed_val[i] != NULL) {
+			printf(", %s = %s", gadget_speed_attrs[i],
+					dt->speed_val[i]);
+		}
+	}
+
 	putchar('\n');
 
 	return 0;
@@ -74,6 +81,9 @@ static int get_func(void *data)
 	for (i = 0; i < ARRAY_SIZE(dt->attrs); ++i)
 		if (dt->attrs[i] > 0)
 			printf("%s, ", usbg_get_gadget_attr_str(i));
+	for (i = 0; i < ARRAY_SIZE(dt->speed_attrs); ++i)
+		if (dt->speed_attrs[i] > 0)
+			printf("%s, ", gadget_speed_attrs[i]);
 
 	putchar('\n');
 	return 0;
@@ -102,6 +112,13 @@ static int set_func(void *data)
 		}
 	}
 
+	for (i = 0; i < ARRAY_SIZE(dt->speed_val); ++i) {
+		if (dt->speed_val[i] != NULL) {
+			printf(", %s = %s", gadget_speed_attrs[i],
+					dt->speed_val[i]);
+		}
+	}
+
 	putchar('\n');
 	return 0;
 }
@@ -118,6 +135,20 @@ static int enable_func(void *data) {
 	if (dt->udc)
 		printf("udc = %s", dt->udc);
 
+	if (dt->wait)
+		printf(", wait = %s", dt->wait);
+
+	if (dt->ffs_mount)
+		printf(", ffs_mount = %s", dt->ffs_mount);
+	else if (dt->ffs_wait)
+		printf(", ffs_wait = 1");
+
+	if (dt->wait || dt->ffs_wait)
+		printf(", timeout = %d", dt->timeout);
+
+	if (dt->disconnected)
+		printf(", disconnected = 1");
+
 	putchar('\n');
 	return 0;
 }
@@ -163,9 +194,99 @@ static int load_func(void *data)
 		printf("file %s, ", dt->file);
 	if (dt->path)
 		printf("path = %s, ", dt->path);
+	if (dt->record)
+		printf("record = %s, ", dt->record);
 
-	printf("off = %d, stdin = %d\n",
-		!!(dt->opts & GT_OFF), !!(dt->opts & GT_STDIN));
+	printf("off = %d, stdin = %d, if_changed = %d\n",
+		!!(dt->opts & GT_OFF), !!(dt->opts & GT_STDIN),
+		!!(dt->opts & GT_IF_CHANGED));
+
+	return 0;
+}
+
+static int apply_func(void *data)
+{
+	struct gt_gadget_apply_data *dt;
+
+	dt = (struct gt_gadget_apply_data *)data;
+	printf("Gadget apply called successfully. Not implemented.\n");
+	printf("file = %s, gadget = %s, off = %d, verbose = %d\n",
+		dt->file, dt->gadget, !!(dt->opts & GT_OFF),
+		!!(dt->opts & GT_VERBOSE));
+
+	return 0;
+}
+
+static int diff_func(void *data)
+{
+	struct gt_gadget_diff_data *dt;
+
+	dt = (struct gt_gadget_diff_data *)data;
+	printf("Gadget diff called successfully. Not implemented.\n");
+	printf("gadget = %s, other = %s, quiet = %d\n",
+		dt->gadget, dt->other, !!(dt->opts & GT_QUIET));
+
+	return 0;
+}
+
+static int compile_func(void *data)
+{
+	struct gt_gadget_compile_data *dt;
+
+	dt = (struct gt_gadget_compile_data *)data;
+	printf("Gadget compile called successfully. Not implemented.\n");
+	printf("file = %s", dt->file);
+	if (dt->output)
+		printf(", output = %s", dt->output);
+	putchar('\n');
+
+	return 0;
+}
+
+static int replay_func(void *data)
+{
+	struct gt_gadget_replay_data *dt;
+
+	dt = (struct gt_gadget_replay_data *)data;
+	printf("Gadget replay called successfully. Not implemented.\n");
+	printf("file = %s, ", dt->file);
+	if (dt->gadget)
+		printf("gadget = %s, ", dt->gadget);
+	printf("off = %d\n", !!(dt->opts & GT_OFF));
+
+	return 0;
+}
+
+static int pool_prepare_func(void *data)
+{
+	struct gt_gadget_pool_prepare_data *dt;
+	struct gt_setting *persona;
+
+	dt = (struct gt_gadget_pool_prepare_data *)data;
+	printf("Gadget pool prepare called successfully. Not implemented.\n");
+	if (dt->path)
+		printf("path = %s, ", dt->path);
+	printf("personas =");
+	for (persona = dt->personas; persona->variable; persona++)
+		printf(" %s = %s,", persona->variable, persona->value);
+	putchar('\n');
+
+	return 0;
+}
+
+static int switch_func(void *data)
+{
+	struct gt_gadget_switch_data *dt;
+
+	dt = (struct gt_gadget_switch_data *)data;
+	printf("Gadget switch called successfully. Not implemented.\n");
+	printf("udc = %s, ", dt->udc);
+	if (dt->from)
+		printf("from = %s, ", dt->from);
+	printf("to = %s, soft_connect = %d", dt->to, dt->soft_connect);
+	if (dt->wait)
+		printf(", wait = %s, timeout = %d", dt->wait, dt->timeout);
+	putchar('\n');
 
 	return 0;
 }
@@ -257,6 +378,13 @@ static int template_get_func(void *data)
 	return 0;
 }
 
+static int template_reindex_func(void *data)
+{
+	printf("Gadget template reindex called successfully. Not implemented.\n");
+	putchar('\n');
+	return 0;
+}
+
 
 struct gt_gadget_backend gt_gadget_backend_not_implemented = {
 	.create = create_func,
@@ -268,8 +396,15 @@ struct gt_gadget_backend gt_gadget_backend_not_implemented = {
 	.gadget = gadget_func,
 	.load = load_func,
 	.save = save_func,
+	.apply = apply_func,
+	.diff = diff_func,
+	.compile = compile_func,
+	.replay = replay_func,
 	.template_default = template_func,
 	.template_rm = template_rm_func,
+	.template_reindex = template_reindex_func,
 	.template_set = template_set_func,
 	.template_get = template_get_func,
+	.pool_prepare = pool_prepare_func,
+	.switch_udc = switch_func,
 };
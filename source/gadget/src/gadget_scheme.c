@@ -0,0 +1,899 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "gadget_scheme.h"
+#include "gadget.h"
+#include "common.h"
+#include "trace.h"
+
+/* label used by libusbgx when scheme doesn't name configuration */
+#define GT_SCHEME_CONFIG_LABEL "config"
+
+static const char *ignored_attrs[] = {
+	"ifname",
+	"port_num",
+	NULL
+};
+
+/* lun attributes kernel lets change while gadget is bound */
+static const char *live_lun_attrs[] = {
+	"file",
+	"ro",
+	"nofua",
+	NULL
+};
+
+int gt_scheme_attr_ignored(const char *name)
+{
+	const char **ptr;
+
+	for (ptr = ignored_attrs; *ptr; ptr++)
+		if (streq(*ptr, name))
+			return 1;
+
+	return 0;
+}
+
+int gt_scheme_read(FILE *fp, const char *name, config_t *cfg)
+{
+	config_init(cfg);
+	if (GT_TRACE("libconfig", name, config_read, cfg, fp) != CONFIG_TRUE) {
+		fprintf(stderr, "%s:%d: %s\n", name, config_error_line(cfg),
+			config_error_text(cfg));
+		config_destroy(cfg);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Add speed attributes of gadget, which libusbg doesn't export
+ */
+static int export_speed_attrs(const char *gadget, config_t *cfg)
+{
+	config_setting_t *attrs, *s;
+	char val[32];
+	int i;
+
+	attrs = config_setting_get_member(config_root_setting(cfg), "attrs");
+	if (attrs == NULL)
+		return 0;
+
+	for (i = 0; i < GT_GADGET_SPEED_ATTR_MAX; i++) {
+		if (gt_gadget_get_speed_attr(gadget, i, val, sizeof(val)) < 0)
+			continue;
+
+		s = config_setting_add(attrs, gadget_speed_attrs[i],
+				       CONFIG_TYPE_STRING);
+		if (s == NULL || config_setting_set_string(s, val) != CONFIG_TRUE)
+			return -1;
+	}
+
+	return 0;
+}
+
+int gt_scheme_export(usbg_gadget *g, config_t *cfg)
+{
+	char *buf = NULL;
+	size_t size = 0;
+	FILE *fp;
+	int ret;
+
+	fp = open_memstream(&buf, &size);
+	if (fp == NULL)
+		return -1;
+
+	ret = GT_TRACE("usbg", usbg_get_gadget_name(g),
+		       usbg_export_gadget, g, fp);
+	fclose(fp);
+	if (ret != USBG_SUCCESS) {
+		fprintf(stderr, "Error on export gadget\n");
+		fprintf(stderr, "Error: %s : %s\n", usbg_error_name(ret),
+				usbg_strerror(ret));
+		free(buf);
+		return -1;
+	}
+
+	fp = fmemopen(buf, size, "r");
+	if (fp == NULL) {
+		free(buf);
+		return -1;
+	}
+
+	ret = gt_scheme_read(fp, usbg_get_gadget_name(g), cfg);
+	fclose(fp);
+	free(buf);
+	if (ret < 0)
+		return ret;
+
+	ret = export_speed_attrs(usbg_get_gadget_name(g), cfg);
+	if (ret < 0)
+		config_destroy(cfg);
+
+	return ret;
+}
+
+static int is_int_type(int type)
+{
+	return type == CONFIG_TYPE_INT || type == CONFIG_TYPE_INT64;
+}
+
+/**
+ * @brief Compare values of settings
+ * @details Group members present only on one side are not compared,
+ * because schemes don't need to specify all attributes.
+ * @return 1 if equal, 0 otherwise
+ */
+static int setting_equal(const config_setting_t *a, const config_setting_t *b)
+{
+	const config_setting_t *m, *o;
+	const char *name;
+	int ta, tb;
+	int i, n;
+
+	ta = config_setting_type(a);
+	tb = config_setting_type(b);
+
+	if (is_int_type(ta) && is_int_type(tb))
+		return config_setting_get_int64(a) == config_setting_get_int64(b);
+
+	if (ta != tb)
+		return 0;
+
+	switch (ta) {
+	case CONFIG_TYPE_STRING:
+		return streq(config_setting_get_string(a),
+			     config_setting_get_string(b));
+	case CONFIG_TYPE_BOOL:
+		return !config_setting_get_bool(a) == !config_setting_get_bool(b);
+	case CONFIG_TYPE_FLOAT:
+		return config_setting_get_float(a) == config_setting_get_float(b);
+	case CONFIG_TYPE_GROUP:
+		n = config_setting_length(a);
+		for (i = 0; i < n; i++) {
+			m = config_setting_get_elem(a, i);
+			name = config_setting_name(m);
+			if (gt_scheme_attr_ignored(name))
+				continue;
+			o = config_setting_get_member(b, name);
+			if (o && !setting_equal(m, o))
+				return 0;
+		}
+		return 1;
+	case CONFIG_TYPE_LIST:
+	case CONFIG_TYPE_ARRAY:
+		n = config_setting_length(a);
+		if (n != config_setting_length(b))
+			return 0;
+		for (i = 0; i < n; i++)
+			if (!setting_equal(config_setting_get_elem(a, i),
+					   config_setting_get_elem(b, i)))
+				return 0;
+		return 1;
+	}
+
+	return 0;
+}
+
+static const config_setting_t *get_member(const config_setting_t *s,
+		const char *name)
+{
+	return s ? config_setting_get_member(s, name) : NULL;
+}
+
+static int get_length(const config_setting_t *s)
+{
+	return s ? config_setting_length(s) : 0;
+}
+
+static struct gt_scheme_change *diff_add(struct gt_scheme_diff *diff,
+		const struct gt_scheme_change *tmpl, enum gt_scheme_change_type type)
+{
+	struct gt_scheme_change *ch;
+
+	if (diff->count == diff->size) {
+		int size = diff->size ? diff->size * 2 : 16;
+
+		ch = realloc(diff->changes, size * sizeof(*ch));
+		if (ch == NULL)
+			return NULL;
+		diff->changes = ch;
+		diff->size = size;
+	}
+
+	ch = &diff->changes[diff->count++];
+	if (tmpl)
+		*ch = *tmpl;
+	else
+		memset(ch, 0, sizeof(*ch));
+	ch->type = type;
+
+	return ch;
+}
+
+static int diff_attrs(struct gt_scheme_diff *diff,
+		const struct gt_scheme_change *tmpl, enum gt_scheme_change_type type,
+		const config_setting_t *old, const config_setting_t *new)
+{
+	struct gt_scheme_change *ch;
+	const config_setting_t *m, *o;
+	int i, n;
+
+	n = get_length(new);
+	for (i = 0; i < n; i++) {
+		m = config_setting_get_elem(new, i);
+		o = get_member(old, config_setting_name(m));
+		if (o && setting_equal(m, o))
+			continue;
+
+		ch = diff_add(diff, tmpl, type);
+		if (ch == NULL)
+			return -1;
+		ch->name = config_setting_name(m);
+		ch->old_val = o;
+		ch->new_val = m;
+	}
+
+	return 0;
+}
+
+static const config_setting_t *find_strings(const config_setting_t *list,
+		int lang)
+{
+	const config_setting_t *s;
+	int i, n, l;
+
+	n = get_length(list);
+	for (i = 0; i < n; i++) {
+		s = config_setting_get_elem(list, i);
+		if (config_setting_lookup_int(s, "lang", &l) == CONFIG_TRUE
+		    && l == lang)
+			return s;
+	}
+
+	return NULL;
+}
+
+static int diff_strings(struct gt_scheme_diff *diff,
+		const struct gt_scheme_change *tmpl, enum gt_scheme_change_type type,
+		const config_setting_t *old, const config_setting_t *new)
+{
+	struct gt_scheme_change *ch;
+	const config_setting_t *s, *o, *m, *om;
+	int i, j, n, lang;
+
+	n = get_length(new);
+	for (i = 0; i < n; i++) {
+		s = config_setting_get_elem(new, i);
+		if (config_setting_lookup_int(s, "lang", &lang) != CONFIG_TRUE)
+			continue;
+
+		o = find_strings(old, lang);
+		for (j = 0; j < config_setting_length(s); j++) {
+			m = config_setting_get_elem(s, j);
+			if (streq(config_setting_name(m), "lang"))
+				continue;
+
+			om = get_member(o, config_setting_name(m));
+			if (om && setting_equal(m, om))
+				continue;
+
+			ch = diff_add(diff, tmpl, type);
+			if (ch == NULL)
+				return -1;
+			ch->name = config_setting_name(m);
+			ch->lang = lang;
+			ch->old_val = om;
+			ch->new_val = m;
+		}
+	}
+
+	return 0;
+}
+
+int gt_scheme_function_key(const config_setting_t *f, const char **type,
+		const char **instance)
+{
+	if (config_setting_lookup_string(f, "type", type) != CONFIG_TRUE)
+		return -1;
+
+	if (config_setting_lookup_string(f, "instance", instance) != CONFIG_TRUE) {
+		*instance = config_setting_name(f);
+		if (*instance == NULL)
+			return -1;
+	}
+
+	return 0;
+}
+
+static const config_setting_t *find_function(const config_setting_t *funcs,
+		const char *type, const char *instance)
+{
+	const config_setting_t *f;
+	const char *t, *i;
+	int idx, n;
+
+	n = get_length(funcs);
+	for (idx = 0; idx < n; idx++) {
+		f = config_setting_get_elem(funcs, idx);
+		if (gt_scheme_function_key(f, &t, &i) == 0
+		    && streq(t, type) && streq(i, instance))
+			return f;
+	}
+
+	return NULL;
+}
+
+static int diff_functions(struct gt_scheme_diff *diff,
+		const config_setting_t *old, const config_setting_t *new)
+{
+	struct gt_scheme_change *ch;
+	const config_setting_t *f, *o, *attrs;
+	const char *type, *instance;
+	int i, n;
+
+	n = get_length(new);
+	for (i = 0; i < n; i++) {
+		f = config_setting_get_elem(new, i);
+		if (gt_scheme_function_key(f, &type, &instance) < 0) {
+			fprintf(stderr, "Function %s has no type\n",
+				config_setting_name(f));
+			return -1;
+		}
+
+		o = find_function(old, type, instance);
+		if (o) {
+			attrs = get_member(f, "attrs");
+			if (!attrs || setting_equal(attrs, get_member(o, "attrs")))
+				continue;
+		}
+
+		ch = diff_add(diff, NULL,
+			      o ? GT_CHANGE_FUNC_ATTRS : GT_CHANGE_FUNC_ADD);
+		if (ch == NULL)
+			return -1;
+		ch->func_type = type;
+		ch->instance = instance;
+		ch->old_val = o;
+		ch->new_val = f;
+	}
+
+	n = get_length(old);
+	for (i = 0; i < n; i++) {
+		o = config_setting_get_elem(old, i);
+		if (gt_scheme_function_key(o, &type, &instance) < 0
+		    || find_function(new, type, instance))
+			continue;
+
+		ch = diff_add(diff, NULL, GT_CHANGE_FUNC_RM);
+		if (ch == NULL)
+			return -1;
+		ch->func_type = type;
+		ch->instance = instance;
+		ch->old_val = o;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Get binding name and target function
+ * @details Target may be a label of function defined in scheme or
+ * function definition. Name is NULL if not specified.
+ */
+static int get_binding(const config_setting_t *root, const config_setting_t *b,
+		const char **name, const char **type, const char **instance)
+{
+	const config_setting_t *f = b;
+
+	*name = NULL;
+	if (config_setting_type(b) == CONFIG_TYPE_GROUP) {
+		config_setting_lookup_string(b, "name", name);
+		f = config_setting_get_member(b, "function");
+		if (f == NULL)
+			return -1;
+	}
+
+	if (config_setting_type(f) == CONFIG_TYPE_STRING) {
+		f = get_member(get_member(root, "functions"),
+			       config_setting_get_string(f));
+		if (f == NULL)
+			return -1;
+	}
+
+	return gt_scheme_function_key(f, type, instance);
+}
+
+static int diff_bindings(struct gt_scheme_diff *diff,
+		const struct gt_scheme_change *tmpl,
+		const config_setting_t *old_root, const config_setting_t *old,
+		const config_setting_t *new_root, const config_setting_t *new)
+{
+	struct gt_scheme_change *ch;
+	const char *name, *type, *instance;
+	const char *oname, *otype, *oinstance;
+	char *matched;
+	int i, j, n, on;
+	int ret = -1;
+
+	on = get_length(old);
+	matched = calloc(on + 1, 1);
+	if (matched == NULL)
+		return -1;
+
+	n = get_length(new);
+	for (i = 0; i < n; i++) {
+		if (get_binding(new_root, config_setting_get_elem(new, i),
+				&name, &type, &instance) < 0) {
+			fprintf(stderr, "Invalid binding in config %d\n", tmpl->id);
+			goto out;
+		}
+
+		/* Match by name if specified, by target otherwise */
+		for (j = 0; j < on; j++) {
+			if (matched[j]
+			    || get_binding(old_root, config_setting_get_elem(old, j),
+					   &oname, &otype, &oinstance) < 0)
+				continue;
+
+			if (name ? (oname && streq(name, oname))
+			    : (streq(type, otype) && streq(instance, oinstance)))
+				break;
+		}
+
+		if (j < on) {
+			matched[j] = 1;
+			if (streq(type, otype) && streq(instance, oinstance))
+				continue;
+
+			ch = diff_add(diff, tmpl, GT_CHANGE_BINDING_RM);
+			if (ch == NULL)
+				goto out;
+			ch->name = oname;
+			ch->func_type = otype;
+			ch->instance = oinstance;
+		}
+
+		ch = diff_add(diff, tmpl, GT_CHANGE_BINDING_ADD);
+		if (ch == NULL)
+			goto out;
+		ch->name = name;
+		ch->func_type = type;
+		ch->instance = instance;
+	}
+
+	for (j = 0; j < on; j++) {
+		if (matched[j]
+		    || get_binding(old_root, config_setting_get_elem(old, j),
+				   &oname, &otype, &oinstance) < 0)
+			continue;
+
+		ch = diff_add(diff, tmpl, GT_CHANGE_BINDING_RM);
+		if (ch == NULL)
+			goto out;
+		ch->name = oname;
+		ch->func_type = otype;
+		ch->instance = oinstance;
+	}
+
+	ret = 0;
+out:
+	free(matched);
+	return ret;
+}
+
+static const config_setting_t *find_config(const config_setting_t *configs,
+		int id)
+{
+	const config_setting_t *c;
+	int i, n, cid;
+
+	n = get_length(configs);
+	for (i = 0; i < n; i++) {
+		c = config_setting_get_elem(configs, i);
+		if (config_setting_lookup_int(c, "id", &cid) == CONFIG_TRUE
+		    && cid == id)
+			return c;
+	}
+
+	return NULL;
+}
+
+static int diff_configs(struct gt_scheme_diff *diff,
+		const config_setting_t *old_root, const config_setting_t *new_root)
+{
+	const config_setting_t *old, *new, *c, *o;
+	struct gt_scheme_change tmpl;
+	struct gt_scheme_change *ch;
+	const char *label, *olabel;
+	int i, n, id;
+
+	old = get_member(old_root, "configs");
+	new = get_member(new_root, "configs");
+
+	n = get_length(new);
+	for (i = 0; i < n; i++) {
+		c = config_setting_get_elem(new, i);
+		if (config_setting_lookup_int(c, "id", &id) != CONFIG_TRUE) {
+			fprintf(stderr, "Configuration without id\n");
+			return -1;
+		}
+
+		label = NULL;
+		olabel = NULL;
+		config_setting_lookup_string(c, "name", &label);
+
+		o = find_config(old, id);
+		if (o) {
+			if (config_setting_lookup_string(o, "name", &olabel)
+			    != CONFIG_TRUE)
+				olabel = GT_SCHEME_CONFIG_LABEL;
+
+			/* Label is part of directory name, so config needs
+			 * to be created again */
+			if (label && !streq(label, olabel)) {
+				memset(&tmpl, 0, sizeof(tmpl));
+				tmpl.label = olabel;
+				tmpl.id = id;
+				ch = diff_add(diff, &tmpl, GT_CHANGE_CONFIG_RM);
+				if (ch == NULL)
+					return -1;
+				ch->old_val = o;
+				o = NULL;
+			}
+		}
+
+		memset(&tmpl, 0, sizeof(tmpl));
+		tmpl.label = label ? label : olabel ? olabel : GT_SCHEME_CONFIG_LABEL;
+		tmpl.id = id;
+
+		if (o == NULL) {
+			ch = diff_add(diff, &tmpl, GT_CHANGE_CONFIG_ADD);
+			if (ch == NULL)
+				return -1;
+			ch->new_val = c;
+		}
+
+		if (diff_attrs(diff, &tmpl, GT_CHANGE_CONFIG_ATTR,
+			       get_member(o, "attrs"), get_member(c, "attrs")) < 0
+		    || diff_strings(diff, &tmpl, GT_CHANGE_CONFIG_STRING,
+			       get_member(o, "strings"), get_member(c, "strings")) < 0
+		    || diff_bindings(diff, &tmpl,
+			       old_root, get_member(o, "functions"),
+			       new_root, get_member(c, "functions")) < 0)
+			return -1;
+	}
+
+	n = get_length(old);
+	for (i = 0; i < n; i++) {
+		o = config_setting_get_elem(old, i);
+		if (config_setting_lookup_int(o, "id", &id) != CONFIG_TRUE
+		    || find_config(new, id))
+			continue;
+
+		memset(&tmpl, 0, sizeof(tmpl));
+		if (config_setting_lookup_string(o, "name", &tmpl.label)
+		    != CONFIG_TRUE)
+			tmpl.label = GT_SCHEME_CONFIG_LABEL;
+		tmpl.id = id;
+
+		ch = diff_add(diff, &tmpl, GT_CHANGE_CONFIG_RM);
+		if (ch == NULL)
+			return -1;
+		ch->old_val = o;
+	}
+
+	return 0;
+}
+
+int gt_scheme_setting_equal(const config_setting_t *a,
+		const config_setting_t *b)
+{
+	return setting_equal(a, b);
+}
+
+static int is_live_lun_attr(const char *name)
+{
+	const char **ptr;
+
+	for (ptr = live_lun_attrs; *ptr; ptr++)
+		if (streq(*ptr, name))
+			return 1;
+
+	return 0;
+}
+
+/**
+ * @brief Check if only attributes from live_lun_attrs differ in luns
+ */
+static int luns_live(const config_setting_t *luns,
+		const config_setting_t *oluns)
+{
+	const config_setting_t *l, *o, *m, *om;
+	int i, j, n;
+
+	n = get_length(luns);
+	if (oluns == NULL || n != get_length(oluns))
+		return 0;
+
+	for (i = 0; i < n; i++) {
+		l = config_setting_get_elem(luns, i);
+		o = config_setting_get_elem(oluns, i);
+		for (j = 0; j < get_length(l); j++) {
+			m = config_setting_get_elem(l, j);
+			om = get_member(o, config_setting_name(m));
+			if (om && !setting_equal(m, om)
+			    && !is_live_lun_attr(config_setting_name(m)))
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+int gt_scheme_change_live(const struct gt_scheme_change *ch)
+{
+	const config_setting_t *attrs, *oattrs, *m, *o;
+	const char *name;
+	int i, n;
+
+	/* anything else changes descriptors */
+	if (ch->type != GT_CHANGE_FUNC_ATTRS
+	    || !streq(ch->func_type, "mass_storage"))
+		return 0;
+
+	attrs = get_member(ch->new_val, "attrs");
+	oattrs = get_member(ch->old_val, "attrs");
+	n = get_length(attrs);
+	for (i = 0; i < n; i++) {
+		m = config_setting_get_elem(attrs, i);
+		name = config_setting_name(m);
+		o = get_member(oattrs, name);
+		if (streq(name, "luns")) {
+			if (!luns_live(m, o))
+				return 0;
+		} else if (o && !gt_scheme_attr_ignored(name)
+			   && !setting_equal(m, o)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+int gt_scheme_diff(const config_setting_t *old_root,
+		const config_setting_t *new_root, struct gt_scheme_diff *diff)
+{
+	memset(diff, 0, sizeof(*diff));
+
+	if (diff_attrs(diff, NULL, GT_CHANGE_ATTR,
+		       get_member(old_root, "attrs"),
+		       get_member(new_root, "attrs")) < 0
+	    || diff_strings(diff, NULL, GT_CHANGE_STRING,
+		       get_member(old_root, "strings"),
+		       get_member(new_root, "strings")) < 0
+	    || diff_functions(diff, get_member(old_root, "functions"),
+		       get_member(new_root, "functions")) < 0
+	    || diff_configs(diff, old_root, new_root) < 0) {
+		gt_scheme_diff_free(diff);
+		return -1;
+	}
+
+	return 0;
+}
+
+void gt_scheme_diff_free(struct gt_scheme_diff *diff)
+{
+	free(diff->changes);
+	memset(diff, 0, sizeof(*diff));
+}
+
+static void print_string(FILE *fp, const char *str)
+{
+	for (; *str; str++) {
+		switch (*str) {
+		case '\t':
+			fputs("\\t", fp);
+			break;
+		case '\n':
+			fputs("\\n", fp);
+			break;
+		case '\\':
+			fputs("\\\\", fp);
+			break;
+		default:
+			fputc(*str, fp);
+		}
+	}
+}
+
+static void print_value(FILE *fp, const config_setting_t *s)
+{
+	int i, n;
+
+	if (s == NULL) {
+		fputc('-', fp);
+		return;
+	}
+
+	switch (config_setting_type(s)) {
+	case CONFIG_TYPE_INT:
+	case CONFIG_TYPE_INT64:
+		fprintf(fp, "%lld", (long long)config_setting_get_int64(s));
+		break;
+	case CONFIG_TYPE_FLOAT:
+		fprintf(fp, "%g", config_setting_get_float(s));
+		break;
+	case CONFIG_TYPE_BOOL:
+		fputs(config_setting_get_bool(s) ? "true" : "false", fp);
+		break;
+	case CONFIG_TYPE_STRING:
+		print_string(fp, config_setting_get_string(s));
+		break;
+	case CONFIG_TYPE_GROUP:
+	case CONFIG_TYPE_LIST:
+	case CONFIG_TYPE_ARRAY:
+		n = config_setting_length(s);
+		fputc(config_setting_type(s) == CONFIG_TYPE_GROUP ? '{' : '(', fp);
+		for (i = 0; i < n; i++) {
+			const config_setting_t *m = config_setting_get_elem(s, i);
+
+			if (i)
+				fputc(',', fp);
+			if (config_setting_name(m))
+				fprintf(fp, "%s=", config_setting_name(m));
+			print_value(fp, m);
+		}
+		fputc(config_setting_type(s) == CONFIG_TYPE_GROUP ? '}' : ')', fp);
+		break;
+	}
+}
+
+static void print_line(FILE *fp, const config_setting_t *old,
+		const config_setting_t *new, const char *fmt, ...)
+{
+	va_list ap;
+
+	fputc(old ? new ? '~' : '-' : '+', fp);
+	fputc('\t', fp);
+	va_start(ap, fmt);
+	vfprintf(fp, fmt, ap);
+	va_end(ap);
+	fputc('\t', fp);
+	print_value(fp, old);
+	fputc('\t', fp);
+	print_value(fp, new);
+	fputc('\n', fp);
+}
+
+void gt_scheme_change_print(FILE *fp, const struct gt_scheme_change *ch)
+{
+	const config_setting_t *attrs, *oattrs, *m, *o;
+	int i, n;
+
+	switch (ch->type) {
+	case GT_CHANGE_ATTR:
+		print_line(fp, ch->old_val, ch->new_val, "attrs/%s", ch->name);
+		break;
+	case GT_CHANGE_STRING:
+		print_line(fp, ch->old_val, ch->new_val, "strings/0x%x/%s",
+			   ch->lang, ch->name);
+		break;
+	case GT_CHANGE_FUNC_ADD:
+		fprintf(fp, "+\tfunctions/%s.%s\t-\t-\n",
+			ch->func_type, ch->instance);
+		break;
+	case GT_CHANGE_FUNC_RM:
+		fprintf(fp, "-\tfunctions/%s.%s\t-\t-\n",
+			ch->func_type, ch->instance);
+		break;
+	case GT_CHANGE_FUNC_ATTRS:
+		attrs = get_member(ch->new_val, "attrs");
+		oattrs = get_member(ch->old_val, "attrs");
+		n = get_length(attrs);
+		for (i = 0; i < n; i++) {
+			m = config_setting_get_elem(attrs, i);
+			if (gt_scheme_attr_ignored(config_setting_name(m)))
+				continue;
+			o = get_member(oattrs, config_setting_name(m));
+			if (o && setting_equal(m, o))
+				continue;
+			print_line(fp, o, m, "functions/%s.%s/attrs/%s",
+				   ch->func_type, ch->instance,
+				   config_setting_name(m));
+		}
+		break;
+	case GT_CHANGE_CONFIG_ADD:
+		fprintf(fp, "+\tconfigs/%s.%d\t-\t-\n", ch->label, ch->id);
+		break;
+	case GT_CHANGE_CONFIG_RM:
+		fprintf(fp, "-\tconfigs/%s.%d\t-\t-\n", ch->label, ch->id);
+		break;
+	case GT_CHANGE_CONFIG_ATTR:
+		print_line(fp, ch->old_val, ch->new_val, "configs/%s.%d/attrs/%s",
+			   ch->label, ch->id, ch->name);
+		break;
+	case GT_CHANGE_CONFIG_STRING:
+		print_line(fp, ch->old_val, ch->new_val,
+			   "configs/%s.%d/strings/0x%x/%s",
+			   ch->label, ch->id, ch->lang, ch->name);
+		break;
+	case GT_CHANGE_BINDING_ADD:
+	case GT_CHANGE_BINDING_RM:
+		fprintf(fp, "%c\tconfigs/%s.%d/functions/",
+			ch->type == GT_CHANGE_BINDING_ADD ? '+' : '-',
+			ch->label, ch->id);
+		if (ch->name)
+			fputs(ch->name, fp);
+		else
+			fprintf(fp, "%s.%s", ch->func_type, ch->instance);
+
+		if (ch->type == GT_CHANGE_BINDING_ADD)
+			fprintf(fp, "\t-\t%s.%s\n", ch->func_type, ch->instance);
+		else
+			fprintf(fp, "\t%s.%s\t-\n", ch->func_type, ch->instance);
+		break;
+	}
+}
+
+int gt_scheme_copy(config_setting_t *dst, const config_setting_t *src)
+{
+	const config_setting_t *m;
+	config_setting_t *s;
+	int i, n, type;
+	int ret;
+
+	n = config_setting_length(src);
+	for (i = 0; i < n; i++) {
+		m = config_setting_get_elem(src, i);
+		type = config_setting_type(m);
+
+		s = config_setting_add(dst, config_setting_name(m), type);
+		if (s == NULL)
+			return -1;
+
+		switch (type) {
+		case CONFIG_TYPE_INT:
+		case CONFIG_TYPE_INT64:
+			ret = config_setting_set_int64(s, config_setting_get_int64(m));
+			config_setting_set_format(s, config_setting_get_format(m));
+			break;
+		case CONFIG_TYPE_FLOAT:
+			ret = config_setting_set_float(s, config_setting_get_float(m));
+			break;
+		case CONFIG_TYPE_BOOL:
+			ret = config_setting_set_bool(s, config_setting_get_bool(m));
+			break;
+		case CONFIG_TYPE_STRING:
+			ret = config_setting_set_string(s, config_setting_get_string(m));
+			break;
+		default:
+			ret = gt_scheme_copy(s, m) == 0 ? CONFIG_TRUE : CONFIG_FALSE;
+			break;
+		}
+
+		if (ret != CONFIG_TRUE)
+			return -1;
+	}
+
+	return 0;
+}
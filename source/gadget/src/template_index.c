@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2012-2013 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "template_index.h"
+#include "common.h"
+
+#define GT_TEMPLATE_INDEX_MAGIC "GTI1"
+/* Header has fixed width, so that it can be updated in place */
+#define GT_TEMPLATE_INDEX_HEADER GT_TEMPLATE_INDEX_MAGIC " %020lld %09ld\n"
+#define GT_TEMPLATE_INDEX_HEADER_LEN 36
+
+static int entry_cmp(const void *a, const void *b)
+{
+	return strcmp(((const struct gt_template_entry *)a)->name,
+		      ((const struct gt_template_entry *)b)->name);
+}
+
+static int index_add(struct gt_template_index *idx, const char *name,
+		off_t size, time_t mtime, uint64_t hash)
+{
+	struct gt_template_entry *e;
+
+	/* grow when count reaches power of two */
+	if ((idx->count & (idx->count - 1)) == 0) {
+		e = realloc(idx->entries,
+			    (idx->count ? idx->count * 2 : 1) * sizeof(*e));
+		if (e == NULL)
+			return -1;
+		idx->entries = e;
+	}
+
+	e = &idx->entries[idx->count];
+	e->name = strdup(name);
+	if (e->name == NULL)
+		return -1;
+	e->size = size;
+	e->mtime = mtime;
+	e->hash = hash;
+	idx->count++;
+
+	return 0;
+}
+
+void gt_template_index_free(struct gt_template_index *idx)
+{
+	int i;
+
+	for (i = 0; i < idx->count; i++)
+		free(idx->entries[i].name);
+	free(idx->entries);
+	memset(idx, 0, sizeof(*idx));
+}
+
+const struct gt_template_entry *gt_template_index_find(
+		const struct gt_template_index *idx, const char *name)
+{
+	struct gt_template_entry key = { .name = (char *)name };
+
+	if (idx->count == 0)
+		return NULL;
+
+	return bsearch(&key, idx->entries, idx->count, sizeof(key), entry_cmp);
+}
+
+static int index_path(char *buf, size_t size, const char *dir, const char *name)
+{
+	int ret;
+
+	ret = snprintf(buf, size, "%s/%s", dir, name);
+	if (ret >= size) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int index_read(const char *dir, struct gt_template_index *idx)
+{
+	char path[PATH_MAX];
+	long long sec, mtime, size;
+	unsigned long long hash;
+	char *buf, *line, *next, *tab;
+	struct stat st;
+	long nsec;
+	int fd;
+	int ret = -1;
+
+	if (index_path(path, sizeof(path), dir, GT_TEMPLATE_INDEX_FILE) < 0)
+		return -1;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	if (fstat(fd, &st) < 0 || st.st_size < GT_TEMPLATE_INDEX_HEADER_LEN) {
+		close(fd);
+		return -1;
+	}
+
+	buf = malloc(st.st_size + 1);
+	if (buf == NULL || read(fd, buf, st.st_size) != st.st_size) {
+		close(fd);
+		free(buf);
+		return -1;
+	}
+	close(fd);
+	buf[st.st_size] = '\0';
+
+	if (sscanf(buf, GT_TEMPLATE_INDEX_MAGIC " %lld %ld", &sec, &nsec) != 2)
+		goto out;
+
+	idx->dir_mtime.tv_sec = sec;
+	idx->dir_mtime.tv_nsec = nsec;
+
+	for (line = buf + GT_TEMPLATE_INDEX_HEADER_LEN; *line; line = next) {
+		next = strchr(line, '\n');
+		if (next == NULL)
+			goto err;
+		*next++ = '\0';
+
+		tab = strchr(line, '\t');
+		if (tab == NULL)
+			goto err;
+		*tab++ = '\0';
+
+		if (sscanf(tab, "%lld\t%lld\t%llx", &size, &mtime, &hash) != 3
+		    || index_add(idx, line, size, mtime, hash) < 0)
+			goto err;
+	}
+
+	ret = 0;
+	goto out;
+err:
+	gt_template_index_free(idx);
+out:
+	free(buf);
+	return ret;
+}
+
+static int index_write(const char *dir, const struct gt_template_index *idx)
+{
+	char path[PATH_MAX];
+	char tmp[PATH_MAX];
+	char header[GT_TEMPLATE_INDEX_HEADER_LEN + 1];
+	struct stat st;
+	FILE *fp;
+	int fd;
+	int i;
+
+	if (index_path(path, sizeof(path), dir, GT_TEMPLATE_INDEX_FILE) < 0
+	    || index_path(tmp, sizeof(tmp), dir, GT_TEMPLATE_INDEX_FILE ".tmp") < 0)
+		return -1;
+
+	fp = fopen(tmp, "w");
+	if (fp == NULL)
+		return -1;
+
+	/* Placeholder, directory mtime is known after rename */
+	fprintf(fp, GT_TEMPLATE_INDEX_HEADER, 0LL, 0L);
+	for (i = 0; i < idx->count; i++)
+		fprintf(fp, "%s\t%lld\t%lld\t%016llx\n", idx->entries[i].name,
+			(long long)idx->entries[i].size,
+			(long long)idx->entries[i].mtime,
+			(unsigned long long)idx->entries[i].hash);
+
+	if (fclose(fp) != 0 || rename(tmp, path) < 0) {
+		unlink(tmp);
+		return -1;
+	}
+
+	/* Creating index modifies directory, so record mtime after that.
+	 * Writing to existing file doesn't change it anymore. */
+	if (stat(dir, &st) < 0)
+		return -1;
+
+	fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	snprintf(header, sizeof(header), GT_TEMPLATE_INDEX_HEADER,
+		 (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec);
+	if (pwrite(fd, header, GT_TEMPLATE_INDEX_HEADER_LEN, 0)
+	    != GT_TEMPLATE_INDEX_HEADER_LEN) {
+		close(fd);
+		return -1;
+	}
+
+	return close(fd);
+}
+
+static int hash_file(int dirfd, const char *name, off_t size, uint64_t *hash)
+{
+	char *buf;
+	int fd;
+	int ret = -1;
+
+	fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	buf = malloc(size + 1);
+	if (buf && read(fd, buf, size) == size) {
+		*hash = gt_hash(buf, size);
+		ret = 0;
+	}
+
+	free(buf);
+	close(fd);
+	return ret;
+}
+
+/**
+ * @brief Scan directory, reusing fingerprints from old index for
+ * templates with unchanged size and mtime
+ * @param[in] hash 0 to leave fingerprints of changed templates unknown
+ * instead of reading them
+ */
+static int index_scan(const char *dir, const struct gt_template_index *old,
+		struct gt_template_index *idx, int hash)
+{
+	const struct gt_template_entry *e;
+	struct dirent *d;
+	struct stat st;
+	uint64_t val;
+	DIR *dp;
+	int ret = 0;
+
+	memset(idx, 0, sizeof(*idx));
+
+	dp = opendir(dir);
+	if (dp == NULL)
+		return -1;
+
+	while ((d = readdir(dp)) != NULL) {
+		/* skips also the index itself */
+		if (d->d_name[0] == '.' || strpbrk(d->d_name, "\t\n"))
+			continue;
+
+		if (fstatat(dirfd(dp), d->d_name, &st, 0) < 0
+		    || !S_ISREG(st.st_mode))
+			continue;
+
+		e = old ? gt_template_index_find(old, d->d_name) : NULL;
+		if (e && e->size == st.st_size && e->mtime == st.st_mtime)
+			val = e->hash;
+		else if (!hash)
+			val = GT_TEMPLATE_HASH_UNKNOWN;
+		else if (hash_file(dirfd(dp), d->d_name, st.st_size, &val) < 0)
+			continue;
+
+		ret = index_add(idx, d->d_name, st.st_size, st.st_mtime, val);
+		if (ret < 0)
+			break;
+	}
+
+	closedir(dp);
+
+	if (ret < 0) {
+		gt_template_index_free(idx);
+		return -1;
+	}
+
+	if (idx->count)
+		qsort(idx->entries, idx->count, sizeof(*idx->entries), entry_cmp);
+
+	return 0;
+}
+
+/**
+ * @brief Update entries of templates edited in place
+ * @details Editing a file doesn't change mtime of directory, so size and
+ * mtime of each entry have to be compared with the file itself.
+ * @return Number of updated entries, -1 on error
+ */
+static int index_verify(const char *dir, struct gt_template_index *idx,
+		int hash)
+{
+	struct gt_template_entry *e;
+	struct stat st;
+	int changed = 0;
+	int dirfd;
+	int i;
+
+	dirfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd < 0)
+		return -1;
+
+	for (i = 0; i < idx->count; i++) {
+		e = &idx->entries[i];
+		if (fstatat(dirfd, e->name, &st, 0) < 0
+		    || (e->size == st.st_size && e->mtime == st.st_mtime))
+			continue;
+
+		e->size = st.st_size;
+		e->mtime = st.st_mtime;
+		if (!hash || hash_file(dirfd, e->name, st.st_size, &e->hash) < 0)
+			e->hash = GT_TEMPLATE_HASH_UNKNOWN;
+		changed++;
+	}
+
+	close(dirfd);
+	return changed;
+}
+
+/**
+ * @brief Read stored index
+ * @return 0 if index is valid, 1 if it's stale (idx is filled anyway),
+ * -1 if there is none
+ */
+static int index_load(const char *dir, struct gt_template_index *idx)
+{
+	struct stat st;
+
+	memset(idx, 0, sizeof(*idx));
+
+	if (stat(dir, &st) < 0 || index_read(dir, idx) < 0)
+		return -1;
+
+	return idx->dir_mtime.tv_sec != st.st_mtim.tv_sec
+		|| idx->dir_mtime.tv_nsec != st.st_mtim.tv_nsec;
+}
+
+int gt_template_index_get(const char *dir, struct gt_template_index *idx,
+		int verify)
+{
+	struct gt_template_index old;
+	/* without index file fingerprints would be read again every time */
+	int writable = access(dir, W_OK) == 0;
+	int ret;
+
+	if (index_load(dir, &old) == 0) {
+		*idx = old;
+		if (!verify)
+			return 0;
+
+		ret = index_verify(dir, idx, writable);
+		if (ret > 0 && writable)
+			index_write(dir, idx);
+		return 0;
+	}
+
+	ret = index_scan(dir, &old, idx, writable);
+	gt_template_index_free(&old);
+	if (ret < 0)
+		return -1;
+
+	/* Lookup directory may be read-only, index is only an optimization */
+	if (writable)
+		index_write(dir, idx);
+
+	return 0;
+}
+
+int gt_template_index_rebuild(const char *dir, struct gt_template_index *idx)
+{
+	if (index_scan(dir, NULL, idx, 1) < 0) {
+		perror("Error reading directory");
+		return -1;
+	}
+
+	if (index_write(dir, idx) < 0) {
+		perror("Error writing template index");
+		gt_template_index_free(idx);
+		return -1;
+	}
+
+	return 0;
+}
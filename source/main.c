@@ -24,6 +24,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <libgen.h>
 #include <libconfig.h>
@@ -33,6 +34,8 @@
 #include "backend.h"
 #include "executable_command.h"
 #include "settings.h"
+#include "daemon.h"
+#include "trace.h"
 
 char *program_name;
 
@@ -49,23 +52,90 @@ static char *program_name_get(char *name, char **copy)
 	return basename(p);
 }
 
+/**
+ * @brief Remove global option preceding command from arguments
+ * @param[in] opt Name of option, given as --opt=val or --opt val
+ * @return value of option, NULL if first argument is not this option
+ */
+static const char *global_option(int *argc, char ***argv, const char *opt)
+{
+	char **args = *argv;
+	size_t len = strlen(opt);
+	const char *val;
+	int n;
+
+	if (*argc < 2 || strncmp(args[1], opt, len) != 0)
+		return NULL;
+
+	if (args[1][len] == '=') {
+		val = args[1] + len + 1;
+		n = 1;
+	} else if (args[1][len] == '\0' && *argc > 2) {
+		val = args[2];
+		n = 2;
+	} else {
+		return NULL;
+	}
+
+	args[n] = args[0];
+	*argv = args + n;
+	*argc -= n;
+
+	return val;
+}
+
 int main(int argc, char **argv)
 {
 	int ret;
 	ExecutableCommand cmd;
 	char *buf = NULL;
+	char *sock;
+	const char *root = NULL;
+	const char *trace = NULL;
+	const char *val;
 	config_t cfg;
 
 	program_name = program_name_get(argv[0], &buf);
+
+	for (;;) {
+		if ((val = global_option(&argc, &argv, "--root")))
+			root = val;
+		else if ((val = global_option(&argc, &argv, "--trace")))
+			trace = val;
+		else
+			break;
+	}
+
+	if (root == NULL)
+		root = getenv(GT_CONFIGFS_PATH_ENV);
+
+	if (trace && gt_trace_open(trace) < 0) {
+		fprintf(stderr, "Unable to trace to %s\n", trace);
+		ret = -1;
+		goto out;
+	}
+
+	/* Let running daemon execute command using its cached state,
+	 * unless command is meant for other configfs than daemon's
+	 * or has to be traced in this process */
+	sock = getenv(GT_DAEMON_SOCKET_ENV);
+	if (sock && !root && !trace && streq(program_name, "gt") && argc > 1
+	    && !streq(argv[1], "daemon")
+	    && gt_daemon_forward(sock, argc, argv, &ret) == 0)
+		goto out;
+
 	ret = gt_backend_init(program_name, 0);
 	if (ret < 0)
 		goto out;
 
 	config_init(&cfg);
-	ret = gt_parse_settings(&cfg);
+	ret = GT_TRACE("gt", NULL, gt_parse_settings, &cfg);
 	if (ret < 0)
 		goto out1;
 
+	if (root)
+		gt_settings.configfs_path = root;
+
 	gt_parse_commands(argc, argv, &cmd);
 
 	ret = executable_command_exec(&cmd);
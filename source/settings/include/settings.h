@@ -24,6 +24,10 @@
 /* user settings file */
 #define GT_USER_SETTING_PATH "~/.gt.conf"
 
+#define GT_DEFAULT_CONFIGFS_PATH "/sys/kernel/config/"
+/* overrides configfs-path setting, --root option overrides both */
+#define GT_CONFIGFS_PATH_ENV "GT_CONFIGFS_PATH"
+
 struct gt_setting_list {
 	const char *default_udc;
 	const char *configfs_path;
@@ -33,7 +33,7 @@ static const char *_lookup_path[] = {
  * Settings file will override them if exists. */
 struct gt_setting_list gt_settings = {
 	.default_udc = "myudc",
-	.configfs_path = "/sys/kernel/config/",
+	.configfs_path = GT_DEFAULT_CONFIGFS_PATH,
 	.lookup_path = _lookup_path,
 	.default_template_path = "/etc/gt/templates",
 	.default_gadget = "g1",
@@ -126,10 +126,15 @@ expect_failure "settings detach lookup-path and more";
 expect_failure "settings detach lookup-path";
 
 expect_success "create gadget1" "name=gadget1, force=0";
+expect_success "--root=/tmp create gadget1" "name=gadget1, force=0";
+expect_success "--trace=/dev/null create gadget1" "name=gadget1, force=0";
+expect_success "--root /tmp create gadget1" "name=gadget1, force=0";
 expect_success "create -f gadget2" "name=gadget2, force=1";
 expect_success "create -f gadget2 idVendor=1" "name=gadget2, force=1, idVendor=1";
 expect_success "create --force gadget3 idVendor=1 idProduct=2"\
 	"name=gadget3, force=1, idVendor=1, idProduct=2";
+expect_success "create gadget1 max_speed=high-speed"\
+	"name=gadget1, force=0, max_speed=high-speed";
 expect_success "rm gadget1" "name=gadget1, force=0, recursive=0";
 expect_success "rm -r gadget2" "name=gadget2, force=0, recursive=1";
 expect_success "rm -f gadget3" "name=gadget3, force=1, recursive=0";
@@ -137,6 +142,7 @@ expect_success "rm -rf gadget4" "name=gadget4, force=1, recursive=1";
 
 expect_failure "create gadget1 --verbose";
 expect_failure "create gadget1 and more";
+expect_failure "create gadget1 max_speed=fast";
 expect_failure "create";
 expect_failure "rm -rf gadget gadget";
 expect_failure "rm";
@@ -145,27 +151,50 @@ expect_success "get gadget1" "name=gadget1, attrs=";
 expect_success "get gadget1 idVendor" "name=gadget1, attrs=idVendor,";
 expect_success "get gadget2 idVendor idProduct" \
 	"name=gadget2, attrs=idVendor, idProduct,";
+expect_success "get gadget1 max_speed ssp_rate" \
+	"name=gadget1, attrs=max_speed, ssp_rate,";
 expect_success "set gadget idVendor=1" "name=gadget, idVendor=1";
 expect_success "set gadget idVendor=1 idProduct=2"\
 	"name=gadget, idVendor=1, idProduct=2";
+expect_success "set gadget ssp_rate=super-speed-plus-gen2x1"\
+	"name=gadget, ssp_rate=super-speed-plus-gen2x1";
 
 expect_failure "get";
 expect_failure "set gadget";
 expect_failure "set gadget attr equals val";
+expect_failure "set gadget ssp_rate=high-speed";
 expect_failure "set";
 
 expect_success "enable gadget udc" "gadget=gadget, udc=udc";
 expect_success "enable gadget1" "gadget=gadget1,";
+expect_success "enable --wait gadget1 udc" "gadget=gadget1, udc=udc, wait=configured, timeout=-1";
+expect_success "enable --wait=addressed --timeout=1.5 gadget1 udc" "gadget=gadget1, udc=udc, wait=addressed, timeout=1500";
+expect_success "enable --disconnected gadget1 udc" "gadget=gadget1, udc=udc, disconnected=1";
+expect_success "enable --ffs-wait gadget1 udc" "gadget=gadget1, udc=udc, ffs_wait=1, timeout=-1";
+expect_success "enable --ffs-mount=/dev/ffs --timeout=5 gadget1 udc" "gadget=gadget1, udc=udc, ffs_mount=/dev/ffs, timeout=5000";
 expect_success "disable" "";
 expect_success "disable gadget1" "gadget=gadget1,";
 expect_success "disable --udc=udc1" "udc=udc1";
 
+expect_success "udc" "json=0, verbose=0";
+expect_success "udc --json" "json=1, verbose=0";
+expect_success "udc -v" "json=0, verbose=1";
+expect_success "udc -v --json" "json=1, verbose=1";
+expect_failure "udc udc1";
+expect_success "udc connect udc1" "udc=udc1";
+expect_success "udc disconnect udc1" "udc=udc1";
+expect_failure "udc connect";
+expect_failure "udc disconnect udc1 udc2";
+
 expect_failure "enable";
 expect_failure "disable gadget1 --udc=udc";
 expect_failure "enable -f";
 expect_failure "enable -v";
 expect_failure "enable -r";
 expect_failure "enable -o";
+expect_failure "enable --wait=bound gadget1";
+expect_failure "enable --timeout=1 gadget1";
+expect_failure "enable --disconnected --wait gadget1";
 expect_failure "disable gadget1 sth";
 expect_failure "disable gadget1 --gadget=gadget2";
 expect_failure "disable gadget1 -f";
@@ -178,14 +207,20 @@ expect_success "gadget gadget1 -v" "name=gadget1, recursive=0, verbose=1";
 expect_success "gadget gadget3 -r" "name=gadget3, recursive=1, verbose=0";
 expect_success "gadget gadget4 -vr" "name=gadget4, recursive=1, verbose=1";
 
+expect_success "gadget gadget1 --json" "name=gadget1, recursive=0, verbose=0";
+
 expect_failure "gadget gadget -f";
 expect_failure "gadget gadget gadget";
 
-expect_success "load name gadget1" "name=name, gadget=gadget1, off=0, stdin=0";
-expect_success "load name gadget1 --off" "name=name, gadget=gadget1, off=1, stdin=0";
-expect_success "load name --stdin" "gadget=name, off=0, stdin=1";
+expect_success "load name gadget1" "name=name, gadget=gadget1, off=0, stdin=0, if_changed=0";
+expect_success "load name gadget1 --off" "name=name, gadget=gadget1, off=1, stdin=0, if_changed=0";
+expect_success "load name --stdin" "gadget=name, off=0, stdin=1, if_changed=0";
 expect_success "load name gadget1 --path=path"\
-	"name=name, gadget=gadget1, path=path, off=0, stdin=0";
+	"name=name, gadget=gadget1, path=path, off=0, stdin=0, if_changed=0";
+expect_success "load name gadget1 --if-changed"\
+	"name=name, gadget=gadget1, off=0, stdin=0, if_changed=1";
+expect_success "load name gadget1 --record=plan"\
+	"name=name, gadget=gadget1, record=plan, off=0, stdin=0, if_changed=0";
 expect_success "save gadget1 name" "gadget=gadget1, name=name, force=0, stdout=0";
 expect_success "save gadget1 --file=file"\
 	"gadget=gadget1, name=gadget1, file=file, force=0, stdout=0";
@@ -196,6 +231,16 @@ expect_success "save gadget1 name --path=path"\
 expect_success "save gadget1 name -f"\
 	"gadget=gadget1, name=name, force=1, stdout=0";
 
+expect_success "apply scheme gadget1" "file=scheme, gadget=gadget1, off=0, verbose=0";
+expect_success "apply -ov scheme gadget1" "file=scheme, gadget=gadget1, off=1, verbose=1";
+expect_success "diff gadget1 scheme" "gadget=gadget1, other=scheme, quiet=0";
+expect_success "diff -q gadget1 gadget2" "gadget=gadget1, other=gadget2, quiet=1";
+expect_success "compile scheme" "file=scheme";
+expect_success "compile scheme -o scheme.gtb" "file=scheme, output=scheme.gtb";
+expect_success "compile --output=out scheme" "file=scheme, output=out";
+expect_success "replay plan" "file=plan, off=0";
+expect_success "replay -o plan gadget1" "file=plan, gadget=gadget1, off=1";
+
 expect_failure "load name --file=file1 --stdin";
 expect_failure "load name --stdin --path=path1";
 expect_failure "load name --path=path1 --file=file1";
@@ -208,6 +253,40 @@ expect_failure "save gadget --path=path1 --file=file1";
 expect_failure "save gadget --path";
 expect_failure "save gadget --file";
 expect_failure "save";
+expect_failure "apply scheme";
+expect_failure "apply scheme gadget1 more";
+expect_failure "diff gadget1";
+expect_failure "compile";
+expect_failure "compile scheme1 scheme2";
+expect_failure "compile scheme -o";
+expect_failure "replay";
+expect_failure "replay plan gadget1 more";
+expect_failure "load name --record";
+
+expect_success "pool prepare ecm.scheme ncm"\
+	"personas = ecm = ecm.scheme, ncm = ncm,";
+expect_success "pool prepare --path=path acm_ms=schemes/acm-ms.gs"\
+	"path = path, personas = acm_ms = schemes/acm-ms.gs,";
+expect_success "pool prepare dir/ffs.scheme"\
+	"personas = ffs = dir/ffs.scheme,";
+expect_success "pool switch udc ecm" "udc = udc, to = ecm, soft_connect = 0";
+expect_success "pool switch --wait --timeout=2 udc ncm"\
+	"udc = udc, to = ncm, soft_connect = 0, wait = configured, timeout = 2000";
+expect_success "switch udc ecm ncm"\
+	"udc = udc, from = ecm, to = ncm, soft_connect = 0";
+expect_success "switch --soft-connect --wait=addressed udc ecm ncm"\
+	"udc = udc, from = ecm, to = ncm, soft_connect = 1, wait = addressed, timeout = -1";
+
+expect_failure "pool";
+expect_failure "pool prepare";
+expect_failure "pool prepare =scheme";
+expect_failure "pool switch udc";
+expect_failure "pool switch udc ecm more";
+expect_failure "pool switch --timeout=1 udc ecm";
+expect_failure "pool switch --wait=bound udc ecm";
+expect_failure "switch udc ecm";
+expect_failure "switch udc ecm ncm more";
+expect_failure "switch --timeout=1 udc ecm ncm";
 
 expect_success "template name" "name=name, verbose=0, recursive=0";
 expect_success "template" "verbose=0, recursive=0";
@@ -223,6 +302,7 @@ expect_success "template get name" "name=name, attr=";
 expect_success "template get name attr" "name=name, attr=attr,";
 expect_success "template set name attr=val" "name=name, attr=val";
 expect_success "template rm name" "name=name";
+expect_success "template reindex" "";
 
 expect_failure "template get"
 expect_failure "template set name"
@@ -230,6 +310,7 @@ expect_failure "template set name attr"
 expect_failure "template set name attr1=val1 attr2"
 expect_failure "template rm"
 expect_failure "template rm name1 name2"
+expect_failure "template reindex path"
 
 expect_success "config create gadget1 config 1"\
 	"gadget=gadget1, cfg_label=config, cfg_id=1, force=0";
@@ -375,6 +456,15 @@ expect_failure "func create gadget";
 expect_failure "func create gadget acm name attrval";
 expect_failure "func create gadget acmname";
 
+expect_success "func preload acm ecm" "types=acm, ecm, quiet=0";
+expect_success "func preload -q --from-scheme=file"\
+	"types=, file=file, quiet=1";
+expect_success "func preload --from-scheme=file rndis"\
+	"types=rndis, file=file, quiet=0";
+
+expect_failure "func preload";
+expect_failure "func preload acm unknown";
+
 expect_success "func rm gadget acm name"\
 	"gadget=gadget, type=acm, instance=name, recursive=0, force=0";
 expect_success "func rm gadget1 acm name"\
@@ -422,6 +512,7 @@ expect_success "func show gadget1" "gadget=gadget1, verbose=0";
 expect_success "func show gadget1 acm name"\
 	"gadget=gadget1, type=acm, instance=name, verbose=0";
 expect_success "func show -v gadget1" "gadget=gadget1, verbose=1";
+expect_success "func show --json gadget1" "gadget=gadget1, verbose=0";
 expect_success "func --verbose gadget1 acm name"\
 	"gadget=gadget1, type=acm, instance=name, verbose=1";
 
@@ -501,4 +592,11 @@ expect_success "func template rm name1" "name=name1";
 expect_failure "func template rm";
 expect_failure "func template rm name1 name2";
 
+expect_failure "batch";
+expect_failure "batch --stdin --file=file1";
+expect_failure "batch --file=file1 --stdin";
+expect_failure "batch --stdin name";
+expect_failure "daemon name";
+expect_failure "daemon --socket";
+
 echo "Testing finished, $SUCCESS_COUNT tests passed, $ERROR_COUNT failed.";
@@ -21,6 +21,18 @@
 
 struct gt_udc_backend {
 	int (*udc)(void *);
+	int (*connect)(void *);
+};
+
+struct gt_udc_data {
+	int opts;
+};
+
+struct gt_udc_connect_data {
+	const char *udc;
+	/* 1 to connect, 0 to disconnect */
+	int connect;
+	int opts;
 };
 
 /**
@@ -42,6 +54,24 @@ int udc_help_func(void *data);
 void udc_parse(const Command *cmd, int argc, char **argv,
 		ExecutableCommand *exec, void * data);
 
+/**
+ * @brief Gets the next possible commands after udc
+ * @param[in] cmd actual command (should be udc)
+ * @return Pointer to table with all children of cmd
+ * where the last element is invalid structure filled
+ * with NULLs.
+ */
+const Command *gt_udc_get_children(const Command *cmd);
+
+/**
+ * @brief Write soft_connect attribute of udc
+ * @details Kernel accepts it only while a gadget is bound to the udc.
+ * @param[in] udc Name of udc
+ * @param[in] connect 1 to connect, 0 to disconnect
+ * @return 0 on success, -1 otherwise (error is printed)
+ */
+int gt_udc_soft_connect(const char *udc, int connect);
+
 extern struct gt_udc_backend gt_udc_backend_libusbg;
 #ifdef WITH_GADGETD
 extern struct gt_udc_backend gt_udc_backend_gadgetd;
@@ -15,9 +15,18 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
 
 #include "udc.h"
+#include "common.h"
+#include "parser.h"
 #include "backend.h"
+#include "trace.h"
 
 #define GET_EXECUTABLE(func) \
 	(backend_ctx.backend->udc->func ? \
@@ -26,17 +35,136 @@
 
 int udc_help_func(void *data)
 {
-	printf("UDC help func. Not implemented yet.\n");
+	printf("usage: %s udc [options]\n"
+	       "       %s udc connect|disconnect <udc>\n"
+	       "Show available USB device controllers.\n"
+	       "Options:\n"
+	       "  -v, --verbose\tShow also state and speed of controllers\n"
+	       "  --json\tShow controllers and bound gadgets as JSON document\n"
+	       "  -h, --help\tPrint this help\n",
+	       program_name, program_name);
 	return -1;
 }
 
 void udc_parse(const Command *cmd, int argc, char **argv,
 		ExecutableCommand *exec, void * data)
 {
-	if(argc == 0)
-		// udc should be run without args
-		executable_command_set(exec, GET_EXECUTABLE(udc), data, NULL);
-	else
-		// Wrong syntax for udc command, let's print help
-		executable_command_set(exec, cmd->printHelp, data, NULL);
+	struct gt_udc_data *dt;
+	int ind;
+	int avaible_opts = GT_HELP | GT_JSON | GT_VERBOSE;
+
+	dt = zalloc(sizeof(*dt));
+	if (dt == NULL)
+		goto out;
+
+	ind = gt_get_options(&dt->opts, avaible_opts, argc, argv);
+	if (ind < 0 || dt->opts & GT_HELP)
+		goto out;
+
+	// udc doesn't take any arguments
+	if (ind != argc)
+		goto out;
+
+	executable_command_set(exec, GET_EXECUTABLE(udc), (void *)dt, free);
+	executable_command_set_scope(exec, GT_SCOPE_UDC, NULL);
+	return;
+out:
+	free(dt);
+	// Wrong syntax for udc command, let's print help
+	executable_command_set(exec, cmd->printHelp, data, NULL);
+}
+
+int gt_udc_soft_connect(const char *udc, int connect)
+{
+	const char *val = connect ? "connect" : "disconnect";
+	char path[PATH_MAX];
+	long long start;
+	int ret = -1;
+	int fd;
+
+	if (snprintf(path, sizeof(path), GT_UDC_DIR "/%s/soft_connect", udc)
+	    >= sizeof(path)) {
+		fprintf(stderr, "path too long\n");
+		return -1;
+	}
+
+	start = gt_trace_now();
+	fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd >= 0) {
+		ret = write(fd, val, strlen(val)) == strlen(val) ? 0 : -1;
+		close(fd);
+	}
+	gt_trace_event("sysfs", "write", path, start, ret);
+
+	if (ret < 0)
+		fprintf(stderr, "Unable to %s %s: %s\n", val, udc,
+			strerror(errno));
+
+	return ret;
+}
+
+static int udc_connect_help(void *data)
+{
+	printf("usage: %s udc connect|disconnect [options] <udc>\n"
+	       "Attach or detach pull-up of udc without unbinding its gadget.\n"
+	       "Host sees the device disappear and come back, e.g. after\n"
+	       "FunctionFS daemons are ready or to force re-enumeration.\n"
+	       "Options:\n"
+	       "  -h, --help\tPrint this help\n",
+	       program_name);
+	return -1;
+}
+
+static void parse_soft_connect(const Command *cmd, int argc, char **argv,
+		ExecutableCommand *exec, void * data, int connect)
+{
+	struct gt_udc_connect_data *dt;
+	int ind;
+	int avaible_opts = GT_HELP;
+
+	dt = zalloc(sizeof(*dt));
+	if (dt == NULL)
+		goto out;
+
+	dt->connect = connect;
+
+	ind = gt_get_options(&dt->opts, avaible_opts, argc, argv);
+	if (ind < 0 || dt->opts & GT_HELP)
+		goto out;
+
+	if (argc - ind != 1)
+		goto out;
+
+	dt->udc = argv[ind];
+
+	executable_command_set(exec, GET_EXECUTABLE(connect), (void *)dt, free);
+	executable_command_set_scope(exec, GT_SCOPE_NONE, NULL);
+	return;
+out:
+	free(dt);
+	executable_command_set(exec, cmd->printHelp, data, NULL);
+}
+
+static void udc_parse_connect(const Command *cmd, int argc, char **argv,
+		ExecutableCommand *exec, void * data)
+{
+	parse_soft_connect(cmd, argc, argv, exec, data, 1);
+}
+
+static void udc_parse_disconnect(const Command *cmd, int argc, char **argv,
+		ExecutableCommand *exec, void * data)
+{
+	parse_soft_connect(cmd, argc, argv, exec, data, 0);
+}
+
+const Command *gt_udc_get_children(const Command *cmd)
+{
+	static Command commands[] = {
+		{"connect", NEXT, udc_parse_connect, NULL, udc_connect_help},
+		{"disconnect", NEXT, udc_parse_disconnect, NULL, udc_connect_help},
+		{NULL, AGAIN, udc_parse, NULL, udc_help_func},
+		CMD_LIST_END
+	};
+
+	return commands;
 }
@@ -19,4 +19,5 @@
 
 struct gt_udc_backend gt_udc_backend_gadgetd = {
 	.udc = NULL,
+	.connect = NULL,
 };
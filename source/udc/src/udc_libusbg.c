@@ -15,16 +15,303 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <usbg/usbg.h>
+#ifdef WITH_IO_URING
+#include <liburing.h>
+#endif
 
 #include "backend.h"
+#include "common.h"
+#include "parser.h"
 #include "udc.h"
+#include "json.h"
+
+/* soft_connect is not listed, as it can be only written */
+enum {
+	UDC_STATE,
+	UDC_CURRENT_SPEED,
+	UDC_MAXIMUM_SPEED,
+	UDC_IS_OTG,
+	UDC_ATTR_MAX,
+};
+
+static const char *udc_attrs[UDC_ATTR_MAX] = {
+	[UDC_STATE] = "state",
+	[UDC_CURRENT_SPEED] = "current_speed",
+	[UDC_MAXIMUM_SPEED] = "maximum_speed",
+	[UDC_IS_OTG] = "is_otg",
+};
+
+#define UDC_ATTR_LEN 32
+
+struct udc_info {
+	usbg_udc *u;
+	/* empty if attribute could not be read */
+	char val[UDC_ATTR_MAX][UDC_ATTR_LEN];
+};
+
+/* link of configured gadget is slower than controller can handle */
+static int below_maximum_speed(const struct udc_info *info)
+{
+	return streq(info->val[UDC_STATE], "configured")
+		&& gt_speed_rank(info->val[UDC_CURRENT_SPEED])
+		   < gt_speed_rank(info->val[UDC_MAXIMUM_SPEED]);
+}
+
+static int attr_path(char *buf, size_t size, const struct udc_info *info,
+		int attr)
+{
+	return snprintf(buf, size, "%s/%s", usbg_get_udc_name(info->u),
+			udc_attrs[attr]) < size ? 0 : -1;
+}
+
+static void strip_value(char *val, ssize_t len)
+{
+	val[len > 0 ? len : 0] = '\0';
+	val[strcspn(val, "\n")] = '\0';
+}
+
+static void read_attrs_sync(int dirfd, struct udc_info *info, int count)
+{
+	char path[PATH_MAX];
+	ssize_t len;
+	int i, attr;
+	int fd;
+
+	for (i = 0; i < count; i++) {
+		for (attr = 0; attr < UDC_ATTR_MAX; attr++) {
+			if (attr_path(path, sizeof(path), info + i, attr) < 0)
+				continue;
+
+			fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+			if (fd < 0)
+				continue;
+
+			len = read(fd, info[i].val[attr], UDC_ATTR_LEN - 1);
+			strip_value(info[i].val[attr], len);
+			close(fd);
+		}
+	}
+}
+
+#ifdef WITH_IO_URING
+#define UDC_URING_BATCH 32
+
+/*
+ * Attributes of all controllers are read in batches of linked open,
+ * read and close, so reading them takes a single submission per batch
+ * instead of three syscalls per attribute.
+ */
+static int read_attrs_uring(int dirfd, struct udc_info *info, int count)
+{
+	char paths[UDC_URING_BATCH][NAME_MAX + UDC_ATTR_LEN];
+	struct io_uring_probe *probe;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	struct io_uring ring;
+	char *val;
+	int total = count * UDC_ATTR_MAX;
+	int done, n, i, idx;
+	int ret = -1;
+
+	if (io_uring_queue_init(UDC_URING_BATCH * 3, &ring, 0) < 0)
+		return -1;
+
+	probe = io_uring_get_probe_ring(&ring);
+	if (!probe || !io_uring_opcode_supported(probe, IORING_OP_OPENAT)
+	    || !io_uring_opcode_supported(probe, IORING_OP_READ)
+	    || !io_uring_opcode_supported(probe, IORING_OP_CLOSE)
+	    || io_uring_register_files_sparse(&ring, UDC_URING_BATCH) < 0)
+		goto out;
+
+	for (done = 0; done < total; done += n) {
+		n = total - done < UDC_URING_BATCH ?
+			total - done : UDC_URING_BATCH;
+
+		for (i = 0; i < n; i++) {
+			idx = done + i;
+			val = info[idx / UDC_ATTR_MAX].val[idx % UDC_ATTR_MAX];
+			if (attr_path(paths[i], sizeof(paths[i]),
+				      info + idx / UDC_ATTR_MAX,
+				      idx % UDC_ATTR_MAX) < 0)
+				paths[i][0] = '\0';
+
+			sqe = io_uring_get_sqe(&ring);
+			io_uring_prep_openat_direct(sqe, dirfd, paths[i],
+						    O_RDONLY, 0, i);
+			sqe->flags |= IOSQE_IO_LINK;
+			sqe->user_data = i << 2;
+
+			sqe = io_uring_get_sqe(&ring);
+			io_uring_prep_read(sqe, i, val, UDC_ATTR_LEN - 1, 0);
+			sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+			sqe->user_data = i << 2 | 1;
+
+			sqe = io_uring_get_sqe(&ring);
+			io_uring_prep_close_direct(sqe, i);
+			sqe->user_data = i << 2 | 2;
+		}
+
+		if (io_uring_submit_and_wait(&ring, n * 3) < 0)
+			goto out;
+
+		for (i = 0; i < n * 3; i++) {
+			if (io_uring_wait_cqe(&ring, &cqe) < 0)
+				goto out;
+
+			/* only result of read is interesting */
+			if ((cqe->user_data & 3) == 1) {
+				idx = done + (cqe->user_data >> 2);
+				strip_value(info[idx / UDC_ATTR_MAX]
+					    .val[idx % UDC_ATTR_MAX], cqe->res);
+			}
+			io_uring_cqe_seen(&ring, cqe);
+		}
+	}
+
+	ret = 0;
+out:
+	io_uring_free_probe(probe);
+	io_uring_queue_exit(&ring);
+	return ret;
+}
+#else
+static int read_attrs_uring(int dirfd, struct udc_info *info, int count)
+{
+	return -1;
+}
+#endif
+
+/**
+ * @brief Get controllers with their sysfs attributes
+ * @param[out] count Number of controllers
+ * @return Array of controllers to be freed by caller, NULL on error
+ */
+static struct udc_info *get_udc_info(int *count)
+{
+	struct udc_info *info;
+	usbg_udc *u;
+	int dirfd;
+	int n = 0;
+
+	usbg_for_each_udc(u, backend_ctx.libusbg_state)
+		n++;
+
+	info = calloc(n ? n : 1, sizeof(*info));
+	if (info == NULL)
+		return NULL;
+
+	n = 0;
+	usbg_for_each_udc(u, backend_ctx.libusbg_state)
+		info[n++].u = u;
+
+	dirfd = open(GT_UDC_DIR, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd >= 0) {
+		if (read_attrs_uring(dirfd, info, n) < 0)
+			read_attrs_sync(dirfd, info, n);
+		close(dirfd);
+	}
+
+	*count = n;
+	return info;
+}
+
+static int udc_json(int verbose)
+{
+	struct udc_info *info = NULL;
+	struct gt_json j;
+	usbg_gadget *g;
+	usbg_udc *u;
+	int count;
+	int i, attr;
+
+	if (verbose) {
+		info = get_udc_info(&count);
+		if (info == NULL)
+			return -1;
+	}
+
+	if (gt_json_init(&j) < 0) {
+		free(info);
+		return -1;
+	}
+
+	gt_json_begin_object(&j, NULL);
+	gt_json_begin_array(&j, "udcs");
+	i = 0;
+	usbg_for_each_udc(u, backend_ctx.libusbg_state) {
+		g = usbg_get_udc_gadget(u);
+
+		gt_json_begin_object(&j, NULL);
+		gt_json_string(&j, "name", usbg_get_udc_name(u));
+		gt_json_string(&j, "gadget", g ? usbg_get_gadget_name(g) : NULL);
+		if (verbose) {
+			for (attr = 0; attr < UDC_ATTR_MAX; attr++)
+				gt_json_string(&j, udc_attrs[attr],
+					       info[i].val[attr][0] ?
+					       info[i].val[attr] : NULL);
+			gt_json_bool(&j, "below_maximum_speed",
+				     below_maximum_speed(info + i));
+		}
+		gt_json_end_object(&j);
+		i++;
+	}
+	gt_json_end_array(&j);
+	gt_json_end_object(&j);
+
+	free(info);
+	return gt_json_flush(&j, stdout);
+}
+
+static int udc_verbose(void)
+{
+	struct udc_info *info;
+	usbg_gadget *g;
+	int count;
+	int i, attr;
+
+	info = get_udc_info(&count);
+	if (info == NULL) {
+		fprintf(stderr, "Error getting udc attributes\n");
+		return -1;
+	}
+
+	for (i = 0; i < count; i++) {
+		g = usbg_get_udc_gadget(info[i].u);
+
+		puts(usbg_get_udc_name(info[i].u));
+		for (attr = 0; attr < UDC_ATTR_MAX; attr++)
+			printf("  %-16s%s%s\n", udc_attrs[attr],
+			       info[i].val[attr][0] ? info[i].val[attr] : "-",
+			       attr == UDC_CURRENT_SPEED
+			       && below_maximum_speed(info + i) ?
+			       " (below maximum_speed)" : "");
+		printf("  %-16s%s\n", "gadget",
+		       g ? usbg_get_gadget_name(g) : "-");
+	}
+
+	free(info);
+	return 0;
+}
 
 static int udc_func(void *data)
 {
+	struct gt_udc_data *dt;
 	usbg_udc *u;
 	const char *name;
 
+	dt = (struct gt_udc_data *)data;
+	if (dt->opts & GT_JSON)
+		return udc_json(dt->opts & GT_VERBOSE);
+
+	if (dt->opts & GT_VERBOSE)
+		return udc_verbose();
+
 	usbg_for_each_udc(u, backend_ctx.libusbg_state) {
 		name = usbg_get_udc_name(u);
 		if (name == NULL) {
@@ -38,6 +325,16 @@ static int udc_func(void *data)
 	return 0;
 }
 
+static int connect_func(void *data)
+{
+	struct gt_udc_connect_data *dt;
+
+	dt = (struct gt_udc_connect_data *)data;
+
+	return gt_udc_soft_connect(dt->udc, dt->connect);
+}
+
 struct gt_udc_backend gt_udc_backend_libusbg = {
 	.udc = udc_func,
+	.connect = connect_func,
 };
@@ -16,13 +16,31 @@
 
 #include <stdio.h>
 #include "udc.h"
+#include "parser.h"
 
 static int udc_func(void *data)
 {
+	struct gt_udc_data *dt;
+
+	dt = (struct gt_udc_data *)data;
 	printf("gt udc called successfully. Not implemented yet.\n");
+	printf("json = %d, verbose = %d\n", !!(dt->opts & GT_JSON),
+	       !!(dt->opts & GT_VERBOSE));
+	return 0;
+}
+
+static int connect_func(void *data)
+{
+	struct gt_udc_connect_data *dt;
+
+	dt = (struct gt_udc_connect_data *)data;
+	printf("gt udc %s called successfully. Not implemented yet.\n",
+	       dt->connect ? "connect" : "disconnect");
+	printf("udc = %s\n", dt->udc);
 	return 0;
 }
 
 struct gt_udc_backend gt_udc_backend_not_implemented = {
 	.udc = udc_func,
+	.connect = connect_func,
 };